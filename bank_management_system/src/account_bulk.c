@@ -0,0 +1,616 @@
+/**
+ * @file account_bulk.c
+ * @brief Whole-book interest, fee and statistics passes over the balance column
+ *
+ * A bulk job loads the book into columns (see account_columns.c), runs one
+ * streaming pass over the dense balance array and writes the changed
+ * balances back in group-committed batches. The passes are written as
+ * kernels over plain money_t arrays, with AVX2 and SSE4.2 versions that
+ * handle four and two balances per instruction. The best kernel the CPU
+ * supports is picked at run time; every kernel produces bit-identical
+ * results, so the scalar one doubles as the reference.
+ *
+ * Interest uses a rate held as a 32-bit binary fraction (rate / 2^32 per
+ * period) so that it can be applied with 32x32->64 bit multiplies, which
+ * both instruction sets provide. Each credit is rounded to the nearest
+ * minor unit, and only positive balances earn interest. A credit stops at
+ * the largest money_t instead of wrapping the balance, and the reported
+ * total saturates the same way. A fee takes a fixed amount from every
+ * positive balance, capped at the balance.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "bank_management_system.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BULK_HAVE_X86 1
+#endif
+
+/** @brief Decade thresholds between histogram buckets */
+#define BULK_THRESHOLDS (BULK_HISTOGRAM_BUCKETS - 1)
+
+static const money_t thresholds[BULK_THRESHOLDS] = {
+    1LL * MONEY_SCALE,
+    10LL * MONEY_SCALE,
+    100LL * MONEY_SCALE,
+    1000LL * MONEY_SCALE,
+    10000LL * MONEY_SCALE,
+    100000LL * MONEY_SCALE,
+    1000000LL * MONEY_SCALE,
+    10000000LL * MONEY_SCALE,
+    100000000LL * MONEY_SCALE,
+    1000000000LL * MONEY_SCALE,
+};
+
+/**
+ * @struct StatsPartial
+ * @brief Running statistics; atLeast[k] counts balances >= thresholds[k]
+ */
+typedef struct
+{
+    size_t count;
+    money_t total;
+    money_t minimum;
+    money_t maximum;
+    size_t atLeast[BULK_THRESHOLDS];
+} StatsPartial;
+
+static int activeKernel = BULK_KERNEL_AUTO;
+
+/* ---- Scalar kernels: the reference results and the loop tails ---- */
+
+static void statsScalar(const money_t *balances, size_t count, StatsPartial *p)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        money_t b = balances[i];
+        p->total += b;
+        if (b < p->minimum)
+            p->minimum = b;
+        if (b > p->maximum)
+            p->maximum = b;
+        for (int k = 0; k < BULK_THRESHOLDS; k++)
+            p->atLeast[k] += b >= thresholds[k];
+    }
+    p->count += count;
+}
+
+/**
+ * @brief Interest on one balance: round(balance * rate / 2^32), split into
+ *        32-bit halves exactly as the vector kernels compute it, and capped
+ *        so that the new balance still fits
+ */
+static money_t interestOf(money_t balance, uint32_t rate)
+{
+    if (balance <= 0)
+        return 0;
+    uint64_t b = (uint64_t)balance;
+    uint64_t high = (b >> 32) * rate;
+    uint64_t low = ((b & 0xffffffffu) * rate + (1u << 31)) >> 32;
+    money_t interest = (money_t)(high + low);
+    return interest > INT64_MAX - balance ? INT64_MAX - balance : interest;
+}
+
+/**
+ * @brief Sum of two non-negative amounts, saturating at INT64_MAX; the
+ *        result does not depend on the order of the additions
+ */
+static money_t addCapped(money_t a, money_t b)
+{
+    return a > INT64_MAX - b ? INT64_MAX : a + b;
+}
+
+static money_t interestScalar(money_t *balances, size_t count, uint32_t rate)
+{
+    money_t credited = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        money_t interest = interestOf(balances[i], rate);
+        balances[i] += interest;
+        credited = addCapped(credited, interest);
+    }
+    return credited;
+}
+
+static money_t feeScalar(money_t *balances, size_t count, money_t fee)
+{
+    money_t charged = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        money_t b = balances[i];
+        money_t charge = b <= 0 ? 0 : (b < fee ? b : fee);
+        balances[i] = b - charge;
+        charged += charge;
+    }
+    return charged;
+}
+
+#ifdef BULK_HAVE_X86
+
+/* ---- AVX2 kernels: four balances per instruction ---- */
+
+__attribute__((target("avx2"))) static money_t sumLanes256(__m256i v)
+{
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, v);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+__attribute__((target("avx2"))) static money_t sumCapped256(__m256i v)
+{
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, v);
+    return addCapped(addCapped(lanes[0], lanes[1]), addCapped(lanes[2], lanes[3]));
+}
+
+__attribute__((target("avx2"))) static void statsAvx2(const money_t *balances, size_t count, StatsPartial *p)
+{
+    __m256i total = _mm256_setzero_si256();
+    __m256i minimum = _mm256_set1_epi64x(p->minimum);
+    __m256i maximum = _mm256_set1_epi64x(p->maximum);
+    __m256i atLeast[BULK_THRESHOLDS];
+    size_t i = 0;
+
+    for (int k = 0; k < BULK_THRESHOLDS; k++)
+        atLeast[k] = _mm256_setzero_si256();
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(balances + i));
+        total = _mm256_add_epi64(total, v);
+        minimum = _mm256_blendv_epi8(minimum, v, _mm256_cmpgt_epi64(minimum, v));
+        maximum = _mm256_blendv_epi8(maximum, v, _mm256_cmpgt_epi64(v, maximum));
+        // A true comparison is all ones (-1), so subtracting it counts
+        for (int k = 0; k < BULK_THRESHOLDS; k++)
+            atLeast[k] = _mm256_sub_epi64(atLeast[k],
+                                          _mm256_cmpgt_epi64(v, _mm256_set1_epi64x(thresholds[k] - 1)));
+    }
+
+    int64_t lanes[4];
+    p->total += sumLanes256(total);
+    _mm256_storeu_si256((__m256i *)lanes, minimum);
+    for (int l = 0; l < 4; l++)
+        p->minimum = lanes[l] < p->minimum ? lanes[l] : p->minimum;
+    _mm256_storeu_si256((__m256i *)lanes, maximum);
+    for (int l = 0; l < 4; l++)
+        p->maximum = lanes[l] > p->maximum ? lanes[l] : p->maximum;
+    for (int k = 0; k < BULK_THRESHOLDS; k++)
+        p->atLeast[k] += (size_t)sumLanes256(atLeast[k]);
+    p->count += i;
+
+    statsScalar(balances + i, count - i, p);
+}
+
+__attribute__((target("avx2"))) static money_t interestAvx2(money_t *balances, size_t count, uint32_t rate)
+{
+    const __m256i r = _mm256_set1_epi64x(rate);
+    const __m256i half = _mm256_set1_epi64x(1LL << 31);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i largest = _mm256_set1_epi64x(INT64_MAX);
+    __m256i credited = zero;
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(balances + i));
+        __m256i high = _mm256_mul_epu32(_mm256_srli_epi64(v, 32), r);
+        __m256i low = _mm256_srli_epi64(_mm256_add_epi64(_mm256_mul_epu32(v, r), half), 32);
+        __m256i interest = _mm256_add_epi64(high, low);
+        __m256i room = _mm256_sub_epi64(largest, v);
+        interest = _mm256_blendv_epi8(interest, room, _mm256_cmpgt_epi64(interest, room));
+        interest = _mm256_and_si256(interest, _mm256_cmpgt_epi64(v, zero));
+        _mm256_storeu_si256((__m256i *)(balances + i), _mm256_add_epi64(v, interest));
+        // Both terms are non-negative, so a negative sum has overflowed
+        credited = _mm256_add_epi64(credited, interest);
+        credited = _mm256_blendv_epi8(credited, largest, _mm256_cmpgt_epi64(zero, credited));
+    }
+
+    return addCapped(sumCapped256(credited), interestScalar(balances + i, count - i, rate));
+}
+
+__attribute__((target("avx2"))) static money_t feeAvx2(money_t *balances, size_t count, money_t fee)
+{
+    const __m256i f = _mm256_set1_epi64x(fee);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i charged = zero;
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(balances + i));
+        __m256i charge = _mm256_blendv_epi8(f, v, _mm256_cmpgt_epi64(f, v));
+        charge = _mm256_and_si256(charge, _mm256_cmpgt_epi64(v, zero));
+        _mm256_storeu_si256((__m256i *)(balances + i), _mm256_sub_epi64(v, charge));
+        charged = _mm256_add_epi64(charged, charge);
+    }
+
+    return sumLanes256(charged) + feeScalar(balances + i, count - i, fee);
+}
+
+/* ---- SSE4.2 kernels: two balances per instruction ---- */
+
+__attribute__((target("sse4.2"))) static money_t sumLanes128(__m128i v)
+{
+    int64_t lanes[2];
+    _mm_storeu_si128((__m128i *)lanes, v);
+    return lanes[0] + lanes[1];
+}
+
+__attribute__((target("sse4.2"))) static money_t sumCapped128(__m128i v)
+{
+    int64_t lanes[2];
+    _mm_storeu_si128((__m128i *)lanes, v);
+    return addCapped(lanes[0], lanes[1]);
+}
+
+__attribute__((target("sse4.2"))) static void statsSse(const money_t *balances, size_t count, StatsPartial *p)
+{
+    __m128i total = _mm_setzero_si128();
+    __m128i minimum = _mm_set1_epi64x(p->minimum);
+    __m128i maximum = _mm_set1_epi64x(p->maximum);
+    __m128i atLeast[BULK_THRESHOLDS];
+    size_t i = 0;
+
+    for (int k = 0; k < BULK_THRESHOLDS; k++)
+        atLeast[k] = _mm_setzero_si128();
+
+    for (; i + 2 <= count; i += 2)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(balances + i));
+        total = _mm_add_epi64(total, v);
+        minimum = _mm_blendv_epi8(minimum, v, _mm_cmpgt_epi64(minimum, v));
+        maximum = _mm_blendv_epi8(maximum, v, _mm_cmpgt_epi64(v, maximum));
+        for (int k = 0; k < BULK_THRESHOLDS; k++)
+            atLeast[k] = _mm_sub_epi64(atLeast[k], _mm_cmpgt_epi64(v, _mm_set1_epi64x(thresholds[k] - 1)));
+    }
+
+    int64_t lanes[2];
+    p->total += sumLanes128(total);
+    _mm_storeu_si128((__m128i *)lanes, minimum);
+    for (int l = 0; l < 2; l++)
+        p->minimum = lanes[l] < p->minimum ? lanes[l] : p->minimum;
+    _mm_storeu_si128((__m128i *)lanes, maximum);
+    for (int l = 0; l < 2; l++)
+        p->maximum = lanes[l] > p->maximum ? lanes[l] : p->maximum;
+    for (int k = 0; k < BULK_THRESHOLDS; k++)
+        p->atLeast[k] += (size_t)sumLanes128(atLeast[k]);
+    p->count += i;
+
+    statsScalar(balances + i, count - i, p);
+}
+
+__attribute__((target("sse4.2"))) static money_t interestSse(money_t *balances, size_t count, uint32_t rate)
+{
+    const __m128i r = _mm_set1_epi64x(rate);
+    const __m128i half = _mm_set1_epi64x(1LL << 31);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i largest = _mm_set1_epi64x(INT64_MAX);
+    __m128i credited = zero;
+    size_t i = 0;
+
+    for (; i + 2 <= count; i += 2)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(balances + i));
+        __m128i high = _mm_mul_epu32(_mm_srli_epi64(v, 32), r);
+        __m128i low = _mm_srli_epi64(_mm_add_epi64(_mm_mul_epu32(v, r), half), 32);
+        __m128i interest = _mm_add_epi64(high, low);
+        __m128i room = _mm_sub_epi64(largest, v);
+        interest = _mm_blendv_epi8(interest, room, _mm_cmpgt_epi64(interest, room));
+        interest = _mm_and_si128(interest, _mm_cmpgt_epi64(v, zero));
+        _mm_storeu_si128((__m128i *)(balances + i), _mm_add_epi64(v, interest));
+        credited = _mm_add_epi64(credited, interest);
+        credited = _mm_blendv_epi8(credited, largest, _mm_cmpgt_epi64(zero, credited));
+    }
+
+    return addCapped(sumCapped128(credited), interestScalar(balances + i, count - i, rate));
+}
+
+__attribute__((target("sse4.2"))) static money_t feeSse(money_t *balances, size_t count, money_t fee)
+{
+    const __m128i f = _mm_set1_epi64x(fee);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i charged = zero;
+    size_t i = 0;
+
+    for (; i + 2 <= count; i += 2)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(balances + i));
+        __m128i charge = _mm_blendv_epi8(f, v, _mm_cmpgt_epi64(f, v));
+        charge = _mm_and_si128(charge, _mm_cmpgt_epi64(v, zero));
+        _mm_storeu_si128((__m128i *)(balances + i), _mm_sub_epi64(v, charge));
+        charged = _mm_add_epi64(charged, charge);
+    }
+
+    return sumLanes128(charged) + feeScalar(balances + i, count - i, fee);
+}
+
+#endif // BULK_HAVE_X86
+
+/**
+ * @brief Checks whether this CPU can run a kernel
+ */
+static int kernelSupported(int kernel)
+{
+    if (kernel == BULK_KERNEL_SCALAR)
+        return 1;
+#ifdef BULK_HAVE_X86
+    __builtin_cpu_init();
+    if (kernel == BULK_KERNEL_AVX2)
+        return __builtin_cpu_supports("avx2");
+    if (kernel == BULK_KERNEL_SSE)
+        return __builtin_cpu_supports("sse4.2");
+#endif
+    return 0;
+}
+
+/**
+ * @brief Selects the kernel used by the bulk passes
+ * @param kernel BULK_KERNEL_AUTO picks the widest one the CPU supports
+ * @return 1 on success, 0 if the CPU cannot run the requested kernel
+ */
+int bulkSetKernel(int kernel)
+{
+    if (kernel == BULK_KERNEL_AUTO)
+    {
+        activeKernel = kernelSupported(BULK_KERNEL_AVX2)  ? BULK_KERNEL_AVX2
+                       : kernelSupported(BULK_KERNEL_SSE) ? BULK_KERNEL_SSE
+                                                          : BULK_KERNEL_SCALAR;
+        return 1;
+    }
+    if (!kernelSupported(kernel))
+        return 0;
+    activeKernel = kernel;
+    return 1;
+}
+
+/**
+ * @brief Kernel the next pass will use, resolving the default on first use
+ */
+static int currentKernel()
+{
+    if (activeKernel == BULK_KERNEL_AUTO)
+        bulkSetKernel(BULK_KERNEL_AUTO);
+    return activeKernel;
+}
+
+/**
+ * @brief Names the selected kernel, for reports
+ */
+const char *bulkKernelName()
+{
+    switch (currentKernel())
+    {
+    case BULK_KERNEL_AVX2:
+        return "avx2";
+    case BULK_KERNEL_SSE:
+        return "sse4.2";
+    default:
+        return "scalar";
+    }
+}
+
+/**
+ * @brief Converts an interest rate in percent to the kernels' fixed point
+ * @param percent Rate per period, e.g. "1.25", from 0 up to (not including) 100
+ * @param rate Receives round(percent / 100 * 2^32)
+ * @return 1 on success, 0 if the text is not a valid rate
+ */
+int bulkParseRate(const char *percent, uint32_t *rate)
+{
+    char *end;
+    double value = strtod(percent, &end);
+    if (end == percent || *end != '\0' || !(value >= 0.0 && value < 100.0))
+        return 0;
+
+    double scaled = value / 100.0 * 4294967296.0;
+    *rate = scaled >= 4294967295.0 ? 0xffffffffu : (uint32_t)llround(scaled);
+    return 1;
+}
+
+/**
+ * @brief Computes sum, minimum, maximum and a decade histogram of balances
+ * @param balances Balance column
+ * @param count Number of balances
+ * @param stats Receives the statistics; minimum and maximum are 0 when empty
+ */
+void bulkStats(const money_t *balances, size_t count, BulkStats *stats)
+{
+    StatsPartial p;
+    memset(&p, 0, sizeof(p));
+    p.minimum = INT64_MAX;
+    p.maximum = INT64_MIN;
+
+    switch (currentKernel())
+    {
+#ifdef BULK_HAVE_X86
+    case BULK_KERNEL_AVX2:
+        statsAvx2(balances, count, &p);
+        break;
+    case BULK_KERNEL_SSE:
+        statsSse(balances, count, &p);
+        break;
+#endif
+    default:
+        statsScalar(balances, count, &p);
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    stats->count = p.count;
+    stats->total = p.total;
+    stats->minimum = count ? p.minimum : 0;
+    stats->maximum = count ? p.maximum : 0;
+    stats->histogram[0] = p.count - p.atLeast[0];
+    for (int k = 1; k < BULK_THRESHOLDS; k++)
+        stats->histogram[k] = p.atLeast[k - 1] - p.atLeast[k];
+    stats->histogram[BULK_THRESHOLDS] = p.atLeast[BULK_THRESHOLDS - 1];
+}
+
+/**
+ * @brief Credits interest to every positive balance
+ * @param balances Balance column, updated in place
+ * @param count Number of balances
+ * @param rate Rate per period as a fraction of 2^32 (see bulkParseRate())
+ * @return Total interest credited, capped at INT64_MAX
+ */
+money_t bulkApplyInterest(money_t *balances, size_t count, uint32_t rate)
+{
+    switch (currentKernel())
+    {
+#ifdef BULK_HAVE_X86
+    case BULK_KERNEL_AVX2:
+        return interestAvx2(balances, count, rate);
+    case BULK_KERNEL_SSE:
+        return interestSse(balances, count, rate);
+#endif
+    default:
+        return interestScalar(balances, count, rate);
+    }
+}
+
+/**
+ * @brief Charges a flat fee to every positive balance, never below zero
+ * @param balances Balance column, updated in place
+ * @param count Number of balances
+ * @param fee Fee per account in minor units, must be positive
+ * @return Total fees charged
+ */
+money_t bulkApplyFee(money_t *balances, size_t count, money_t fee)
+{
+    switch (currentKernel())
+    {
+#ifdef BULK_HAVE_X86
+    case BULK_KERNEL_AVX2:
+        return feeAvx2(balances, count, fee);
+    case BULK_KERNEL_SSE:
+        return feeSse(balances, count, fee);
+#endif
+    default:
+        return feeScalar(balances, count, fee);
+    }
+}
+
+/**
+ * @brief Seconds elapsed since a starting point
+ */
+static double secondsSince(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/**
+ * @brief Prints the statistics of a balance column
+ */
+static void printStats(const BulkStats *stats)
+{
+    char a[24], b[24], c[24];
+
+    printf("Accounts: %zu  Total: %s  Min: %s  Max: %s\n", stats->count,
+           formatMoney(stats->total, a, sizeof(a)), formatMoney(stats->minimum, b, sizeof(b)),
+           formatMoney(stats->maximum, c, sizeof(c)));
+    printf("%26s %12s\n", "balance range", "accounts");
+    printf("%26s %12zu\n", "below 1.00", stats->histogram[0]);
+    for (int k = 1; k < BULK_THRESHOLDS; k++)
+    {
+        char range[40];
+        snprintf(range, sizeof(range), "%s - %s", formatMoney(thresholds[k - 1], a, sizeof(a)),
+                 formatMoney(thresholds[k] - 1, b, sizeof(b)));
+        printf("%26s %12zu\n", range, stats->histogram[k]);
+    }
+    snprintf(c, sizeof(c), "%s and up", formatMoney(thresholds[BULK_THRESHOLDS - 1], a, sizeof(a)));
+    printf("%26s %12zu\n", c, stats->histogram[BULK_THRESHOLDS]);
+}
+
+/**
+ * @brief Runs a bulk job over every account of the open database
+ * @param job "stats", "interest" (argument: percent per period) or
+ *        "fee" (argument: amount per account)
+ * @param argument Parameter of the job, NULL for "stats"
+ * @return 1 on success, 0 on failure
+ */
+int runBulkJob(const char *job, const char *argument)
+{
+    uint32_t rate = 0;
+    money_t fee = 0;
+    int interest = strcmp(job, "interest") == 0;
+    int charge = strcmp(job, "fee") == 0;
+
+    if (!interest && !charge && strcmp(job, "stats") != 0)
+    {
+        fprintf(stderr, "Unknown bulk job %s\n", job);
+        return 0;
+    }
+    if ((interest && (!argument || !bulkParseRate(argument, &rate))) ||
+        (charge && (!argument || !parseMoney(argument, &fee) || fee <= 0)))
+    {
+        fprintf(stderr, "Invalid %s amount %s\n", job, argument ? argument : "(none)");
+        return 0;
+    }
+
+    AccountColumns columns;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (!columnsLoad(&columns))
+    {
+        fprintf(stderr, "Cannot load the accounts\n");
+        return 0;
+    }
+    printf("Loaded %zu accounts in %.3f s\n", columns.count, secondsSince(&start));
+
+    money_t *previous = NULL;
+    if (interest || charge)
+    {
+        previous = (money_t *)malloc((columns.count ? columns.count : 1) * sizeof(money_t));
+        if (!previous)
+        {
+            columnsFree(&columns);
+            return 0;
+        }
+        memcpy(previous, columns.balances, columns.count * sizeof(money_t));
+    }
+
+    BulkStats stats;
+    money_t moved = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (interest)
+        moved = bulkApplyInterest(columns.balances, columns.count, rate);
+    else if (charge)
+        moved = bulkApplyFee(columns.balances, columns.count, fee);
+    else
+        bulkStats(columns.balances, columns.count, &stats);
+    double seconds = secondsSince(&start);
+
+    printf("%s pass over %zu records with the %s kernel: %.6f s (%.0f records/s, %.0f MB/s)\n", job,
+           columns.count, bulkKernelName(), seconds, seconds > 0 ? columns.count / seconds : 0.0,
+           seconds > 0 ? columns.count * sizeof(money_t) / seconds / 1e6 : 0.0);
+
+    int ok = 1;
+    if (previous)
+    {
+        char amount[24];
+        printf("%s %s\n", interest ? "Interest credited:" : "Fees charged:", formatMoney(moved, amount, sizeof(amount)));
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        ok = columnsStoreBalances(&columns, previous);
+        for (size_t i = 0; ok && i < columns.count; i++)
+            if (columns.balances[i] != previous[i])
+                ledgerAppend(columns.accountNumbers[i], interest ? LEDGER_INTEREST : LEDGER_FEE,
+                             columns.balances[i] - previous[i], columns.balances[i]);
+        ok = ok && ledgerFlush();
+        printf("Wrote changed balances back in %.3f s\n", secondsSince(&start));
+        if (!ok)
+            fprintf(stderr, "Cannot write the new balances\n");
+        free(previous);
+        bulkStats(columns.balances, columns.count, &stats);
+    }
+    printStats(&stats);
+
+    columnsFree(&columns);
+    return ok;
+}
@@ -0,0 +1,327 @@
+/**
+ * @file account_cache.c
+ * @brief Resident cache of account records keyed by record slot
+ *
+ * Recently used records are kept in memory so that repeated operations on
+ * hot accounts are served without reading the log or the record file. The
+ * cache is an open-addressing hash table (linear probing) of indices into
+ * a pool of entries that is allocated once, on first use; a hit or an
+ * update of a cached record therefore never touches the heap. When the
+ * pool is full the CLOCK algorithm picks a victim: every entry has a
+ * reference bit set on access, and the clock hand clears bits until it
+ * finds an entry not used since its last sweep.
+ *
+ * Two write policies are supported:
+ * - CACHE_WRITE_THROUGH (default): every update is logged immediately and
+ *   the cache only holds clean copies, so durability is unchanged.
+ * - CACHE_WRITE_BACK: updates only mark the cached copy dirty. Dirty
+ *   records are logged when they are evicted or when the cache is flushed
+ *   (by bankCommit() and bankClose()), so repeated updates of a hot account
+ *   cost nothing until then, at the price of losing them in a crash.
+ *
+ * All functions are thread-safe; callers keep each slot's read-modify-write
+ * sequences serialised, as the engine's account stripes already do.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "bank_management_system.h"
+
+/** @brief Records cached when the capacity is never configured */
+#define CACHE_DEFAULT_CAPACITY 4096
+
+/**
+ * @struct CacheEntry
+ * @brief One cached record
+ */
+typedef struct
+{
+    Account account;
+    size_t slot;
+    unsigned char used;
+    unsigned char dirty;
+    unsigned char referenced;
+} CacheEntry;
+
+static CacheEntry *entries = NULL; /**< Pool of capacity entries */
+static uint32_t *table = NULL;     /**< Entry index plus one, zero if empty */
+static size_t capacity = CACHE_DEFAULT_CAPACITY;
+static size_t tableMask = 0;
+static size_t usedCount = 0;
+static size_t clockHand = 0;
+static int policy = CACHE_WRITE_THROUGH;
+static CacheStats counters;
+
+static pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Home bucket of a slot
+ */
+static size_t bucketFor(size_t slot)
+{
+    return (size_t)(((uint64_t)slot * 11400714819323198485ull) >> 32) & tableMask;
+}
+
+/**
+ * @brief Finds the bucket holding a slot, or the empty bucket where it belongs
+ */
+static size_t probe(size_t slot)
+{
+    size_t i = bucketFor(slot);
+    while (table[i] != 0 && entries[table[i] - 1].slot != slot)
+        i = (i + 1) & tableMask;
+    return i;
+}
+
+/**
+ * @brief Allocates the pool and table on first use; caller holds the lock
+ * @return 1 if the cache is usable, 0 if disabled or out of memory
+ */
+static int ensureAllocated()
+{
+    if (entries)
+        return 1;
+    if (capacity == 0)
+        return 0;
+
+    size_t buckets = 1;
+    while (buckets < capacity * 2)
+        buckets <<= 1;
+    entries = (CacheEntry *)calloc(capacity, sizeof(CacheEntry));
+    table = (uint32_t *)calloc(buckets, sizeof(uint32_t));
+    if (!entries || !table)
+    {
+        free(entries);
+        free(table);
+        entries = NULL;
+        table = NULL;
+        return 0;
+    }
+    tableMask = buckets - 1;
+    usedCount = 0;
+    clockHand = 0;
+    return 1;
+}
+
+/**
+ * @brief Removes a slot's bucket, shifting later entries of its probe run back
+ */
+static void removeBucket(size_t hole)
+{
+    size_t i = (hole + 1) & tableMask;
+    while (table[i] != 0)
+    {
+        size_t home = bucketFor(entries[table[i] - 1].slot);
+        // Move the entry into the hole unless its home lies after the hole
+        // in the wrapped run (hole, i]
+        if (((i - home) & tableMask) >= ((i - hole) & tableMask))
+        {
+            table[hole] = table[i];
+            hole = i;
+        }
+        i = (i + 1) & tableMask;
+    }
+    table[hole] = 0;
+}
+
+/**
+ * @brief Picks a free entry, evicting (and logging, if dirty) a victim
+ * @return Entry index, or -1 if a dirty victim could not be logged
+ */
+static long takeEntry()
+{
+    // Entries are only ever released by eviction, which reuses them at
+    // once, so until the pool is full the used entries are a prefix of it
+    if (usedCount < capacity)
+        return (long)usedCount;
+
+    for (;;)
+    {
+        CacheEntry *e = &entries[clockHand];
+        size_t index = clockHand;
+        clockHand = (clockHand + 1) % capacity;
+        if (e->referenced)
+        {
+            e->referenced = 0;
+            continue;
+        }
+
+        if (e->dirty)
+        {
+            if (!walAppend(e->slot, &e->account))
+                return -1;
+            counters.writeBacks++;
+        }
+        removeBucket(probe(e->slot));
+        e->used = 0;
+        e->dirty = 0;
+        usedCount--;
+        counters.evictions++;
+        return (long)index;
+    }
+}
+
+/**
+ * @brief Sets the cache size and write policy
+ * @param size Records to keep resident; 0 disables the cache
+ * @param writePolicy CACHE_WRITE_THROUGH or CACHE_WRITE_BACK
+ * @return 1 on success, 0 if dirty records could not be logged first
+ *
+ * Dirty records are flushed and the cache emptied; the new pool is
+ * allocated on next use. Hit and miss counters restart from zero.
+ */
+int cacheConfigure(size_t size, int writePolicy)
+{
+    if (!cacheFlush())
+        return 0;
+
+    pthread_mutex_lock(&cacheLock);
+    free(entries);
+    free(table);
+    entries = NULL;
+    table = NULL;
+    usedCount = 0;
+    capacity = size;
+    policy = writePolicy;
+    memset(&counters, 0, sizeof(counters));
+    pthread_mutex_unlock(&cacheLock);
+    return 1;
+}
+
+/**
+ * @brief Current write policy
+ */
+int cachePolicy()
+{
+    return policy;
+}
+
+/**
+ * @brief Looks a record up in the cache
+ * @return 1 on a hit (account filled in), 0 on a miss
+ */
+int cacheLookup(size_t slot, Account *account)
+{
+    int hit = 0;
+
+    pthread_mutex_lock(&cacheLock);
+    if (entries)
+    {
+        uint32_t i = table[probe(slot)];
+        if (i != 0)
+        {
+            entries[i - 1].referenced = 1;
+            *account = entries[i - 1].account;
+            hit = 1;
+        }
+    }
+    if (hit)
+        counters.hits++;
+    else
+        counters.misses++;
+    pthread_mutex_unlock(&cacheLock);
+    return hit;
+}
+
+/**
+ * @brief Caches the current version of a record
+ * @param slot Record slot
+ * @param account Record contents
+ * @param dirty Non-zero if the version has not been logged yet
+ * @return 1 on success, 0 if a dirty record could not be kept or logged
+ */
+int cacheStore(size_t slot, const Account *account, int dirty)
+{
+    int ok = 1;
+
+    pthread_mutex_lock(&cacheLock);
+    if (ensureAllocated())
+    {
+        size_t bucket = probe(slot);
+        long index = table[bucket] ? (long)table[bucket] - 1 : -1;
+        if (index < 0)
+        {
+            index = takeEntry();
+            if (index >= 0)
+            {
+                bucket = probe(slot); // Eviction may have shifted the run
+                table[bucket] = (uint32_t)index + 1;
+                entries[index].slot = slot;
+                entries[index].used = 1;
+                entries[index].dirty = 0;
+                usedCount++;
+            }
+        }
+        if (index >= 0)
+        {
+            CacheEntry *e = &entries[index];
+            e->account = *account;
+            e->dirty |= dirty != 0;
+            e->referenced = 1;
+        }
+        else
+            ok = !dirty;
+    }
+    else
+        ok = !dirty;
+    pthread_mutex_unlock(&cacheLock);
+    return ok;
+}
+
+/**
+ * @brief Logs every dirty record (without committing the log)
+ * @return 1 on success, 0 if a record could not be logged
+ */
+int cacheFlush()
+{
+    int ok = 1;
+
+    pthread_mutex_lock(&cacheLock);
+    for (size_t i = 0; entries && i < capacity; i++)
+    {
+        CacheEntry *e = &entries[i];
+        if (e->used && e->dirty)
+        {
+            if (!walAppend(e->slot, &e->account))
+            {
+                ok = 0;
+                break;
+            }
+            e->dirty = 0;
+            counters.writeBacks++;
+        }
+    }
+    pthread_mutex_unlock(&cacheLock);
+    return ok;
+}
+
+/**
+ * @brief Forgets every cached record, dirty or not
+ *
+ * Used when the database is closed, after cacheFlush().
+ */
+void cacheClear()
+{
+    pthread_mutex_lock(&cacheLock);
+    if (entries)
+    {
+        memset(entries, 0, capacity * sizeof(CacheEntry));
+        memset(table, 0, (tableMask + 1) * sizeof(uint32_t));
+    }
+    usedCount = 0;
+    clockHand = 0;
+    pthread_mutex_unlock(&cacheLock);
+}
+
+/**
+ * @brief Reads the cache counters
+ */
+void cacheGetStats(CacheStats *stats)
+{
+    pthread_mutex_lock(&cacheLock);
+    *stats = counters;
+    stats->entries = usedCount;
+    stats->capacity = capacity;
+    pthread_mutex_unlock(&cacheLock);
+}
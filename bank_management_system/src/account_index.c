@@ -0,0 +1,493 @@
+/**
+ * @file account_index.c
+ * @brief Persistent hash index mapping account numbers to record slots
+ *
+ * The index is an open-addressing hash table with linear probing. The whole
+ * table lives in memory for O(1) lookups; removals shift later entries of
+ * the probe run back, so no deleted markers accumulate.
+ *
+ * The index also keeps the free-slot list: the slots of closed accounts
+ * (tombstones), handed out lowest first so that new accounts fill the front
+ * of the data file and the live records stay dense.
+ *
+ * Both are saved to a sidecar file when the database is closed, and the
+ * file is marked as in use while it is open. An index left in use by a
+ * crash, covering a different number of records than the data file (one
+ * edited behind its back) or unreadable is rebuilt from the records on open.
+ *
+ * Lookups may run concurrently from several threads; changes take the
+ * table exclusively.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "bank_management_system.h"
+
+/** @brief Identifies an index file and its on-disk layout version */
+#define INDEX_MAGIC "BANKIDX2"
+
+/** @brief Smallest table ever allocated (must be a power of two) */
+#define INDEX_MIN_CAPACITY 1024
+
+/** @brief Records read per batch while rebuilding */
+#define INDEX_REBUILD_BATCH 4096
+
+/**
+ * @struct IndexHeader
+ * @brief Fixed header at the start of the index file
+ */
+typedef struct
+{
+    char magic[8];
+    uint32_t capacity;    /**< Number of buckets, always a power of two */
+    uint32_t count;       /**< Number of occupied buckets */
+    uint64_t recordCount; /**< Data file records covered by this index */
+    uint32_t freeCount;   /**< Free slots stored after the buckets */
+    uint32_t clean;       /**< Non-zero if saved by a clean close */
+} IndexHeader;
+
+/**
+ * @struct IndexBucket
+ * @brief One hash table entry; slot is stored plus one so zero means empty
+ */
+typedef struct
+{
+    int32_t accountNumber;
+    uint32_t slot;
+} IndexBucket;
+
+static FILE *indexFile = NULL;
+static IndexHeader header;
+static IndexBucket *buckets = NULL;
+
+/** @brief Min-heap of free record slots */
+static uint32_t *freeSlots = NULL;
+static size_t freeCount = 0;
+static size_t freeCapacity = 0;
+
+/** @brief Shared for lookups, exclusive for inserts */
+static pthread_rwlock_t indexLock = PTHREAD_RWLOCK_INITIALIZER;
+
+/**
+ * @brief Fibonacci hash of an account number onto the current table
+ */
+static uint32_t bucketFor(int accountNumber)
+{
+    return ((uint32_t)accountNumber * 2654435769u) & (header.capacity - 1);
+}
+
+/**
+ * @brief Finds the bucket holding a key, or the empty bucket where it belongs
+ */
+static uint32_t probe(int accountNumber)
+{
+    uint32_t i = bucketFor(accountNumber);
+    while (buckets[i].slot != 0 && buckets[i].accountNumber != accountNumber)
+        i = (i + 1) & (header.capacity - 1);
+    return i;
+}
+
+/**
+ * @brief Writes the header and the full bucket array to the sidecar file
+ * @return 1 on success, 0 on failure
+ */
+static int writeAll()
+{
+    if (fseek(indexFile, 0, SEEK_SET) != 0)
+        return 0;
+    if (fwrite(&header, sizeof(header), 1, indexFile) != 1)
+        return 0;
+    if (fwrite(buckets, sizeof(IndexBucket), header.capacity, indexFile) != header.capacity)
+        return 0;
+    if (fwrite(freeSlots, sizeof(uint32_t), freeCount, indexFile) != freeCount)
+        return 0;
+    return fflush(indexFile) == 0;
+}
+
+/**
+ * @brief Rewrites just the header, e.g. to mark the file clean or in use
+ * @return 1 on success, 0 on failure
+ */
+static int writeHeader()
+{
+    return fseek(indexFile, 0, SEEK_SET) == 0 &&
+           fwrite(&header, sizeof(header), 1, indexFile) == 1 &&
+           fflush(indexFile) == 0;
+}
+
+/**
+ * @brief Replaces the in-memory table with an empty one of the given size
+ * @return 1 on success, 0 if out of memory
+ */
+static int allocateTable(uint32_t capacity)
+{
+    IndexBucket *table = (IndexBucket *)calloc(capacity, sizeof(IndexBucket));
+    if (!table)
+        return 0;
+
+    free(buckets);
+    buckets = table;
+    memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+    header.capacity = capacity;
+    header.count = 0;
+    return 1;
+}
+
+/**
+ * @brief Smallest power-of-two capacity keeping the load factor under 70%
+ */
+static uint32_t capacityFor(size_t entries)
+{
+    uint32_t capacity = INDEX_MIN_CAPACITY;
+    while ((size_t)capacity * 7 < entries * 10)
+        capacity <<= 1;
+    return capacity;
+}
+
+/**
+ * @brief Places a key in the in-memory table
+ * @return 1 on success, 0 if the key was already present
+ */
+static int placeKey(int accountNumber, size_t slot)
+{
+    uint32_t i = probe(accountNumber);
+    if (buckets[i].slot != 0)
+        return 0;
+
+    buckets[i].accountNumber = accountNumber;
+    buckets[i].slot = (uint32_t)slot + 1;
+    header.count++;
+    return 1;
+}
+
+/**
+ * @brief Doubles the in-memory table
+ * @return 1 on success, 0 if out of memory
+ */
+static int grow()
+{
+    IndexBucket *old = buckets;
+    uint32_t oldCapacity = header.capacity;
+
+    buckets = NULL;
+    if (!allocateTable(oldCapacity * 2))
+    {
+        buckets = old;
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < oldCapacity; i++)
+        if (old[i].slot != 0)
+            placeKey(old[i].accountNumber, old[i].slot - 1);
+    free(old);
+    return 1;
+}
+
+/**
+ * @brief Adds a slot to the free-slot heap; caller holds the lock
+ * @return 1 on success, 0 if out of memory
+ */
+static int pushFree(uint32_t slot)
+{
+    if (freeCount == freeCapacity)
+    {
+        size_t capacity = freeCapacity ? freeCapacity * 2 : 256;
+        uint32_t *grown = (uint32_t *)realloc(freeSlots, capacity * sizeof(uint32_t));
+        if (!grown)
+            return 0;
+        freeSlots = grown;
+        freeCapacity = capacity;
+    }
+
+    size_t i = freeCount++;
+    while (i > 0 && freeSlots[(i - 1) / 2] > slot)
+    {
+        freeSlots[i] = freeSlots[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    freeSlots[i] = slot;
+    return 1;
+}
+
+/**
+ * @brief Removes the lowest free slot from the heap; caller holds the lock
+ */
+static uint32_t popFree()
+{
+    uint32_t lowest = freeSlots[0];
+    uint32_t last = freeSlots[--freeCount];
+    size_t i = 0;
+
+    for (;;)
+    {
+        size_t child = 2 * i + 1;
+        if (child >= freeCount)
+            break;
+        if (child + 1 < freeCount && freeSlots[child + 1] < freeSlots[child])
+            child++;
+        if (freeSlots[child] >= last)
+            break;
+        freeSlots[i] = freeSlots[child];
+        i = child;
+    }
+    if (freeCount > 0)
+        freeSlots[i] = last;
+    return lowest;
+}
+
+/**
+ * @brief Loads a saved index, unless it is stale or unreadable
+ * @return 1 if the index was loaded, 0 if it must be rebuilt
+ */
+static int loadSaved(size_t recordCount)
+{
+    int valid = fread(&header, sizeof(header), 1, indexFile) == 1 &&
+                memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)) == 0 &&
+                header.capacity >= INDEX_MIN_CAPACITY &&
+                (header.capacity & (header.capacity - 1)) == 0 &&
+                header.clean && header.recordCount == recordCount &&
+                header.freeCount <= recordCount;
+    if (!valid)
+        return 0;
+
+    buckets = (IndexBucket *)malloc(header.capacity * sizeof(IndexBucket));
+    freeCapacity = header.freeCount ? header.freeCount : 1;
+    freeSlots = (uint32_t *)malloc(freeCapacity * sizeof(uint32_t));
+    freeCount = header.freeCount;
+    return buckets && freeSlots &&
+           fread(buckets, sizeof(IndexBucket), header.capacity, indexFile) == header.capacity &&
+           fread(freeSlots, sizeof(uint32_t), freeCount, indexFile) == freeCount;
+}
+
+/**
+ * @brief Opens the index, rebuilding it if it is missing or stale
+ * @param path Location of the sidecar index file
+ * @param recordCount Number of records currently in the data file
+ * @return 1 on success, 0 on failure
+ */
+int indexOpen(const char *path, size_t recordCount)
+{
+    indexClose();
+
+    indexFile = fopen(path, "r+b");
+    if (!indexFile)
+        indexFile = fopen(path, "w+b");
+    if (!indexFile)
+        return 0;
+
+    if (!loadSaved(recordCount))
+    {
+        free(buckets);
+        free(freeSlots);
+        buckets = NULL;
+        freeSlots = NULL;
+        freeCount = freeCapacity = 0;
+        if (!indexRebuild(recordCount))
+            return 0;
+    }
+
+    // Until the clean close rewrites it, the saved copy is out of date
+    header.clean = 0;
+    return writeHeader();
+}
+
+/**
+ * @brief Saves the index and free-slot list, then closes the sidecar file
+ *
+ * Must run before the data file is closed: the saved index records how
+ * many records the data file holds.
+ */
+void indexClose()
+{
+    if (indexFile)
+    {
+        header.recordCount = storeRecordCount();
+        header.freeCount = (uint32_t)freeCount;
+        header.clean = 1;
+        if (!writeAll() || ftruncate(fileno(indexFile), ftell(indexFile)) != 0)
+            perror("accounts: index");
+        fclose(indexFile);
+        indexFile = NULL;
+    }
+    free(buckets);
+    free(freeSlots);
+    buckets = NULL;
+    freeSlots = NULL;
+    freeCount = freeCapacity = 0;
+    memset(&header, 0, sizeof(header));
+}
+
+/**
+ * @brief Looks up the slot of an account
+ * @param accountNumber Key to search for
+ * @return Slot of the account's record, or -1 if the account does not exist
+ */
+long indexLookup(int accountNumber)
+{
+    long slot = -1;
+
+    pthread_rwlock_rdlock(&indexLock);
+    if (buckets)
+    {
+        uint32_t i = probe(accountNumber);
+        slot = buckets[i].slot ? (long)buckets[i].slot - 1 : -1;
+    }
+    pthread_rwlock_unlock(&indexLock);
+    return slot;
+}
+
+/**
+ * @brief Records the slot of a new (or moved) account
+ * @param accountNumber Key of the record
+ * @param slot Slot the record was written to
+ * @return 1 on success, 0 on failure or duplicate key
+ */
+int indexInsert(int accountNumber, size_t slot)
+{
+    int ok = 0;
+
+    pthread_rwlock_wrlock(&indexLock);
+    if (buckets && ((size_t)(header.count + 1) * 10 <= (size_t)header.capacity * 7 || grow()))
+        ok = placeKey(accountNumber, slot);
+    pthread_rwlock_unlock(&indexLock);
+    return ok;
+}
+
+/**
+ * @brief Forgets an account, e.g. once it has been closed
+ * @param accountNumber Key to remove
+ * @return 1 if the key was present, 0 otherwise
+ */
+int indexRemove(int accountNumber)
+{
+    int found = 0;
+
+    pthread_rwlock_wrlock(&indexLock);
+    if (buckets)
+    {
+        uint32_t mask = header.capacity - 1;
+        uint32_t hole = probe(accountNumber);
+        found = buckets[hole].slot != 0;
+        if (found)
+        {
+            // Shift back every later entry of the run whose home bucket
+            // does not lie after the hole
+            for (uint32_t i = (hole + 1) & mask; buckets[i].slot != 0; i = (i + 1) & mask)
+            {
+                uint32_t home = bucketFor(buckets[i].accountNumber);
+                if (((i - home) & mask) >= ((i - hole) & mask))
+                {
+                    buckets[hole] = buckets[i];
+                    hole = i;
+                }
+            }
+            buckets[hole].slot = 0;
+            buckets[hole].accountNumber = 0;
+            header.count--;
+        }
+    }
+    pthread_rwlock_unlock(&indexLock);
+    return found;
+}
+
+/**
+ * @brief Rebuilds the index and free-slot list from the data file
+ * @param recordCount Number of records currently in the data file
+ * @return 1 on success, 0 on failure
+ *
+ * If the data file holds the same account number twice, the first record
+ * wins, matching what a front-to-back scan of the file would have found.
+ * Closed accounts' slots become free slots.
+ */
+int indexRebuild(size_t recordCount)
+{
+    Account *batch = (Account *)malloc(INDEX_REBUILD_BATCH * sizeof(Account));
+    if (!batch || !allocateTable(capacityFor(recordCount)))
+    {
+        free(batch);
+        return 0;
+    }
+    freeCount = 0;
+
+    int ok = 1;
+    size_t slot = 0;
+    while (ok && slot < recordCount)
+    {
+        size_t n = storeReadRecords(slot, batch, INDEX_REBUILD_BATCH);
+        if (n == 0)
+            break;
+        for (size_t k = 0; ok && k < n; k++)
+        {
+            if (batch[k].flags & ACCOUNT_CLOSED)
+                ok = pushFree((uint32_t)(slot + k));
+            else
+                placeKey(batch[k].accountNumber, slot + k);
+        }
+        slot += n;
+    }
+    free(batch);
+
+    header.recordCount = recordCount;
+    return ok;
+}
+
+/**
+ * @brief Adds the slot of a closed account to the free-slot list
+ * @return 1 on success, 0 if out of memory
+ */
+int indexReleaseSlot(size_t slot)
+{
+    pthread_rwlock_wrlock(&indexLock);
+    int ok = pushFree((uint32_t)slot);
+    pthread_rwlock_unlock(&indexLock);
+    return ok;
+}
+
+/**
+ * @brief Takes the lowest free slot for reuse
+ * @param below Only slots lower than this are taken
+ * @return The slot, or -1 if there is no such free slot
+ */
+long indexTakeFreeSlot(size_t below)
+{
+    long slot = -1;
+
+    pthread_rwlock_wrlock(&indexLock);
+    if (freeCount > 0 && freeSlots[0] < below)
+        slot = (long)popFree();
+    pthread_rwlock_unlock(&indexLock);
+    return slot;
+}
+
+/**
+ * @brief Returns the number of free slots
+ */
+size_t indexFreeCount()
+{
+    pthread_rwlock_rdlock(&indexLock);
+    size_t count = freeCount;
+    pthread_rwlock_unlock(&indexLock);
+    return count;
+}
+
+/**
+ * @brief Drops free slots at or beyond the end of a shortened data file
+ * @param recordCount Number of records the data file now holds
+ */
+void indexTruncate(size_t recordCount)
+{
+    pthread_rwlock_wrlock(&indexLock);
+    size_t kept = 0;
+    for (size_t i = 0; i < freeCount; i++)
+        if (freeSlots[i] < recordCount)
+            freeSlots[kept++] = freeSlots[i];
+    freeCount = 0;
+    for (size_t i = 0; i < kept; i++)
+        pushFree(freeSlots[i]);
+    header.recordCount = recordCount;
+    pthread_rwlock_unlock(&indexLock);
+}
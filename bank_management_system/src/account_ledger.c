@@ -0,0 +1,768 @@
+/**
+ * @file account_ledger.c
+ * @brief Append-only, per-account transaction history
+ *
+ * Every balance change is appended to the ledger as a fixed-size entry
+ * (timestamp, account, op, signed amount, resulting balance). Entries are
+ * numbered by a global sequence number and stored in segment files of a
+ * fixed number of entries, <db>.ledger-000000, <db>.ledger-000001, ...,
+ * so that entry n lives at a computable offset and appends only ever touch
+ * the newest segment.
+ *
+ * Two structures make the queries fast without scanning the history:
+ * - Each entry points to the previous entry of the same account, and the
+ *   newest entry of every account is kept in an in-memory hash table that
+ *   is saved to <db>.ledger-heads on close. "Last N" walks that chain.
+ * - Timestamps never decrease, and each segment keeps a sparse time index
+ *   (the timestamp of every LEDGER_TIME_STRIDE-th entry), so the sequence
+ *   range of a time window is found by binary search plus one block read.
+ *   The index is sampled from the segment when it is opened.
+ *
+ * A time-range query then either scans that sequence range, when it is
+ * short, or walks the account's chain back into it. A heads file left
+ * stale by a crash is detected by its entry count and rebuilt by one
+ * sequential pass over the segments.
+ *
+ * The ledger is an audit trail written next to the write-ahead log. Engine
+ * changes hand their entries to the log with the records they change; the
+ * group-commit leader records them with ledgerRecord() once the group is
+ * durable, and before any of its updates is acknowledged, so history is
+ * kept only for changes that committed. Batch runs record theirs the same
+ * way after their commit. Other appends are flushed with every
+ * bankCommit() and synced on close; a torn entry at the tail is dropped on
+ * open.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "bank_management_system.h"
+
+/** @brief Identifies a ledger segment file */
+#define LEDGER_MAGIC "BANKLED1"
+
+/** @brief Identifies the saved account heads */
+#define LEDGER_HEADS_MAGIC "BANKLHD1"
+
+/** @brief Entries per segment file (40 MiB of entries) */
+#define LEDGER_DEFAULT_SEGMENT_ENTRIES (1u << 20)
+
+/** @brief Entries between two samples of a segment's time index */
+#define LEDGER_TIME_STRIDE 256
+
+/** @brief Longest sequence range a time query scans instead of chain walking */
+#define LEDGER_SCAN_LIMIT 65536
+
+/** @brief Entries read per call while scanning */
+#define LEDGER_READ_BATCH 1024
+
+/**
+ * @struct SegmentHeader
+ * @brief Fixed 64-byte header at the start of each segment file
+ */
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t segmentEntries; /**< Capacity of every segment of this ledger */
+    uint64_t firstSequence;  /**< Sequence number of the segment's first entry */
+    char reserved[40];
+} SegmentHeader;
+
+/**
+ * @struct Segment
+ * @brief An open segment and its sparse time index
+ */
+typedef struct
+{
+    int fd;
+    size_t entries;
+    int64_t *samples; /**< Timestamp of entry k * LEDGER_TIME_STRIDE */
+    size_t sampleCount;
+    size_t sampleCapacity;
+} Segment;
+
+/**
+ * @struct HeadBucket
+ * @brief Newest entry of one account; last is the sequence number plus one
+ */
+typedef struct
+{
+    int32_t accountNumber;
+    uint32_t entries;
+    uint64_t last;
+} HeadBucket;
+
+/**
+ * @struct HeadsHeader
+ * @brief Header of the saved heads file
+ */
+typedef struct
+{
+    char magic[8];
+    uint64_t entryCount; /**< Ledger entries covered by the saved heads */
+    uint32_t capacity;
+    uint32_t count;
+} HeadsHeader;
+
+static char basePath[512];
+static Segment *segments = NULL;
+static size_t segmentCount = 0;
+static size_t segmentCapacity = 0;
+static FILE *activeFile = NULL; /**< Append stream on the newest segment */
+static uint32_t configuredSegmentEntries = LEDGER_DEFAULT_SEGMENT_ENTRIES;
+static uint32_t segmentEntries = LEDGER_DEFAULT_SEGMENT_ENTRIES;
+static uint64_t entryCount = 0;
+static int64_t lastTimestamp = 0;
+static HeadBucket *heads = NULL;
+static uint32_t headCapacity = 0;
+static uint32_t headCount = 0;
+
+static pthread_mutex_t ledgerLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* ---- Account heads ---- */
+
+static uint32_t headProbe(int accountNumber)
+{
+    uint32_t i = ((uint32_t)accountNumber * 2654435769u) & (headCapacity - 1);
+    while (heads[i].last != 0 && heads[i].accountNumber != accountNumber)
+        i = (i + 1) & (headCapacity - 1);
+    return i;
+}
+
+/**
+ * @brief Replaces the head table with an empty one
+ * @return 1 on success, 0 if out of memory
+ */
+static int headsReset(uint32_t capacity)
+{
+    HeadBucket *table = (HeadBucket *)calloc(capacity, sizeof(HeadBucket));
+    if (!table)
+        return 0;
+    free(heads);
+    heads = table;
+    headCapacity = capacity;
+    headCount = 0;
+    return 1;
+}
+
+/**
+ * @brief Finds an account's head, creating an empty one if needed
+ * @return The head, or NULL if out of memory
+ */
+static HeadBucket *headFor(int accountNumber)
+{
+    if ((size_t)(headCount + 1) * 10 > (size_t)headCapacity * 7)
+    {
+        HeadBucket *old = heads;
+        uint32_t oldCapacity = headCapacity;
+        heads = NULL;
+        if (!headsReset(oldCapacity * 2))
+        {
+            heads = old;
+            headCapacity = oldCapacity;
+            return NULL;
+        }
+        for (uint32_t i = 0; i < oldCapacity; i++)
+            if (old[i].last != 0)
+            {
+                heads[headProbe(old[i].accountNumber)] = old[i];
+                headCount++;
+            }
+        free(old);
+    }
+
+    HeadBucket *head = &heads[headProbe(accountNumber)];
+    if (head->last == 0)
+    {
+        head->accountNumber = accountNumber;
+        headCount++;
+    }
+    return head;
+}
+
+/**
+ * @brief Looks an account's head up without creating it
+ */
+static const HeadBucket *findHead(int accountNumber)
+{
+    const HeadBucket *head = &heads[headProbe(accountNumber)];
+    return head->last != 0 ? head : NULL;
+}
+
+static void headsPath(char *path, size_t size)
+{
+    snprintf(path, size, "%s-heads", basePath);
+}
+
+/**
+ * @brief Loads the saved heads if they cover exactly the current ledger
+ * @return 1 if loaded, 0 if missing or stale
+ */
+static int headsLoad()
+{
+    char path[600];
+    HeadsHeader header;
+    headsPath(path, sizeof(path));
+
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return 0;
+    int ok = fread(&header, sizeof(header), 1, file) == 1 &&
+             memcmp(header.magic, LEDGER_HEADS_MAGIC, sizeof(header.magic)) == 0 &&
+             header.entryCount == entryCount && header.capacity >= 1024 &&
+             (header.capacity & (header.capacity - 1)) == 0 && headsReset(header.capacity) &&
+             fread(heads, sizeof(HeadBucket), header.capacity, file) == header.capacity;
+    fclose(file);
+    if (ok)
+        headCount = header.count;
+    return ok;
+}
+
+/**
+ * @brief Saves the heads next to the segments
+ * @return 1 on success, 0 on failure
+ */
+static int headsSave()
+{
+    char path[600];
+    HeadsHeader header;
+    headsPath(path, sizeof(path));
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LEDGER_HEADS_MAGIC, sizeof(header.magic));
+    header.entryCount = entryCount;
+    header.capacity = headCapacity;
+    header.count = headCount;
+
+    FILE *file = fopen(path, "wb");
+    if (!file)
+        return 0;
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(heads, sizeof(HeadBucket), headCapacity, file) == headCapacity;
+    return fclose(file) == 0 && ok;
+}
+
+/* ---- Segments ---- */
+
+static void segmentPath(size_t index, char *path, size_t size)
+{
+    snprintf(path, size, "%s-%06zu", basePath, index);
+}
+
+/**
+ * @brief Reads consecutive entries that lie in one segment
+ * @return 1 on success, 0 on failure
+ */
+static int readEntries(uint64_t sequence, LedgerEntry *entries, size_t count)
+{
+    const Segment *segment = &segments[sequence / segmentEntries];
+    off_t offset = (off_t)sizeof(SegmentHeader) + (off_t)(sequence % segmentEntries) * sizeof(LedgerEntry);
+    size_t bytes = count * sizeof(LedgerEntry);
+    return pread(segment->fd, entries, bytes, offset) == (ssize_t)bytes;
+}
+
+/**
+ * @brief Adds a sample to a segment's time index
+ * @return 1 on success, 0 if out of memory
+ */
+static int addSample(Segment *segment, int64_t timestamp)
+{
+    if (segment->sampleCount == segment->sampleCapacity)
+    {
+        size_t capacity = segment->sampleCapacity ? segment->sampleCapacity * 2 : 64;
+        int64_t *samples = (int64_t *)realloc(segment->samples, capacity * sizeof(int64_t));
+        if (!samples)
+            return 0;
+        segment->samples = samples;
+        segment->sampleCapacity = capacity;
+    }
+    segment->samples[segment->sampleCount++] = timestamp;
+    return 1;
+}
+
+/**
+ * @brief Opens (or creates) a segment, trims a torn tail and samples its index
+ * @return 1 on success, 0 on failure
+ */
+static int openSegment(size_t index, int create)
+{
+    char path[600];
+    SegmentHeader header;
+    segmentPath(index, path, sizeof(path));
+
+    int fd = open(path, create ? O_RDWR | O_CREAT : O_RDWR, 0644);
+    if (fd < 0)
+        return 0;
+
+    off_t size = lseek(fd, 0, SEEK_END);
+    if (size < (off_t)sizeof(header))
+    {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, LEDGER_MAGIC, sizeof(header.magic));
+        header.version = 1;
+        header.segmentEntries = segmentEntries;
+        header.firstSequence = (uint64_t)index * segmentEntries;
+        if (ftruncate(fd, 0) != 0 || pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header))
+        {
+            close(fd);
+            return 0;
+        }
+        size = sizeof(header);
+    }
+    else if (pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+             memcmp(header.magic, LEDGER_MAGIC, sizeof(header.magic)) != 0 ||
+             header.firstSequence != (uint64_t)index * header.segmentEntries || header.segmentEntries == 0 ||
+             (index > 0 && header.segmentEntries != segmentEntries))
+    {
+        fprintf(stderr, "accounts: %s is not a ledger segment\n", path);
+        close(fd);
+        return 0;
+    }
+    if (index == 0)
+        segmentEntries = header.segmentEntries;
+
+    size_t entries = (size_t)(size - (off_t)sizeof(header)) / sizeof(LedgerEntry);
+    if (entries > segmentEntries)
+        entries = segmentEntries;
+    if ((off_t)(sizeof(header) + entries * sizeof(LedgerEntry)) != size &&
+        ftruncate(fd, (off_t)(sizeof(header) + entries * sizeof(LedgerEntry))) != 0)
+    {
+        close(fd);
+        return 0;
+    }
+
+    if (segmentCount == segmentCapacity)
+    {
+        size_t capacity = segmentCapacity ? segmentCapacity * 2 : 16;
+        Segment *grown = (Segment *)realloc(segments, capacity * sizeof(Segment));
+        if (!grown)
+        {
+            close(fd);
+            return 0;
+        }
+        segments = grown;
+        segmentCapacity = capacity;
+    }
+    Segment *segment = &segments[segmentCount++];
+    memset(segment, 0, sizeof(*segment));
+    segment->fd = fd;
+    segment->entries = entries;
+
+    LedgerEntry entry;
+    for (size_t k = 0; k < entries; k += LEDGER_TIME_STRIDE)
+    {
+        if (!readEntries((uint64_t)index * segmentEntries + k, &entry, 1) || !addSample(segment, entry.timestamp))
+            return 0;
+    }
+    if (entries > 0 && readEntries((uint64_t)index * segmentEntries + entries - 1, &entry, 1))
+        lastTimestamp = entry.timestamp;
+    return 1;
+}
+
+/**
+ * @brief Points the append stream at the newest segment
+ * @return 1 on success, 0 on failure
+ */
+static int openActive()
+{
+    char path[600];
+    if (activeFile)
+        fclose(activeFile);
+    segmentPath(segmentCount - 1, path, sizeof(path));
+    activeFile = fopen(path, "ab");
+    return activeFile != NULL;
+}
+
+/**
+ * @brief Rebuilds every account's head with one pass over the ledger
+ * @return 1 on success, 0 on failure
+ */
+static int headsRebuild()
+{
+    LedgerEntry *batch = (LedgerEntry *)malloc(LEDGER_READ_BATCH * sizeof(LedgerEntry));
+    if (!batch || !headsReset(1024))
+    {
+        free(batch);
+        return 0;
+    }
+
+    uint64_t sequence = 0;
+    while (sequence < entryCount)
+    {
+        uint64_t segmentEnd = (sequence / segmentEntries + 1) * (uint64_t)segmentEntries;
+        size_t n = LEDGER_READ_BATCH;
+        if (sequence + n > entryCount)
+            n = (size_t)(entryCount - sequence);
+        if (sequence + n > segmentEnd)
+            n = (size_t)(segmentEnd - sequence);
+        if (!readEntries(sequence, batch, n))
+        {
+            free(batch);
+            return 0;
+        }
+        for (size_t k = 0; k < n; k++)
+        {
+            HeadBucket *head = headFor(batch[k].accountNumber);
+            if (!head)
+            {
+                free(batch);
+                return 0;
+            }
+            head->entries++;
+            head->last = sequence + k + 1;
+        }
+        sequence += n;
+    }
+    free(batch);
+    return 1;
+}
+
+/**
+ * @brief Sets the segment size used when a new ledger is created
+ * @param entries Entries per segment file; existing ledgers keep theirs
+ */
+void ledgerSetSegmentSize(uint32_t entries)
+{
+    configuredSegmentEntries = entries ? entries : LEDGER_DEFAULT_SEGMENT_ENTRIES;
+}
+
+/**
+ * @brief Opens the ledger whose segments are named <path>-NNNNNN
+ * @param path Common prefix of the ledger files
+ * @return 1 on success, 0 on failure
+ */
+int ledgerOpen(const char *path)
+{
+    ledgerClose();
+
+    pthread_mutex_lock(&ledgerLock);
+    int ok = snprintf(basePath, sizeof(basePath), "%s", path) < (int)sizeof(basePath);
+    segmentEntries = configuredSegmentEntries;
+    entryCount = 0;
+    lastTimestamp = 0;
+
+    // Segments are numbered densely from zero; only the last may be partial
+    for (size_t index = 0; ok; index++)
+    {
+        char name[600];
+        segmentPath(index, name, sizeof(name));
+        if (access(name, F_OK) != 0)
+            break;
+        ok = openSegment(index, 0);
+        if (ok)
+            entryCount += segments[index].entries;
+        if (ok && segments[index].entries < segmentEntries)
+            break;
+    }
+    if (ok && segmentCount == 0)
+        ok = openSegment(0, 1);
+    else if (ok && segments[segmentCount - 1].entries == segmentEntries)
+        ok = openSegment(segmentCount, 1);
+    ok = ok && openActive() && (headsLoad() || headsRebuild());
+    pthread_mutex_unlock(&ledgerLock);
+
+    if (!ok)
+        ledgerClose();
+    return ok;
+}
+
+/**
+ * @brief Syncs the newest segment, saves the heads and closes the ledger
+ */
+void ledgerClose()
+{
+    pthread_mutex_lock(&ledgerLock);
+    if (activeFile)
+    {
+        fflush(activeFile);
+        fsync(fileno(activeFile));
+        fclose(activeFile);
+        activeFile = NULL;
+        if (heads && !headsSave())
+            perror("accounts: ledger heads");
+    }
+    for (size_t i = 0; i < segmentCount; i++)
+    {
+        close(segments[i].fd);
+        free(segments[i].samples);
+    }
+    free(segments);
+    free(heads);
+    segments = NULL;
+    heads = NULL;
+    segmentCount = segmentCapacity = 0;
+    headCapacity = headCount = 0;
+    entryCount = 0;
+    pthread_mutex_unlock(&ledgerLock);
+}
+
+/**
+ * @brief Appends one entry; caller holds ledgerLock
+ */
+static int appendLocked(int accountNumber, char op, money_t amount, money_t balance, int64_t timestamp)
+{
+    int ok = 0;
+
+    if (activeFile)
+    {
+        ok = 1;
+        if (segments[segmentCount - 1].entries == segmentEntries)
+        {
+            ok = fflush(activeFile) == 0 && openSegment(segmentCount, 1) && openActive();
+        }
+
+        HeadBucket *head = ok ? headFor(accountNumber) : NULL;
+        if (head)
+        {
+            LedgerEntry entry;
+            memset(&entry, 0, sizeof(entry));
+            entry.timestamp = timestamp > lastTimestamp ? timestamp : lastTimestamp;
+            entry.amount = amount;
+            entry.balance = balance;
+            entry.previous = head->last;
+            entry.accountNumber = accountNumber;
+            entry.op = op;
+
+            Segment *segment = &segments[segmentCount - 1];
+            ok = fwrite(&entry, sizeof(entry), 1, activeFile) == 1 &&
+                 (segment->entries % LEDGER_TIME_STRIDE != 0 || addSample(segment, entry.timestamp));
+            if (ok)
+            {
+                segment->entries++;
+                head->last = ++entryCount;
+                head->entries++;
+                lastTimestamp = entry.timestamp;
+            }
+        }
+        else
+            ok = 0;
+    }
+    return ok;
+}
+
+/**
+ * @brief Appends an entry with an explicit timestamp
+ * @param accountNumber Account the entry belongs to
+ * @param op LEDGER_* operation code
+ * @param amount Signed change of the balance
+ * @param balance Balance after the change
+ * @param timestamp Microseconds since the epoch; raised to the previous
+ *        entry's if earlier, so timestamps never decrease
+ * @return 1 on success, 0 on failure or if the ledger is not open
+ */
+int ledgerAppendAt(int accountNumber, char op, money_t amount, money_t balance, int64_t timestamp)
+{
+    pthread_mutex_lock(&ledgerLock);
+    int ok = appendLocked(accountNumber, op, amount, balance, timestamp);
+    pthread_mutex_unlock(&ledgerLock);
+    return ok;
+}
+
+/**
+ * @brief Fills in an entry stamped with the current time, for ledgerRecord()
+ */
+void ledgerEntryInit(LedgerEntry *entry, int accountNumber, char op, money_t amount, money_t balance)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    memset(entry, 0, sizeof(*entry));
+    entry->timestamp = (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+    entry->amount = amount;
+    entry->balance = balance;
+    entry->accountNumber = accountNumber;
+    entry->op = op;
+}
+
+/**
+ * @brief Appends entries of committed changes and syncs them
+ * @param entries Entries from ledgerEntryInit(), in the order of the changes
+ * @param count Number of entries; nothing is done for 0
+ * @return 1 on success, 0 on failure or if the ledger is not open
+ */
+int ledgerRecord(const LedgerEntry *entries, size_t count)
+{
+    if (count == 0)
+        return 1;
+
+    pthread_mutex_lock(&ledgerLock);
+    int ok = activeFile != NULL;
+    for (size_t i = 0; ok && i < count; i++)
+        ok = appendLocked(entries[i].accountNumber, entries[i].op, entries[i].amount, entries[i].balance,
+                          entries[i].timestamp);
+    ok = ok && fflush(activeFile) == 0 && fdatasync(fileno(activeFile)) == 0;
+    pthread_mutex_unlock(&ledgerLock);
+    return ok;
+}
+
+/**
+ * @brief Appends an entry stamped with the current time
+ * @return 1 on success, 0 on failure or if the ledger is not open
+ */
+int ledgerAppend(int accountNumber, char op, money_t amount, money_t balance)
+{
+    LedgerEntry entry;
+    ledgerEntryInit(&entry, accountNumber, op, amount, balance);
+    return ledgerAppendAt(accountNumber, op, amount, balance, entry.timestamp);
+}
+
+/**
+ * @brief Hands buffered entries to the operating system
+ * @return 1 on success, 0 on failure
+ */
+int ledgerFlush()
+{
+    pthread_mutex_lock(&ledgerLock);
+    int ok = !activeFile || fflush(activeFile) == 0;
+    pthread_mutex_unlock(&ledgerLock);
+    return ok;
+}
+
+/**
+ * @brief Number of entries in the ledger
+ */
+uint64_t ledgerCount()
+{
+    return entryCount;
+}
+
+/**
+ * @brief Returns an account's most recent entries
+ * @param accountNumber Account to query
+ * @param count Maximum number of entries
+ * @param entries Receives the entries, newest first
+ * @return Number of entries returned
+ */
+size_t ledgerLast(int accountNumber, size_t count, LedgerEntry *entries)
+{
+    size_t found = 0;
+
+    pthread_mutex_lock(&ledgerLock);
+    if (activeFile && fflush(activeFile) == 0)
+    {
+        const HeadBucket *head = findHead(accountNumber);
+        uint64_t next = head ? head->last : 0;
+        while (next != 0 && found < count && readEntries(next - 1, &entries[found], 1))
+            next = entries[found++].previous;
+    }
+    pthread_mutex_unlock(&ledgerLock);
+    return found;
+}
+
+/**
+ * @brief Finds the first entry stamped at or after a time
+ * @return Its sequence number, or the entry count if there is none
+ *
+ * Binary search over the segments' first samples, then over the samples of
+ * one segment, then a scan of the single stride block that remains.
+ */
+static uint64_t firstAtOrAfter(int64_t timestamp)
+{
+    size_t low = 0, high = segmentCount;
+    while (low < high)
+    {
+        size_t mid = (low + high) / 2;
+        if (segments[mid].sampleCount > 0 && segments[mid].samples[0] < timestamp)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    if (low == 0)
+        return 0;
+
+    // Segment low - 1 starts before the timestamp; the answer is in it or
+    // at the start of the next segment
+    size_t index = low - 1;
+    const Segment *segment = &segments[index];
+    size_t first = 0, last = segment->sampleCount;
+    while (first < last)
+    {
+        size_t mid = (first + last) / 2;
+        if (segment->samples[mid] < timestamp)
+            first = mid + 1;
+        else
+            last = mid;
+    }
+
+    uint64_t base = (uint64_t)index * segmentEntries;
+    size_t blockStart = (first - 1) * LEDGER_TIME_STRIDE;
+    size_t blockEnd = blockStart + LEDGER_TIME_STRIDE;
+    if (blockEnd > segment->entries)
+        blockEnd = segment->entries;
+
+    LedgerEntry block[LEDGER_TIME_STRIDE];
+    if (!readEntries(base + blockStart, block, blockEnd - blockStart))
+        return base + blockEnd;
+    for (size_t k = 0; k < blockEnd - blockStart; k++)
+        if (block[k].timestamp >= timestamp)
+            return base + blockStart + k;
+    return base + blockEnd;
+}
+
+/**
+ * @brief Returns an account's entries stamped within a time window
+ * @param accountNumber Account to query
+ * @param from Start of the window, microseconds since the epoch (inclusive)
+ * @param to End of the window (inclusive)
+ * @param entries Receives the entries, oldest first
+ * @param count Maximum number of entries; if the window holds more, the
+ *        most recent ones are returned
+ * @return Number of entries returned
+ */
+size_t ledgerRange(int accountNumber, int64_t from, int64_t to, LedgerEntry *entries, size_t count)
+{
+    size_t found = 0;
+
+    pthread_mutex_lock(&ledgerLock);
+    const HeadBucket *head = activeFile && from <= to ? findHead(accountNumber) : NULL;
+    if (head && count > 0 && fflush(activeFile) == 0)
+    {
+        uint64_t low = firstAtOrAfter(from);
+        uint64_t high = to == INT64_MAX ? entryCount : firstAtOrAfter(to + 1);
+
+        if (high - low <= LEDGER_SCAN_LIMIT)
+        {
+            // Short window: scan it backwards, a batch at a time
+            LedgerEntry batch[LEDGER_READ_BATCH];
+            uint64_t end = high;
+            while (end > low && found < count)
+            {
+                uint64_t segmentStart = (end - 1) / segmentEntries * (uint64_t)segmentEntries;
+                uint64_t start = end - low > LEDGER_READ_BATCH ? end - LEDGER_READ_BATCH : low;
+                if (start < segmentStart)
+                    start = segmentStart;
+                if (!readEntries(start, batch, (size_t)(end - start)))
+                    break;
+                for (size_t k = (size_t)(end - start); k-- > 0 && found < count;)
+                    if (batch[k].accountNumber == accountNumber)
+                        entries[found++] = batch[k];
+                end = start;
+            }
+        }
+        else
+        {
+            // Long window: follow the account's own chain into it
+            uint64_t next = head->last;
+            LedgerEntry entry;
+            while (next > low && found < count && readEntries(next - 1, &entry, 1))
+            {
+                if (next <= high)
+                    entries[found++] = entry;
+                next = entry.previous;
+            }
+        }
+
+        for (size_t i = 0; i < found / 2; i++)
+        {
+            LedgerEntry swap = entries[i];
+            entries[i] = entries[found - 1 - i];
+            entries[found - 1 - i] = swap;
+        }
+    }
+    pthread_mutex_unlock(&ledgerLock);
+    return found;
+}
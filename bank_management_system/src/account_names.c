@@ -0,0 +1,436 @@
+/**
+ * @file account_names.c
+ * @brief Secondary index from account holder names to account numbers
+ *
+ * The index is a sorted table of (username, accountNumber) pairs, so an
+ * exact name or a name prefix is found by binary search and its matches
+ * are adjacent. To keep inserts cheap it has two levels, like a small
+ * log-structured merge tree:
+ * - the base, a large sorted array that is only ever rebuilt whole;
+ * - the delta, a small sorted array that takes every insert. Once it
+ *   outgrows about four times the square root of the base, it is merged
+ *   into a new base, so an insert costs a short memmove plus a share of
+ *   the next merge.
+ * Removing a base entry only marks it deleted; the next merge drops it.
+ * Queries search both levels and merge their matches in order.
+ *
+ * Names are compared byte by byte, so lookups are case-sensitive. The
+ * index points at account numbers rather than record slots, so compaction
+ * moving records around does not affect it.
+ *
+ * Like the account number index, the table is saved to <db>.names on a
+ * clean close and marked in use while open; a crash or a record count
+ * that does not match the data file makes the next open rebuild it from
+ * the records. All functions are thread-safe.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <pthread.h>
+#include "bank_management_system.h"
+
+/** @brief Identifies a saved name index */
+#define NAMES_MAGIC "BANKNAM1"
+
+/** @brief Smallest delta that triggers a merge into the base */
+#define NAMES_MIN_DELTA 1024
+
+/** @brief Records read per batch while rebuilding */
+#define NAMES_REBUILD_BATCH 4096
+
+/**
+ * @struct NamesHeader
+ * @brief Fixed header at the start of the saved index
+ */
+typedef struct
+{
+    char magic[8];
+    uint64_t count;       /**< Entries stored after the header */
+    uint64_t recordCount; /**< Data file records covered by this index */
+    uint32_t clean;       /**< Non-zero if saved by a clean close */
+    uint32_t reserved;
+} NamesHeader;
+
+/**
+ * @brief A sorted array of entries; deleted marks are only used by the base
+ */
+typedef struct
+{
+    NameEntry *entries;
+    unsigned char *deleted;
+    size_t count;
+    size_t capacity;
+} NameTable;
+
+static FILE *namesFile = NULL;
+static NamesHeader header;
+static NameTable base;
+static NameTable delta;
+static size_t baseDeleted = 0;
+
+/** @brief Shared for lookups, exclusive for changes */
+static pthread_rwlock_t namesLock = PTHREAD_RWLOCK_INITIALIZER;
+
+/**
+ * @brief Orders entries by name, then account number
+ */
+static int compareEntries(const void *a, const void *b)
+{
+    const NameEntry *x = (const NameEntry *)a, *y = (const NameEntry *)b;
+    int order = strncmp(x->username, y->username, sizeof(x->username));
+    if (order != 0)
+        return order;
+    return (x->accountNumber > y->accountNumber) - (x->accountNumber < y->accountNumber);
+}
+
+/**
+ * @brief First position in a table whose entry is not less than key
+ */
+static size_t lowerBound(const NameTable *table, const NameEntry *key)
+{
+    size_t low = 0, high = table->count;
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        if (compareEntries(&table->entries[middle], key) < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+static void freeTable(NameTable *table)
+{
+    free(table->entries);
+    free(table->deleted);
+    memset(table, 0, sizeof(*table));
+}
+
+/**
+ * @brief Makes room for a number of entries in a table
+ * @return 1 on success, 0 if out of memory
+ */
+static int reserveTable(NameTable *table, size_t capacity, int withMarks)
+{
+    if (capacity <= table->capacity)
+        return 1;
+
+    NameEntry *entries = (NameEntry *)realloc(table->entries, capacity * sizeof(NameEntry));
+    if (!entries)
+        return 0;
+    table->entries = entries;
+    if (withMarks)
+    {
+        unsigned char *deleted = (unsigned char *)realloc(table->deleted, capacity);
+        if (!deleted)
+            return 0;
+        table->deleted = deleted;
+    }
+    table->capacity = capacity;
+    return 1;
+}
+
+/**
+ * @brief Builds a key entry, truncating the name like Account.username
+ */
+static void makeEntry(NameEntry *entry, const char *username, int accountNumber)
+{
+    memset(entry, 0, sizeof(*entry));
+    strncpy(entry->username, username, sizeof(entry->username) - 1);
+    entry->accountNumber = accountNumber;
+}
+
+/**
+ * @brief Merges the delta into a new base, dropping deleted entries
+ * @return 1 on success, 0 if out of memory (the index is left unchanged)
+ *
+ * Caller holds the lock exclusively.
+ */
+static int mergeDelta()
+{
+    NameTable merged;
+    size_t total = base.count - baseDeleted + delta.count;
+
+    memset(&merged, 0, sizeof(merged));
+    if (!reserveTable(&merged, total ? total : 1, 1))
+    {
+        freeTable(&merged);
+        return 0;
+    }
+
+    size_t i = 0, j = 0;
+    while (i < base.count || j < delta.count)
+    {
+        if (i < base.count && base.deleted[i])
+        {
+            i++;
+            continue;
+        }
+        if (j >= delta.count || (i < base.count && compareEntries(&base.entries[i], &delta.entries[j]) < 0))
+            merged.entries[merged.count++] = base.entries[i++];
+        else
+            merged.entries[merged.count++] = delta.entries[j++];
+    }
+    memset(merged.deleted, 0, merged.count);
+
+    freeTable(&base);
+    base = merged;
+    baseDeleted = 0;
+    delta.count = 0;
+    return 1;
+}
+
+/**
+ * @brief Largest delta allowed before it is merged into the base
+ */
+static size_t deltaLimit()
+{
+    size_t limit = (size_t)(4 * sqrt((double)base.count));
+    return limit > NAMES_MIN_DELTA ? limit : NAMES_MIN_DELTA;
+}
+
+/**
+ * @brief Writes the whole index, merged, to the sidecar file
+ * @return 1 on success, 0 on failure
+ */
+static int writeAll()
+{
+    if (delta.count > 0 || baseDeleted > 0)
+    {
+        if (!mergeDelta())
+            return 0;
+    }
+    header.count = base.count;
+    return fseek(namesFile, 0, SEEK_SET) == 0 &&
+           fwrite(&header, sizeof(header), 1, namesFile) == 1 &&
+           fwrite(base.entries, sizeof(NameEntry), base.count, namesFile) == base.count &&
+           fflush(namesFile) == 0 &&
+           ftruncate(fileno(namesFile), ftell(namesFile)) == 0;
+}
+
+/**
+ * @brief Loads a saved index, unless it is stale or unreadable
+ * @return 1 if the index was loaded, 0 if it must be rebuilt
+ */
+static int loadSaved(size_t recordCount)
+{
+    int valid = fread(&header, sizeof(header), 1, namesFile) == 1 &&
+                memcmp(header.magic, NAMES_MAGIC, sizeof(header.magic)) == 0 &&
+                header.clean && header.recordCount == recordCount && header.count <= recordCount;
+    if (!valid || !reserveTable(&base, header.count ? header.count : 1, 1))
+        return 0;
+
+    base.count = header.count;
+    memset(base.deleted, 0, base.count);
+    return fread(base.entries, sizeof(NameEntry), base.count, namesFile) == base.count;
+}
+
+/**
+ * @brief Rebuilds the index from every open account in the data file
+ * @return 1 on success, 0 on failure
+ */
+static int rebuild(size_t recordCount)
+{
+    Account *batch = (Account *)malloc(NAMES_REBUILD_BATCH * sizeof(Account));
+    freeTable(&base);
+    delta.count = 0;
+    baseDeleted = 0;
+    if (!batch || !reserveTable(&base, recordCount ? recordCount : 1, 1))
+    {
+        free(batch);
+        return 0;
+    }
+
+    size_t slot = 0;
+    while (slot < recordCount)
+    {
+        size_t n = storeReadRecords(slot, batch, NAMES_REBUILD_BATCH);
+        if (n == 0)
+            break;
+        for (size_t k = 0; k < n; k++)
+        {
+            if (!(batch[k].flags & ACCOUNT_CLOSED))
+                makeEntry(&base.entries[base.count++], batch[k].username, batch[k].accountNumber);
+        }
+        slot += n;
+    }
+    free(batch);
+
+    qsort(base.entries, base.count, sizeof(NameEntry), compareEntries);
+    memset(base.deleted, 0, base.count);
+    memcpy(header.magic, NAMES_MAGIC, sizeof(header.magic));
+    return slot == recordCount;
+}
+
+/**
+ * @brief Opens the name index, rebuilding it if it is missing or stale
+ * @param path Location of the sidecar file
+ * @param recordCount Number of records currently in the data file
+ * @return 1 on success, 0 on failure
+ */
+int namesOpen(const char *path, size_t recordCount)
+{
+    namesClose();
+
+    namesFile = fopen(path, "r+b");
+    if (!namesFile)
+        namesFile = fopen(path, "w+b");
+    if (!namesFile)
+        return 0;
+
+    pthread_rwlock_wrlock(&namesLock);
+    int ok = loadSaved(recordCount) || rebuild(recordCount);
+
+    // Until the clean close rewrites it, the saved copy is out of date
+    header.clean = 0;
+    ok = ok && fseek(namesFile, 0, SEEK_SET) == 0 &&
+         fwrite(&header, sizeof(header), 1, namesFile) == 1 && fflush(namesFile) == 0;
+    pthread_rwlock_unlock(&namesLock);
+    return ok;
+}
+
+/**
+ * @brief Saves the index and closes the sidecar file
+ *
+ * Must run before the data file is closed.
+ */
+void namesClose()
+{
+    pthread_rwlock_wrlock(&namesLock);
+    if (namesFile)
+    {
+        header.recordCount = storeRecordCount();
+        header.clean = 1;
+        if (!writeAll())
+            perror("accounts: name index");
+        fclose(namesFile);
+        namesFile = NULL;
+    }
+    freeTable(&base);
+    freeTable(&delta);
+    baseDeleted = 0;
+    memset(&header, 0, sizeof(header));
+    pthread_rwlock_unlock(&namesLock);
+}
+
+/**
+ * @brief Adds an account holder's name to the index
+ * @param username Name of the account holder
+ * @param accountNumber Account carrying the name
+ * @return 1 on success, 0 on failure
+ */
+int namesInsert(const char *username, int accountNumber)
+{
+    NameEntry entry;
+    int ok = 0;
+
+    makeEntry(&entry, username, accountNumber);
+    pthread_rwlock_wrlock(&namesLock);
+    if (namesFile && (delta.count < deltaLimit() || mergeDelta()) &&
+        reserveTable(&delta, delta.count < NAMES_MIN_DELTA ? NAMES_MIN_DELTA : delta.count * 2, 0))
+    {
+        size_t at = lowerBound(&delta, &entry);
+        memmove(&delta.entries[at + 1], &delta.entries[at], (delta.count - at) * sizeof(NameEntry));
+        delta.entries[at] = entry;
+        delta.count++;
+        ok = 1;
+    }
+    pthread_rwlock_unlock(&namesLock);
+    return ok;
+}
+
+/**
+ * @brief Removes an account holder's name from the index
+ * @return 1 if the name was indexed for that account, 0 otherwise
+ */
+int namesRemove(const char *username, int accountNumber)
+{
+    NameEntry entry;
+    int found = 0;
+
+    makeEntry(&entry, username, accountNumber);
+    pthread_rwlock_wrlock(&namesLock);
+    size_t at = lowerBound(&delta, &entry);
+    if (at < delta.count && compareEntries(&delta.entries[at], &entry) == 0)
+    {
+        memmove(&delta.entries[at], &delta.entries[at + 1], (delta.count - at - 1) * sizeof(NameEntry));
+        delta.count--;
+        found = 1;
+    }
+    else
+    {
+        at = lowerBound(&base, &entry);
+        if (at < base.count && !base.deleted[at] && compareEntries(&base.entries[at], &entry) == 0)
+        {
+            base.deleted[at] = 1;
+            baseDeleted++;
+            found = 1;
+        }
+    }
+    pthread_rwlock_unlock(&namesLock);
+    return found;
+}
+
+/**
+ * @brief Checks whether an entry matches a search
+ */
+static int matches(const NameEntry *entry, const char *text, size_t length, int prefix)
+{
+    if (strncmp(entry->username, text, length) != 0)
+        return 0;
+    return prefix || entry->username[length] == '\0';
+}
+
+/**
+ * @brief Finds accounts by holder name
+ * @param text Exact name, or the prefix to search for
+ * @param prefix Non-zero to match every name starting with text
+ * @param matchesOut Receives the matches, ordered by name and then account
+ * @param count Maximum number of matches to return
+ * @return Number of matches returned
+ */
+size_t namesSearch(const char *text, int prefix, NameEntry *matchesOut, size_t count)
+{
+    NameEntry key;
+    size_t found = 0;
+    size_t length = strlen(text);
+
+    if (length >= sizeof(key.username))
+        length = sizeof(key.username) - 1;
+    // The smallest entry whose name starts with text
+    makeEntry(&key, text, INT32_MIN);
+    key.username[length] = '\0';
+
+    pthread_rwlock_rdlock(&namesLock);
+    size_t i = lowerBound(&base, &key), j = lowerBound(&delta, &key);
+    while (found < count)
+    {
+        while (i < base.count && base.deleted[i])
+            i++;
+        int inBase = i < base.count && matches(&base.entries[i], key.username, length, prefix);
+        int inDelta = j < delta.count && matches(&delta.entries[j], key.username, length, prefix);
+        if (!inBase && !inDelta)
+            break;
+        if (inBase && (!inDelta || compareEntries(&base.entries[i], &delta.entries[j]) < 0))
+            matchesOut[found++] = base.entries[i++];
+        else
+            matchesOut[found++] = delta.entries[j++];
+    }
+    pthread_rwlock_unlock(&namesLock);
+    return found;
+}
+
+/**
+ * @brief Returns the number of indexed names
+ */
+size_t namesCount()
+{
+    pthread_rwlock_rdlock(&namesLock);
+    size_t count = base.count - baseDeleted + delta.count;
+    pthread_rwlock_unlock(&namesLock);
+    return count;
+}
@@ -0,0 +1,731 @@
+/**
+ * @file account_store.c
+ * @brief Fixed-size record file holding every Account of the bank
+ *
+ * Records are addressed by slot number (their position in the file), so a
+ * record can be read or rewritten with a single seek once its slot is known.
+ * The file is kept open for the lifetime of the program instead of being
+ * reopened for every operation.
+ *
+ * Two storage engines are available. The default one goes through stdio.
+ * The memory-mapped one maps the record array into the address space, so
+ * reads and updates are plain memory accesses on the mapped pages with no
+ * system call on the hot path. The mapping grows in fixed chunks, and pages
+ * are only forced to disk when storeSync() is called (or on close).
+ *
+ * Every function may be called from several threads; a mutex serialises
+ * access to the file handle and to the mapping while it is resized. The
+ * file itself is locked for the lifetime of the store, so a second process
+ * cannot open the same accounts and race with this one.
+ *
+ * The file starts with a small header naming its format. Files written
+ * before the header existed (float balances, no header) are converted to
+ * the current format the first time they are opened.
+ *
+ * A snapshot freezes the records as they are at one instant while writes
+ * go on. It is copy-on-write: the first write into a page of
+ * SNAPSHOT_PAGE_RECORDS records copies the page's old contents aside, and
+ * snapshot reads use the copy when there is one. Snapshots are read front
+ * to back, and pages behind the reader are neither copied nor kept, so a
+ * snapshot costs about the pages written while it is being streamed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <pthread.h>
+#include "bank_management_system.h"
+
+/** @brief Records added to the mapping each time it runs out of room */
+#define STORE_MMAP_CHUNK_RECORDS 16384
+
+/** @brief Records per copy-on-write page of a snapshot (3 KiB) */
+#define SNAPSHOT_PAGE_RECORDS 64
+
+/** @brief Identifies a record file in the current format */
+#define STORE_MAGIC "BANKDAT2"
+#define STORE_VERSION 2
+
+/** @brief Byte offset of a record slot within the file */
+#define RECORD_OFFSET(slot) (sizeof(StoreHeader) + (slot) * sizeof(Account))
+
+/**
+ * @struct StoreHeader
+ * @brief Fixed 64-byte header at the start of the record file
+ */
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    char reserved[48];
+} StoreHeader;
+
+/**
+ * @struct LegacyAccount
+ * @brief Record layout of files written before the header existed
+ */
+typedef struct
+{
+    char username[30];
+    int accountNumber;
+    float balance;
+} LegacyAccount;
+
+/** @brief Storage engine used by the next storeOpen() */
+static int backend = STORE_BACKEND_STDIO;
+
+/** @brief Open handle on the record file (stdio engine), NULL when closed */
+static FILE *dataFile = NULL;
+
+/** @brief Descriptor of the record file (mmap engine), -1 when closed */
+static int dataFd = -1;
+
+/** @brief Start of the mapped file (mmap engine) */
+static void *mappedBase = NULL;
+
+/** @brief First record within the mapped file (mmap engine) */
+static Account *mapped = NULL;
+
+/** @brief Number of records the current mapping (and file) can hold */
+static size_t mappedCapacity = 0;
+
+/** @brief Number of complete records currently in the file */
+static size_t recordCount = 0;
+
+/** @brief Serialises record access between threads */
+static pthread_mutex_t storeLock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @struct Snapshot
+ * @brief State of the snapshot being read, if any
+ */
+typedef struct
+{
+    int active;
+    int failed;         /**< A page could not be preserved */
+    size_t count;       /**< Records in the snapshot */
+    size_t streamed;    /**< Pages below this one have been read */
+    Account **pages;    /**< Preserved page copies, NULL if unchanged */
+    size_t pageCount;
+    size_t copiedPages; /**< Pages copied over the snapshot's lifetime */
+} Snapshot;
+
+static Snapshot snapshot;
+
+/**
+ * @brief Takes the inter-process lock on an opened record file
+ * @return 1 on success, 0 if another process holds the file
+ */
+static int lockFile(int fd)
+{
+    if (flock(fd, LOCK_EX | LOCK_NB) == 0)
+        return 1;
+    fprintf(stderr, "accounts: database is in use by another process\n");
+    return 0;
+}
+
+/**
+ * @brief Fills in the header describing the current format
+ */
+static void initHeader(StoreHeader *header)
+{
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, STORE_MAGIC, sizeof(header->magic));
+    header->version = STORE_VERSION;
+    header->recordSize = sizeof(Account);
+}
+
+/**
+ * @brief Rewrites a headerless legacy file in the current format
+ * @return 1 on success, 0 on failure
+ *
+ * Float balances are rounded to the nearest minor unit. The new file is
+ * written next to the old one and renamed over it, so an interrupted
+ * conversion leaves the legacy file untouched.
+ */
+static int migrateLegacy(const char *path, FILE *legacy)
+{
+    char tmpPath[512];
+    StoreHeader header;
+    LegacyAccount old;
+    Account record;
+
+    if (snprintf(tmpPath, sizeof(tmpPath), "%s.migrating", path) >= (int)sizeof(tmpPath))
+        return 0;
+    FILE *converted = fopen(tmpPath, "wb");
+    if (!converted)
+        return 0;
+
+    initHeader(&header);
+    int ok = fwrite(&header, sizeof(header), 1, converted) == 1;
+    rewind(legacy);
+    while (ok && fread(&old, sizeof(old), 1, legacy) == 1)
+    {
+        memset(&record, 0, sizeof(record));
+        memcpy(record.username, old.username, sizeof(record.username));
+        record.accountNumber = old.accountNumber;
+        record.balance = (money_t)llround((double)old.balance * MONEY_SCALE);
+        ok = fwrite(&record, sizeof(record), 1, converted) == 1;
+    }
+    ok = ok && fflush(converted) == 0 && fsync(fileno(converted)) == 0;
+    ok = fclose(converted) == 0 && ok;
+
+    if (ok && rename(tmpPath, path) == 0)
+    {
+        fprintf(stderr, "accounts: converted %s to the fixed-point record format\n", path);
+        return 1;
+    }
+    remove(tmpPath);
+    return 0;
+}
+
+/**
+ * @brief Checks the header of an existing file, converting legacy files
+ * @return 1 if the file is missing, empty or usable, 0 otherwise
+ */
+static int checkFormat(const char *path)
+{
+    StoreHeader header, expected;
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return 1;
+
+    initHeader(&expected);
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+
+    int ok = 1;
+    if (size > 0)
+    {
+        if (fread(&header, sizeof(header), 1, file) == 1 &&
+            memcmp(header.magic, expected.magic, sizeof(header.magic)) == 0)
+            ok = header.version == expected.version && header.recordSize == expected.recordSize;
+        else
+            ok = size % sizeof(LegacyAccount) == 0 && migrateLegacy(path, file);
+
+        if (!ok)
+            fprintf(stderr, "accounts: %s is not a record file this program can read\n", path);
+    }
+
+    fclose(file);
+    return ok;
+}
+
+/**
+ * @brief Reads consecutive records from the file; caller holds storeLock
+ * @return Number of records read
+ */
+static size_t readRaw(size_t first, Account *buffer, size_t count)
+{
+    if (first >= recordCount)
+        return 0;
+    if (count > recordCount - first)
+        count = recordCount - first;
+
+    if (mapped)
+    {
+        memcpy(buffer, &mapped[first], count * sizeof(Account));
+        return count;
+    }
+    if (dataFile && fseek(dataFile, (long)RECORD_OFFSET(first), SEEK_SET) == 0)
+        return fread(buffer, sizeof(Account), count, dataFile);
+    return 0;
+}
+
+/**
+ * @brief Copies aside the snapshot page holding a slot before it changes
+ *
+ * Caller holds storeLock. If the copy cannot be made the snapshot is
+ * marked failed rather than failing the write.
+ */
+static void preservePage(size_t slot)
+{
+    if (!snapshot.active || slot >= snapshot.count)
+        return;
+    size_t page = slot / SNAPSHOT_PAGE_RECORDS;
+    if (page < snapshot.streamed || snapshot.pages[page])
+        return;
+
+    size_t first = page * SNAPSHOT_PAGE_RECORDS;
+    size_t count = snapshot.count - first < SNAPSHOT_PAGE_RECORDS ? snapshot.count - first : SNAPSHOT_PAGE_RECORDS;
+    Account *copy = (Account *)malloc(SNAPSHOT_PAGE_RECORDS * sizeof(Account));
+    if (!copy || readRaw(first, copy, count) != count)
+    {
+        free(copy);
+        snapshot.failed = 1;
+        return;
+    }
+    snapshot.pages[page] = copy;
+    snapshot.copiedPages++;
+}
+
+/**
+ * @brief Copies aside every snapshot page overlapping slots [first, end)
+ *
+ * Caller holds storeLock.
+ */
+static void preservePages(size_t first, size_t end)
+{
+    if (first >= end)
+        return;
+    for (size_t page = first / SNAPSHOT_PAGE_RECORDS; page <= (end - 1) / SNAPSHOT_PAGE_RECORDS; page++)
+        preservePage(page * SNAPSHOT_PAGE_RECORDS);
+}
+
+/**
+ * @brief Selects the storage engine used by subsequent opens
+ * @param which STORE_BACKEND_STDIO or STORE_BACKEND_MMAP
+ */
+void storeSetBackend(int which)
+{
+    backend = which;
+}
+
+/**
+ * @brief Resizes the file and maps it for the given number of records
+ * @return 1 on success, 0 on failure (the old mapping is then kept)
+ */
+static int remapTo(size_t capacity)
+{
+    if (ftruncate(dataFd, (off_t)RECORD_OFFSET(capacity)) != 0)
+        return 0;
+
+    void *region = mmap(NULL, RECORD_OFFSET(capacity), PROT_READ | PROT_WRITE, MAP_SHARED, dataFd, 0);
+    if (region == MAP_FAILED)
+        return 0;
+
+    if (mappedBase)
+        munmap(mappedBase, RECORD_OFFSET(mappedCapacity));
+    mappedBase = region;
+    mapped = (Account *)((char *)region + sizeof(StoreHeader));
+    mappedCapacity = capacity;
+    return 1;
+}
+
+/**
+ * @brief Checks whether a record is entirely zero bytes
+ *
+ * Chunk growth pads the file with zeroed records, which are trimmed on a
+ * clean close. No account can be such a record (an open account's
+ * username is never empty and a closed one is flagged), so after a crash
+ * they are recognised as padding rather than accounts.
+ */
+static int isPadding(const Account *account)
+{
+    static const Account zero;
+    return memcmp(account, &zero, sizeof(Account)) == 0;
+}
+
+/**
+ * @brief Opens the record file with the memory-mapped engine
+ */
+static int openMapped(const char *path)
+{
+    struct stat st;
+
+    dataFd = open(path, O_RDWR | O_CREAT, 0644);
+    if (dataFd < 0)
+        return 0;
+    if (!lockFile(dataFd) || fstat(dataFd, &st) != 0)
+    {
+        close(dataFd);
+        dataFd = -1;
+        return 0;
+    }
+
+    size_t records = 0;
+    if (st.st_size == 0)
+    {
+        StoreHeader header;
+        initHeader(&header);
+        if (pwrite(dataFd, &header, sizeof(header), 0) != (ssize_t)sizeof(header))
+        {
+            close(dataFd);
+            dataFd = -1;
+            return 0;
+        }
+    }
+    else if ((size_t)st.st_size > sizeof(StoreHeader))
+        records = ((size_t)st.st_size - sizeof(StoreHeader)) / sizeof(Account);
+    size_t capacity = (records / STORE_MMAP_CHUNK_RECORDS + 1) * STORE_MMAP_CHUNK_RECORDS;
+    if (!remapTo(capacity))
+    {
+        close(dataFd);
+        dataFd = -1;
+        return 0;
+    }
+
+    while (records > 0 && isPadding(&mapped[records - 1]))
+        records--;
+    recordCount = records;
+    return 1;
+}
+
+/**
+ * @brief Opens (or creates) the record file
+ * @param path Location of the record file
+ * @return 1 on success, 0 on failure
+ */
+int storeOpen(const char *path)
+{
+    storeClose();
+
+    if (!checkFormat(path))
+        return 0;
+    if (backend == STORE_BACKEND_MMAP)
+        return openMapped(path);
+
+    dataFile = fopen(path, "r+b");
+    if (!dataFile)
+        dataFile = fopen(path, "w+b");
+    if (!dataFile)
+        return 0;
+    if (!lockFile(fileno(dataFile)))
+    {
+        fclose(dataFile);
+        dataFile = NULL;
+        return 0;
+    }
+
+    fseek(dataFile, 0, SEEK_END);
+    long size = ftell(dataFile);
+    if (size == 0)
+    {
+        StoreHeader header;
+        initHeader(&header);
+        if (fwrite(&header, sizeof(header), 1, dataFile) != 1 || fflush(dataFile) != 0)
+        {
+            fclose(dataFile);
+            dataFile = NULL;
+            return 0;
+        }
+    }
+    else if ((size_t)size > sizeof(StoreHeader))
+        recordCount = ((size_t)size - sizeof(StoreHeader)) / sizeof(Account);
+    return 1;
+}
+
+/**
+ * @brief Forces every record written so far to stable storage
+ * @return 1 on success, 0 on failure
+ */
+int storeSync()
+{
+    int ok = 0;
+
+    pthread_mutex_lock(&storeLock);
+    if (mapped)
+        ok = msync(mappedBase, RECORD_OFFSET(recordCount), MS_SYNC) == 0;
+    else if (dataFile)
+        ok = fflush(dataFile) == 0 && fsync(fileno(dataFile)) == 0;
+    pthread_mutex_unlock(&storeLock);
+    return ok;
+}
+
+/**
+ * @brief Flushes and closes the record file
+ *
+ * With the mmap engine the chunk padding is cut off again, so the file on
+ * disk always ends with its last record.
+ */
+void storeClose()
+{
+    storeSnapshotEnd();
+    if (dataFile)
+    {
+        fclose(dataFile);
+        dataFile = NULL;
+    }
+    if (mappedBase)
+    {
+        msync(mappedBase, RECORD_OFFSET(recordCount), MS_SYNC);
+        munmap(mappedBase, RECORD_OFFSET(mappedCapacity));
+        mappedBase = NULL;
+        mapped = NULL;
+        mappedCapacity = 0;
+    }
+    if (dataFd >= 0)
+    {
+        if (ftruncate(dataFd, (off_t)RECORD_OFFSET(recordCount)) != 0)
+            perror("accounts: truncate");
+        close(dataFd);
+        dataFd = -1;
+    }
+    recordCount = 0;
+}
+
+/**
+ * @brief Returns the number of records in the file
+ */
+size_t storeRecordCount()
+{
+    pthread_mutex_lock(&storeLock);
+    size_t count = recordCount;
+    pthread_mutex_unlock(&storeLock);
+    return count;
+}
+
+/**
+ * @brief Reads the record stored at a slot
+ * @param slot Record position in the file
+ * @param account Destination for the record
+ * @return 1 on success, 0 if the slot does not exist or the read failed
+ */
+int storeReadRecord(size_t slot, Account *account)
+{
+    int ok = 0;
+
+    pthread_mutex_lock(&storeLock);
+    if (slot < recordCount && mapped)
+    {
+        *account = mapped[slot];
+        ok = 1;
+    }
+    else if (slot < recordCount && dataFile && fseek(dataFile, (long)RECORD_OFFSET(slot), SEEK_SET) == 0)
+        ok = fread(account, sizeof(Account), 1, dataFile) == 1;
+    pthread_mutex_unlock(&storeLock);
+    return ok;
+}
+
+/**
+ * @brief Reads a run of consecutive records in one call
+ * @param first Slot of the first record to read
+ * @param buffer Destination for the records
+ * @param count Maximum number of records to read
+ * @return Number of records actually read
+ */
+size_t storeReadRecords(size_t first, Account *buffer, size_t count)
+{
+    pthread_mutex_lock(&storeLock);
+    size_t read = readRaw(first, buffer, count);
+    pthread_mutex_unlock(&storeLock);
+    return read;
+}
+
+/**
+ * @brief Overwrites the record stored at a slot
+ * @param slot Record position in the file
+ * @param account Record to write
+ * @return 1 on success, 0 on failure
+ */
+int storeWriteRecord(size_t slot, const Account *account)
+{
+    int ok = 0;
+
+    pthread_mutex_lock(&storeLock);
+    preservePage(slot);
+    if (slot < recordCount && mapped)
+    {
+        mapped[slot] = *account;
+        ok = 1;
+    }
+    else if (slot < recordCount && dataFile && fseek(dataFile, (long)RECORD_OFFSET(slot), SEEK_SET) == 0)
+        ok = fwrite(account, sizeof(Account), 1, dataFile) == 1 && fflush(dataFile) == 0;
+    pthread_mutex_unlock(&storeLock);
+    return ok;
+}
+
+/**
+ * @brief Appends a record at the end of the file
+ * @param account Record to append
+ * @return Slot of the new record, or -1 on failure
+ */
+long storeAppendRecord(const Account *account)
+{
+    long slot = -1;
+
+    pthread_mutex_lock(&storeLock);
+    preservePage(recordCount);
+    if (mapped)
+    {
+        if (recordCount < mappedCapacity || remapTo(mappedCapacity + STORE_MMAP_CHUNK_RECORDS))
+        {
+            mapped[recordCount] = *account;
+            slot = (long)recordCount++;
+        }
+    }
+    else if (dataFile && fseek(dataFile, (long)RECORD_OFFSET(recordCount), SEEK_SET) == 0 &&
+             fwrite(account, sizeof(Account), 1, dataFile) == 1 && fflush(dataFile) == 0)
+    {
+        slot = (long)recordCount++;
+    }
+    pthread_mutex_unlock(&storeLock);
+    return slot;
+}
+
+/**
+ * @brief Appends a run of records with a single write
+ * @param accounts Records to append
+ * @param count Number of records
+ * @return Number of records appended
+ *
+ * Meant for building a database in bulk before it is opened through
+ * bankOpen(), which then indexes the new records.
+ */
+size_t storeAppendRecords(const Account *accounts, size_t count)
+{
+    size_t written = 0;
+
+    pthread_mutex_lock(&storeLock);
+    preservePages(recordCount, recordCount + count);
+    if (mapped)
+    {
+        size_t capacity = mappedCapacity;
+        while (capacity < recordCount + count)
+            capacity += STORE_MMAP_CHUNK_RECORDS;
+        if (capacity == mappedCapacity || remapTo(capacity))
+        {
+            memcpy(&mapped[recordCount], accounts, count * sizeof(Account));
+            written = count;
+        }
+    }
+    else if (dataFile && fseek(dataFile, (long)RECORD_OFFSET(recordCount), SEEK_SET) == 0)
+    {
+        written = fwrite(accounts, sizeof(Account), count, dataFile);
+        if (fflush(dataFile) != 0)
+            written = 0;
+    }
+    recordCount += written;
+    pthread_mutex_unlock(&storeLock);
+    return written;
+}
+
+/**
+ * @brief Cuts the file back to its first records
+ * @param count Number of records to keep
+ * @return 1 on success, 0 on failure
+ *
+ * Used by compaction once only closed accounts remain beyond count.
+ */
+int storeTruncate(size_t count)
+{
+    int ok = 0;
+
+    pthread_mutex_lock(&storeLock);
+    preservePages(count, recordCount);
+    if (count <= recordCount && mapped)
+    {
+        // Beyond the last record the mapping must read as padding again
+        memset(&mapped[count], 0, (recordCount - count) * sizeof(Account));
+        recordCount = count;
+        ok = 1;
+    }
+    else if (count <= recordCount && dataFile && fflush(dataFile) == 0 &&
+             ftruncate(fileno(dataFile), (off_t)RECORD_OFFSET(count)) == 0)
+    {
+        recordCount = count;
+        ok = 1;
+    }
+    pthread_mutex_unlock(&storeLock);
+    return ok;
+}
+
+/**
+ * @brief Writes the header of a record file in the current format
+ * @param file File positioned at its start
+ * @return 1 on success, 0 on failure
+ *
+ * Lets other modules produce record files, such as backups.
+ */
+int storeWriteHeader(FILE *file)
+{
+    StoreHeader header;
+    initHeader(&header);
+    return fwrite(&header, sizeof(header), 1, file) == 1;
+}
+
+/**
+ * @brief Freezes the current records as a snapshot
+ * @return Number of records in the snapshot, or -1 if a snapshot is
+ *         already open or memory is short
+ *
+ * The caller must make sure no write is half applied (see walSnapshot()).
+ */
+long storeSnapshotBegin()
+{
+    long count = -1;
+
+    pthread_mutex_lock(&storeLock);
+    if (!snapshot.active)
+    {
+        size_t pageCount = recordCount / SNAPSHOT_PAGE_RECORDS + 1;
+        Account **pages = (Account **)calloc(pageCount, sizeof(Account *));
+        if (pages)
+        {
+            memset(&snapshot, 0, sizeof(snapshot));
+            snapshot.active = 1;
+            snapshot.count = recordCount;
+            snapshot.pages = pages;
+            snapshot.pageCount = pageCount;
+            count = (long)recordCount;
+        }
+    }
+    pthread_mutex_unlock(&storeLock);
+    return count;
+}
+
+/**
+ * @brief Reads records as they were when the snapshot began
+ * @param first Slot of the first record; reads must move front to back
+ * @param buffer Destination for the records
+ * @param count Maximum number of records to read
+ * @return Number of records read, 0 at the end or if the snapshot failed
+ *
+ * Pages wholly before the end of this read are released and no longer
+ * preserved, so a record may only be read once.
+ */
+size_t storeSnapshotRead(size_t first, Account *buffer, size_t count)
+{
+    size_t read = 0;
+
+    pthread_mutex_lock(&storeLock);
+    if (snapshot.active && !snapshot.failed && first < snapshot.count)
+    {
+        if (count > snapshot.count - first)
+            count = snapshot.count - first;
+        while (read < count)
+        {
+            size_t slot = first + read;
+            size_t page = slot / SNAPSHOT_PAGE_RECORDS, offset = slot % SNAPSHOT_PAGE_RECORDS;
+            size_t n = SNAPSHOT_PAGE_RECORDS - offset < count - read ? SNAPSHOT_PAGE_RECORDS - offset : count - read;
+            if (snapshot.pages[page])
+                memcpy(&buffer[read], &snapshot.pages[page][offset], n * sizeof(Account));
+            else if (readRaw(slot, &buffer[read], n) != n)
+                break;
+            read += n;
+        }
+
+        size_t streamed = (first + read) / SNAPSHOT_PAGE_RECORDS;
+        for (; snapshot.streamed < streamed; snapshot.streamed++)
+        {
+            free(snapshot.pages[snapshot.streamed]);
+            snapshot.pages[snapshot.streamed] = NULL;
+        }
+    }
+    pthread_mutex_unlock(&storeLock);
+    return read;
+}
+
+/**
+ * @brief Closes the snapshot and releases its page copies
+ * @return Number of pages copied while the snapshot was open
+ */
+size_t storeSnapshotEnd()
+{
+    pthread_mutex_lock(&storeLock);
+    size_t copied = snapshot.copiedPages;
+    for (size_t i = 0; snapshot.pages && i < snapshot.pageCount; i++)
+        free(snapshot.pages[i]);
+    free(snapshot.pages);
+    memset(&snapshot, 0, sizeof(snapshot));
+    pthread_mutex_unlock(&storeLock);
+    return copied;
+}
@@ -0,0 +1,637 @@
+/**
+ * @file account_wal.c
+ * @brief Write-ahead log with group commit in front of the account store
+ *
+ * Every record update is first appended to an in-memory group as a full
+ * after-image of the record. A commit writes the whole group to the log
+ * file with a single fsync and only then applies the records to the store,
+ * so the store never holds a change the log could lose and a record torn by
+ * a crash is always repaired from the log. The more updates a group holds,
+ * the fewer fsyncs the bank pays.
+ *
+ * The log is safe to use from several threads. Whichever thread asks for a
+ * commit while no flush is running becomes the leader: it takes the whole
+ * pending group, writes and syncs it, and wakes every thread whose updates
+ * were in it. Threads that arrive during a flush keep filling the next group,
+ * so under load one fsync covers the updates of many threads.
+ *
+ * Updates that must survive together (both sides of a transfer) are appended
+ * as one transaction; the last entry of a transaction is flagged, and replay
+ * only applies transactions whose every entry made it to disk.
+ *
+ * An update may carry ledger entries describing it. They travel with its
+ * group and are recorded in the ledger by the leader once the group is
+ * durable, before any of its waiters is released; a group that fails takes
+ * its entries with it.
+ *
+ * A flush that fails leaves the log failed until it is reopened: the group
+ * and everything appended after it are dropped, every waiter whose update
+ * was not yet durable is told so, and new appends are refused. Otherwise a
+ * later leader's success would cover updates that never reached the disk.
+ * The record cache is cleared as well, since it holds their images.
+ *
+ * Applied records are not forced to disk one by one: once the log grows
+ * past a threshold, a checkpoint syncs the store and empties the log.
+ * walRecover() replays whatever the log still holds at startup; a torn
+ * entry at the tail fails its checksum and ends the replay.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include "bank_management_system.h"
+
+/** @brief Marks the start of every log entry */
+#define WAL_ENTRY_MAGIC 0x57414C45u
+
+/** @brief Log size that triggers a checkpoint after a commit */
+#define WAL_CHECKPOINT_BYTES (4L * 1024 * 1024)
+
+/** @brief Largest transaction accepted by walAppendRecords() */
+#define WAL_MAX_TXN_RECORDS 16
+
+/**
+ * @struct WalEntry
+ * @brief On-disk log entry: the new contents of one record slot
+ */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t checksum; /**< FNV-1a over everything after this field */
+    uint64_t lsn;      /**< Log sequence number, consecutive within the file */
+    uint32_t slot;     /**< Record slot; equal to the record count for appends */
+    uint32_t txnLast;  /**< Non-zero on the last entry of a transaction */
+    Account account;
+} WalEntry;
+
+/**
+ * @brief Growable array of log entries, with the ledger entries they carry
+ */
+typedef struct
+{
+    WalEntry *entries;
+    size_t count;
+    size_t capacity;
+    LedgerEntry *history;
+    size_t historyCount;
+    size_t historyCapacity;
+} WalGroup;
+
+static FILE *walFile = NULL;
+
+/** @brief Guards every variable below */
+static pthread_mutex_t walLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief Signalled whenever a flush finishes */
+static pthread_cond_t walFlushed = PTHREAD_COND_INITIALIZER;
+
+/** @brief Entries of the group being formed, not yet written to the log */
+static WalGroup pending;
+
+/** @brief Entries being written by the current leader */
+static WalGroup inflight;
+
+/** @brief Non-zero while a leader flushes (or a checkpoint runs) */
+static int flushing = 0;
+
+/** @brief Sequence number given to the next appended entry */
+static uint64_t nextLsn = 1;
+
+/** @brief Every entry up to this sequence number is durable and applied */
+static uint64_t durableLsn = 0;
+
+/** @brief Slot the next new account will occupy */
+static size_t nextAppendSlot = 0;
+
+/** @brief Set when a flush fails; cleared by walOpen() */
+static int walFailed = 0;
+
+/**
+ * @brief FNV-1a checksum of everything in an entry after the checksum field
+ */
+static uint32_t entryChecksum(const WalEntry *entry)
+{
+    const unsigned char *bytes = (const unsigned char *)&entry->lsn;
+    size_t length = sizeof(WalEntry) - offsetof(WalEntry, lsn);
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Writes one logged record into the store
+ * @return 1 on success, 0 if the slot lies beyond the end of the store
+ */
+static int applyEntry(const WalEntry *entry)
+{
+    if (entry->slot < storeRecordCount())
+        return storeWriteRecord(entry->slot, &entry->account);
+    if (entry->slot == storeRecordCount())
+        return storeAppendRecord(&entry->account) >= 0;
+    return 0;
+}
+
+/**
+ * @brief Makes room for more entries in a group
+ * @return 1 on success, 0 if out of memory
+ */
+static int reserve(WalGroup *group, size_t extra)
+{
+    if (group->count + extra <= group->capacity)
+        return 1;
+
+    size_t capacity = group->capacity ? group->capacity : 64;
+    while (capacity < group->count + extra)
+        capacity *= 2;
+
+    WalEntry *entries = (WalEntry *)realloc(group->entries, capacity * sizeof(WalEntry));
+    if (!entries)
+        return 0;
+    group->entries = entries;
+    group->capacity = capacity;
+    return 1;
+}
+
+/**
+ * @brief Makes room for more ledger entries in a group
+ * @return 1 on success, 0 if out of memory
+ */
+static int reserveHistory(WalGroup *group, size_t extra)
+{
+    if (group->historyCount + extra <= group->historyCapacity)
+        return 1;
+
+    size_t capacity = group->historyCapacity ? group->historyCapacity : 64;
+    while (capacity < group->historyCount + extra)
+        capacity *= 2;
+
+    LedgerEntry *history = (LedgerEntry *)realloc(group->history, capacity * sizeof(LedgerEntry));
+    if (!history)
+        return 0;
+    group->history = history;
+    group->historyCapacity = capacity;
+    return 1;
+}
+
+/**
+ * @brief Fills in a new entry at the end of the pending group
+ *
+ * Caller holds walLock and has reserved room for the entry.
+ */
+static uint64_t pushEntry(size_t slot, const Account *account, int txnLast)
+{
+    WalEntry *entry = &pending.entries[pending.count++];
+    memset(entry, 0, sizeof(*entry));
+    entry->magic = WAL_ENTRY_MAGIC;
+    entry->lsn = nextLsn++;
+    entry->slot = (uint32_t)slot;
+    entry->txnLast = (uint32_t)txnLast;
+    entry->account = *account;
+    entry->checksum = entryChecksum(entry);
+    if (slot == nextAppendSlot)
+        nextAppendSlot++;
+    return entry->lsn;
+}
+
+/**
+ * @brief Writes a group at the end of the log and syncs it
+ * @param end Receives the log size after the write
+ * @return 1 on success, 0 on failure
+ *
+ * Written to the descriptor rather than through stdio, so that a failed
+ * group is not left in a buffer for a later flush to write after all. On
+ * failure the log is cut back to its previous end, as far as possible.
+ */
+static int writeGroup(const WalGroup *group, off_t *end)
+{
+    int fd = fileno(walFile);
+    off_t start = lseek(fd, 0, SEEK_END);
+    const char *bytes = (const char *)group->entries;
+    size_t left = group->count * sizeof(WalEntry);
+
+    if (start < 0)
+        return 0;
+    while (left > 0)
+    {
+        ssize_t n = write(fd, bytes, left);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        bytes += n;
+        left -= (size_t)n;
+    }
+    if (left > 0 || fsync(fd) != 0)
+    {
+        if (ftruncate(fd, start) != 0)
+            perror("accounts: log");
+        return 0;
+    }
+    *end = start + (off_t)(group->count * sizeof(WalEntry));
+    return 1;
+}
+
+/**
+ * @brief Syncs the store and empties the log; caller owns the flush role
+ */
+static int checkpointAsLeader()
+{
+    if (!storeSync())
+        return 0;
+    if (ftruncate(fileno(walFile), 0) != 0)
+        return 0;
+    rewind(walFile);
+    return 1;
+}
+
+/**
+ * @brief Opens (or creates) the log file
+ * @param path Location of the log file
+ * @return 1 on success, 0 on failure
+ */
+int walOpen(const char *path)
+{
+    walClose();
+
+    walFile = fopen(path, "r+b");
+    if (!walFile)
+        walFile = fopen(path, "w+b");
+    nextAppendSlot = storeRecordCount();
+    walFailed = 0;
+    return walFile != NULL;
+}
+
+/**
+ * @brief Replays the log into the store, then checkpoints
+ * @return Number of entries replayed, or -1 on failure
+ *
+ * Must run after storeOpen() and before the store is used. Entries are
+ * applied a whole transaction at a time; an incomplete transaction at the
+ * tail of the log was never acknowledged and is dropped.
+ */
+long walRecover()
+{
+    WalEntry txn[WAL_MAX_TXN_RECORDS];
+    size_t txnCount = 0;
+    long replayed = 0;
+
+    if (!walFile)
+        return -1;
+
+    rewind(walFile);
+    while (txnCount < WAL_MAX_TXN_RECORDS && fread(&txn[txnCount], sizeof(WalEntry), 1, walFile) == 1)
+    {
+        WalEntry *entry = &txn[txnCount];
+        if (entry->magic != WAL_ENTRY_MAGIC || entry->checksum != entryChecksum(entry))
+            break;
+        if ((replayed > 0 || txnCount > 0) && entry->lsn != nextLsn)
+            break;
+        nextLsn = entry->lsn + 1;
+        txnCount++;
+
+        if (!entry->txnLast)
+            continue;
+        for (size_t i = 0; i < txnCount; i++)
+        {
+            if (!applyEntry(&txn[i]))
+                return -1;
+        }
+        replayed += (long)txnCount;
+        txnCount = 0;
+    }
+
+    durableLsn = nextLsn - 1;
+    nextAppendSlot = storeRecordCount();
+    return walCheckpoint() ? replayed : -1;
+}
+
+/**
+ * @brief Adds an all-or-nothing set of record updates, and the ledger
+ *        entries describing them, to the current group
+ * @param slots Record slot written by each update
+ * @param accounts New contents of each record
+ * @param count Number of updates (at most 16)
+ * @param history Ledger entries from ledgerEntryInit() (may be NULL)
+ * @param historyCount Number of ledger entries
+ * @return Sequence number to pass to walCommitUpTo(), or 0 on failure
+ *
+ * The ledger entries are recorded only if the group commits. A slot equal
+ * to walNextAppendSlot() appends a new record; use walAppendNew() when
+ * several threads may create accounts at once.
+ */
+uint64_t walAppendHistory(const size_t *slots, const Account *accounts, int count, const LedgerEntry *history,
+                          int historyCount)
+{
+    uint64_t lsn = 0;
+
+    if (count <= 0 || count > WAL_MAX_TXN_RECORDS || historyCount < 0)
+        return 0;
+
+    pthread_mutex_lock(&walLock);
+    if (!walFailed && reserve(&pending, (size_t)count) && reserveHistory(&pending, (size_t)historyCount))
+    {
+        for (int i = 0; i < count; i++)
+            lsn = pushEntry(slots[i], &accounts[i], i == count - 1);
+        if (historyCount > 0)
+            memcpy(&pending.history[pending.historyCount], history, historyCount * sizeof(LedgerEntry));
+        pending.historyCount += (size_t)historyCount;
+    }
+    pthread_mutex_unlock(&walLock);
+    return lsn;
+}
+
+/**
+ * @brief Adds an all-or-nothing set of record updates to the current group
+ * @return Sequence number to pass to walCommitUpTo(), or 0 on failure
+ */
+uint64_t walAppendRecords(const size_t *slots, const Account *accounts, int count)
+{
+    return walAppendHistory(slots, accounts, count, NULL, 0);
+}
+
+/**
+ * @brief Adds a single record update to the current group
+ * @return Sequence number of the update, or 0 on failure
+ */
+uint64_t walAppend(size_t slot, const Account *account)
+{
+    return walAppendRecords(&slot, account, 1);
+}
+
+/**
+ * @brief Appends a new record, choosing its slot atomically
+ * @param account Contents of the new record
+ * @param slot Receives the slot the record will occupy
+ * @param history Ledger entry recorded once the record commits (may be NULL)
+ * @return Sequence number of the update, or 0 on failure
+ */
+uint64_t walAppendNew(const Account *account, size_t *slot, const LedgerEntry *history)
+{
+    uint64_t lsn = 0;
+
+    pthread_mutex_lock(&walLock);
+    *slot = nextAppendSlot;
+    if (!walFailed && reserve(&pending, 1) && (!history || reserveHistory(&pending, 1)))
+    {
+        lsn = pushEntry(nextAppendSlot, account, 1);
+        if (history)
+            pending.history[pending.historyCount++] = *history;
+    }
+    pthread_mutex_unlock(&walLock);
+    return lsn;
+}
+
+/**
+ * @brief Returns the number of updates waiting for the next commit
+ */
+size_t walPendingCount()
+{
+    pthread_mutex_lock(&walLock);
+    size_t count = pending.count;
+    pthread_mutex_unlock(&walLock);
+    return count;
+}
+
+/**
+ * @brief Returns the slot the next appended record will occupy
+ *
+ * Accounts on appended slots can be used before their group commits.
+ */
+size_t walNextAppendSlot()
+{
+    pthread_mutex_lock(&walLock);
+    size_t slot = nextAppendSlot;
+    pthread_mutex_unlock(&walLock);
+    return slot;
+}
+
+/**
+ * @brief Searches a group for the newest image of a slot
+ */
+static int findInGroup(const WalGroup *group, size_t slot, Account *account)
+{
+    for (size_t i = group->count; i > 0; i--)
+    {
+        if (group->entries[i - 1].slot == slot)
+        {
+            *account = group->entries[i - 1].account;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Finds the newest image of a record slot not yet in the store
+ * @param slot Record slot to look for
+ * @param account Receives the record if found
+ * @return 1 if the slot has an update still on its way to the store
+ */
+int walPendingLookup(size_t slot, Account *account)
+{
+    pthread_mutex_lock(&walLock);
+    int found = findInGroup(&pending, slot, account) || findInGroup(&inflight, slot, account);
+    pthread_mutex_unlock(&walLock);
+    return found;
+}
+
+/**
+ * @brief Waits until every update up to a sequence number is durable
+ * @param lsn Sequence number returned by an append
+ * @return 1 on success, 0 if the log could not be written
+ *
+ * The calling thread either leads a flush itself or waits for the leader
+ * whose group holds its update. Once a flush has failed, every update not
+ * yet durable fails until the log is reopened.
+ */
+int walCommitUpTo(uint64_t lsn)
+{
+    int ok = 1;
+
+    pthread_mutex_lock(&walLock);
+    while (durableLsn < lsn)
+    {
+        if (flushing)
+        {
+            pthread_cond_wait(&walFlushed, &walLock);
+            continue;
+        }
+        if (!walFile || walFailed)
+        {
+            ok = 0;
+            break;
+        }
+
+        // Become the leader: take the whole group formed so far
+        WalGroup group = pending;
+        pending = inflight;
+        pending.count = 0;
+        pending.historyCount = 0;
+        inflight = group;
+        uint64_t groupLsn = nextLsn - 1;
+        flushing = 1;
+        pthread_mutex_unlock(&walLock);
+
+        off_t end = 0;
+        ok = writeGroup(&group, &end);
+        for (size_t i = 0; ok && i < group.count; i++)
+            ok = applyEntry(&group.entries[i]);
+        ok = ok && ledgerRecord(group.history, group.historyCount);
+        if (ok && end >= WAL_CHECKPOINT_BYTES)
+            ok = checkpointAsLeader();
+
+        pthread_mutex_lock(&walLock);
+        inflight.count = 0;
+        inflight.historyCount = 0;
+        if (ok)
+            durableLsn = groupLsn;
+        else
+        {
+            // Nothing after durableLsn will reach the log; forget it
+            walFailed = 1;
+            pending.count = 0;
+            pending.historyCount = 0;
+            nextAppendSlot = storeRecordCount();
+        }
+        flushing = 0;
+        pthread_cond_broadcast(&walFlushed);
+        if (!ok)
+            break;
+    }
+    pthread_mutex_unlock(&walLock);
+
+    // The cache holds the images of the lost updates; each failing caller
+    // clears it after its own, so none of them can be read back
+    if (!ok)
+        cacheClear();
+    return ok;
+}
+
+/**
+ * @brief Makes every update appended so far durable, with one fsync
+ * @return 1 on success, 0 on failure
+ */
+int walCommit()
+{
+    pthread_mutex_lock(&walLock);
+    uint64_t lsn = nextLsn - 1;
+    pthread_mutex_unlock(&walLock);
+    return walCommitUpTo(lsn);
+}
+
+/**
+ * @brief Syncs the store and empties the log
+ * @return 1 on success, 0 on failure
+ *
+ * Commits any pending group first. After a checkpoint every logged change
+ * is on stable storage in the store itself.
+ */
+int walCheckpoint()
+{
+    if (!walFile || !walCommit())
+        return 0;
+
+    pthread_mutex_lock(&walLock);
+    while (flushing)
+        pthread_cond_wait(&walFlushed, &walLock);
+    flushing = 1;
+    pthread_mutex_unlock(&walLock);
+
+    int ok = checkpointAsLeader();
+
+    pthread_mutex_lock(&walLock);
+    flushing = 0;
+    pthread_cond_broadcast(&walFlushed);
+    pthread_mutex_unlock(&walLock);
+    return ok;
+}
+
+/**
+ * @brief Opens a store snapshot at a commit boundary
+ * @return Number of records in the snapshot, or -1 on failure
+ *
+ * Holding the leader role keeps any group from being half applied to the
+ * store when the snapshot is taken, so it holds exactly the updates that
+ * were durable at that moment. Read it with storeSnapshotRead().
+ */
+long walSnapshot()
+{
+    if (!walFile || !walCommit())
+        return -1;
+
+    pthread_mutex_lock(&walLock);
+    while (flushing)
+        pthread_cond_wait(&walFlushed, &walLock);
+    flushing = 1;
+    pthread_mutex_unlock(&walLock);
+
+    long count = storeSnapshotBegin();
+
+    pthread_mutex_lock(&walLock);
+    flushing = 0;
+    pthread_cond_broadcast(&walFlushed);
+    pthread_mutex_unlock(&walLock);
+    return count;
+}
+
+/**
+ * @brief Checkpoints, then cuts the store back to its first records
+ * @param recordCount Number of records to keep
+ * @return 1 on success, 0 on failure
+ *
+ * The caller must make sure that nothing is appended meanwhile and that
+ * every record beyond recordCount is unused; new accounts then append at
+ * recordCount again.
+ */
+int walTruncate(size_t recordCount)
+{
+    if (!walFile || !walCommit())
+        return 0;
+
+    pthread_mutex_lock(&walLock);
+    while (flushing)
+        pthread_cond_wait(&walFlushed, &walLock);
+    flushing = 1;
+    pthread_mutex_unlock(&walLock);
+
+    int ok = pending.count == 0 && checkpointAsLeader() && storeTruncate(recordCount);
+
+    pthread_mutex_lock(&walLock);
+    if (ok)
+        nextAppendSlot = recordCount;
+    flushing = 0;
+    pthread_cond_broadcast(&walFlushed);
+    pthread_mutex_unlock(&walLock);
+    return ok;
+}
+
+/**
+ * @brief Checkpoints and closes the log
+ */
+void walClose()
+{
+    if (walFile)
+    {
+        if (!walCheckpoint())
+            perror("accounts: checkpoint");
+        fclose(walFile);
+        walFile = NULL;
+    }
+    free(pending.entries);
+    free(inflight.entries);
+    free(pending.history);
+    free(inflight.history);
+    memset(&pending, 0, sizeof(pending));
+    memset(&inflight, 0, sizeof(inflight));
+    nextAppendSlot = 0;
+}
@@ -0,0 +1,446 @@
+/**
+ * @file bank_batch.c
+ * @brief Non-interactive batch ingestion of deposit/withdraw transactions
+ *
+ * A transaction file is applied in one pass over the account store: every
+ * transaction is resolved to its record slot, the transactions are sorted
+ * by (slot, position in the file), and each touched record is then read
+ * once, has all of its transactions applied in their original order, and
+ * is written back once. Updates are logged in large groups, so the whole
+ * batch costs a handful of fsyncs. Results are reported in input order.
+ *
+ * Two input formats are accepted:
+ * - CSV, one transaction per line: op,account,amount (e.g. "D,1001,250.00").
+ *   Empty lines and lines starting with '#' are ignored.
+ * - Binary: the 8 bytes "BANKTXN2" followed by packed BatchRecord entries
+ *   holding amounts in minor units. Files written in the older "BANKTXN1"
+ *   layout, with float amounts, are still accepted and rounded to cents.
+ *
+ * Ops are D (deposit), W (withdraw) and B (balance enquiry, amount ignored).
+ * The results file is CSV: line,op,account,amount,status,balance.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include "bank_management_system.h"
+
+/** @brief Magic prefix identifying a binary transaction file */
+#define BATCH_MAGIC "BANKTXN2"
+
+/** @brief Magic prefix of the older float-amount binary format */
+#define BATCH_MAGIC_LEGACY "BANKTXN1"
+
+/** @brief Account updates logged per fsync while a batch runs */
+#define BATCH_GROUP_COMMIT 4096
+
+/** @brief Sorts after every real slot, for transactions on unknown accounts */
+#define NO_SLOT SIZE_MAX
+
+/**
+ * @struct BatchRecord
+ * @brief On-disk layout of one transaction in a binary batch file
+ */
+typedef struct
+{
+    int64_t amount; /**< Amount in minor units */
+    int32_t accountNumber;
+    char op;
+    char reserved[3];
+} BatchRecord;
+
+/**
+ * @struct LegacyBatchRecord
+ * @brief Layout of one transaction in a "BANKTXN1" file
+ */
+typedef struct
+{
+    int32_t accountNumber;
+    float amount;
+    char op;
+    char reserved[3];
+} LegacyBatchRecord;
+
+/**
+ * @struct Transaction
+ * @brief One parsed transaction and, once applied, its outcome
+ */
+typedef struct
+{
+    size_t slot;       /**< Record slot of the account, NO_SLOT if unknown */
+    size_t line;       /**< Position in the input, used to keep file order */
+    int accountNumber;
+    money_t amount;
+    money_t balance;   /**< Balance after the transaction */
+    char op;
+    const char *status;
+} Transaction;
+
+/**
+ * @brief Growable array of transactions
+ */
+typedef struct
+{
+    Transaction *items;
+    size_t count;
+    size_t capacity;
+} TransactionList;
+
+/**
+ * @brief Appends a transaction, growing the list as needed
+ * @return Pointer to the new entry, or NULL if out of memory
+ */
+static Transaction *addTransaction(TransactionList *list)
+{
+    if (list->count == list->capacity)
+    {
+        size_t capacity = list->capacity ? list->capacity * 2 : 1024;
+        Transaction *items = (Transaction *)realloc(list->items, capacity * sizeof(Transaction));
+        if (!items)
+            return NULL;
+        list->items = items;
+        list->capacity = capacity;
+    }
+
+    Transaction *t = &list->items[list->count];
+    memset(t, 0, sizeof(*t));
+    t->line = list->count++;
+    return t;
+}
+
+/**
+ * @brief Parses one CSV line into a transaction
+ * @return 1 if a transaction was stored, 0 if the line is blank or a comment,
+ *         -1 if out of memory
+ */
+static int parseCsvLine(TransactionList *list, char *line)
+{
+    while (*line == ' ' || *line == '\t')
+        line++;
+    if (*line == '\0' || *line == '\n' || *line == '\r' || *line == '#')
+        return 0;
+
+    Transaction *t = addTransaction(list);
+    if (!t)
+        return -1;
+
+    char op;
+    int accountNumber;
+    char amountText[32];
+    money_t amount = 0;
+    int fields = sscanf(line, " %c , %d , %31[^, \t\r\n]", &op, &accountNumber, amountText);
+    if (fields == 3 && !parseMoney(amountText, &amount))
+        fields = 0;
+    if (fields < 2 || (fields < 3 && op != 'B' && op != 'b'))
+    {
+        t->op = '?';
+        t->status = "BAD_LINE";
+        return 1;
+    }
+
+    t->op = op;
+    t->accountNumber = accountNumber;
+    t->amount = amount;
+    return 1;
+}
+
+/**
+ * @brief Reads a whole transaction file, detecting its format
+ * @return 1 on success, 0 on failure
+ */
+static int loadTransactions(const char *path, TransactionList *list)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return 0;
+
+    char magic[sizeof(BATCH_MAGIC) - 1];
+    int hasMagic = fread(magic, 1, sizeof(magic), file) == sizeof(magic);
+    int binary = hasMagic && memcmp(magic, BATCH_MAGIC, sizeof(magic)) == 0;
+    int legacy = hasMagic && memcmp(magic, BATCH_MAGIC_LEGACY, sizeof(magic)) == 0;
+
+    int ok = 1;
+    if (legacy)
+    {
+        LegacyBatchRecord record;
+        while (ok && fread(&record, sizeof(record), 1, file) == 1)
+        {
+            Transaction *t = addTransaction(list);
+            if (!t)
+            {
+                ok = 0;
+                break;
+            }
+            t->op = record.op;
+            t->accountNumber = record.accountNumber;
+            t->amount = (money_t)llround((double)record.amount * MONEY_SCALE);
+        }
+    }
+    else if (binary)
+    {
+        BatchRecord record;
+        while (ok && fread(&record, sizeof(record), 1, file) == 1)
+        {
+            Transaction *t = addTransaction(list);
+            if (!t)
+            {
+                ok = 0;
+                break;
+            }
+            t->op = record.op;
+            t->accountNumber = record.accountNumber;
+            t->amount = record.amount;
+        }
+    }
+    else
+    {
+        char line[256];
+        rewind(file);
+        while (ok && fgets(line, sizeof(line), file))
+            ok = parseCsvLine(list, line) >= 0;
+    }
+
+    fclose(file);
+    return ok;
+}
+
+/**
+ * @brief Orders transactions by record slot, then by position in the file
+ */
+static int compareBySlot(const void *a, const void *b)
+{
+    const Transaction *x = (const Transaction *)a;
+    const Transaction *y = (const Transaction *)b;
+    if (x->slot != y->slot)
+        return x->slot < y->slot ? -1 : 1;
+    return x->line < y->line ? -1 : (x->line > y->line);
+}
+
+/**
+ * @brief Restores the original file order
+ */
+static int compareByLine(const void *a, const void *b)
+{
+    const Transaction *x = (const Transaction *)a;
+    const Transaction *y = (const Transaction *)b;
+    return x->line < y->line ? -1 : (x->line > y->line);
+}
+
+/**
+ * @brief Applies one transaction to an account held in memory
+ *
+ * Uses the same rules as depositMoney() and withdrawMoney().
+ */
+static void applyTransaction(Transaction *t, Account *account)
+{
+    switch (t->op)
+    {
+    case 'D':
+    case 'd':
+    {
+        money_t updated;
+        if (t->amount <= 0 || __builtin_add_overflow(account->balance, t->amount, &updated))
+            t->status = "INVALID_AMOUNT"; // Also if the balance would leave the range of money_t
+        else
+        {
+            account->balance = updated;
+            t->status = "OK";
+        }
+        break;
+    }
+    case 'W':
+    case 'w':
+        if (t->amount <= 0)
+            t->status = "INVALID_AMOUNT";
+        else if (t->amount > account->balance)
+            t->status = "INSUFFICIENT_FUNDS";
+        else
+        {
+            account->balance -= t->amount;
+            t->status = "OK";
+        }
+        break;
+    case 'B':
+    case 'b':
+        t->status = "OK";
+        break;
+    default:
+        t->status = "BAD_OP";
+    }
+    t->balance = account->balance;
+}
+
+/**
+ * @brief Reports the successful transactions in [first, end) as failed
+ *
+ * Used when their updates could not be logged or committed.
+ */
+static void failApplied(TransactionList *list, size_t first, size_t end)
+{
+    for (size_t i = first; i < end; i++)
+        if (strcmp(list->items[i].status, "OK") == 0)
+            list->items[i].status = "IO_ERROR";
+}
+
+/**
+ * @brief Records the committed balance changes of [0, end) in the ledger
+ * @return 1 on success, 0 on failure
+ *
+ * Called once the batch has committed, so history is only kept for changes
+ * that are durable. The transactions are still in (slot, line) order, which
+ * keeps each account's entries in the order of its changes.
+ */
+static int recordHistory(const TransactionList *list, size_t end)
+{
+    LedgerEntry *history = (LedgerEntry *)malloc((end ? end : 1) * sizeof(LedgerEntry));
+    size_t count = 0;
+
+    if (!history)
+        return 0;
+    for (size_t i = 0; i < end; i++)
+    {
+        const Transaction *t = &list->items[i];
+        int deposit = t->op == 'D' || t->op == 'd', withdrawal = t->op == 'W' || t->op == 'w';
+        if (strcmp(t->status, "OK") == 0 && (deposit || withdrawal))
+            ledgerEntryInit(&history[count++], t->accountNumber, deposit ? LEDGER_DEPOSIT : LEDGER_WITHDRAW,
+                            deposit ? t->amount : -t->amount, t->balance);
+    }
+    int ok = ledgerRecord(history, count);
+    free(history);
+    return ok;
+}
+
+/**
+ * @brief Applies every transaction, touching each account record once
+ * @param written Receives the number of account records written back
+ * @return 1 on success, 0 if some updates could not be made durable
+ */
+static int applyAll(TransactionList *list, size_t *written)
+{
+    for (size_t i = 0; i < list->count; i++)
+    {
+        long slot = list->items[i].status ? -1 : indexLookup(list->items[i].accountNumber);
+        list->items[i].slot = slot < 0 ? NO_SLOT : (size_t)slot;
+    }
+    qsort(list->items, list->count, sizeof(Transaction), compareBySlot);
+
+    size_t previousGroup = bankSetGroupCommit(BATCH_GROUP_COMMIT);
+    int ok = 1;
+    size_t i = 0;
+    *written = 0;
+    while (i < list->count && list->items[i].slot != NO_SLOT)
+    {
+        size_t slot = list->items[i].slot, first = i;
+        Account account;
+        int loaded = bankReadRecord(slot, &account);
+        int dirty = 0;
+
+        for (; i < list->count && list->items[i].slot == slot; i++)
+        {
+            Transaction *t = &list->items[i];
+            if (!loaded)
+            {
+                t->status = "IO_ERROR";
+                continue;
+            }
+            money_t before = account.balance;
+            applyTransaction(t, &account);
+            dirty |= account.balance != before;
+        }
+
+        if (dirty)
+        {
+            if (!bankUpdateRecord(slot, &account))
+            {
+                fprintf(stderr, "Cannot log update of account %d\n", account.accountNumber);
+                failApplied(list, first, i);
+                ok = 0;
+            }
+            (*written)++;
+        }
+    }
+    if (!bankCommit())
+    {
+        // Nothing applied is known to be durable, balance enquiries included
+        fprintf(stderr, "Cannot commit batch updates\n");
+        failApplied(list, 0, i);
+        ok = 0;
+    }
+    else if (!recordHistory(list, i))
+    {
+        // The balances are durable; only their history is missing
+        fprintf(stderr, "Cannot record batch history in the ledger\n");
+        ok = 0;
+    }
+    bankSetGroupCommit(previousGroup);
+
+    for (; i < list->count; i++)
+        if (!list->items[i].status)
+            list->items[i].status = "NOT_FOUND";
+
+    qsort(list->items, list->count, sizeof(Transaction), compareByLine);
+    return ok;
+}
+
+/**
+ * @brief Writes the outcome of every transaction in input order
+ * @return 1 on success, 0 on failure
+ */
+static int writeResults(const char *path, const TransactionList *list)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+        return 0;
+
+    fprintf(file, "line,op,account,amount,status,balance\n");
+    for (size_t i = 0; i < list->count; i++)
+    {
+        const Transaction *t = &list->items[i];
+        char amount[24], balance[24];
+        fprintf(file, "%zu,%c,%d,%s,%s,%s\n", t->line + 1, t->op, t->accountNumber,
+                formatMoney(t->amount, amount, sizeof(amount)), t->status,
+                formatMoney(t->balance, balance, sizeof(balance)));
+    }
+
+    return fclose(file) == 0;
+}
+
+/**
+ * @brief Runs a batch of transactions against the open database
+ * @param inputPath Transaction file (CSV or binary)
+ * @param outputPath Results file to create
+ * @return 1 on success, 0 on failure
+ */
+int runBatch(const char *inputPath, const char *outputPath)
+{
+    TransactionList list = {NULL, 0, 0};
+    struct timespec start, end;
+
+    if (!bankEnsureOpen())
+        return 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (!loadTransactions(inputPath, &list))
+    {
+        fprintf(stderr, "Cannot read transactions from %s\n", inputPath);
+        free(list.items);
+        return 0;
+    }
+
+    size_t written;
+    int applied = applyAll(&list, &written);
+    int ok = writeResults(outputPath, &list);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("Applied %zu transactions, updated %zu accounts in %.3f s (%.0f tx/s)\n",
+           list.count, written, seconds, seconds > 0 ? list.count / seconds : 0.0);
+    if (!ok)
+        fprintf(stderr, "Cannot write results to %s\n", outputPath);
+
+    free(list.items);
+    return ok && applied;
+}
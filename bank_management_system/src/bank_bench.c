@@ -0,0 +1,532 @@
+/**
+ * @file bank_bench.c
+ * @brief Workload generator and throughput/latency benchmark for the engine
+ *
+ * Builds a synthetic database of the requested size (or reuses one kept
+ * from an earlier run), then runs an operation mix against the
+ * multi-threaded transaction engine with 1, 2, ... up to one thread per
+ * core, or with a fixed thread count. For each run it reports the
+ * throughput and the 50th, 99th and 99.9th percentile latency, and for the
+ * last run a breakdown per operation.
+ *
+ * Accounts are picked uniformly or from a Zipfian distribution, where a
+ * few hot accounts take most of the traffic (theta 0.99 is the usual
+ * "skewed" setting). Latencies are recorded in log-linear histograms with
+ * 1/32 relative precision, so runs of any length use constant memory.
+ *
+ * Usage: bank_bench [accounts] [operations per thread] [max threads]
+ *                   [--threads <n>] [--mix <op>=<percent>,...]
+ *                   [--zipf <theta>] [--db <file>] [--keep]
+ *   accounts     Accounts in the database, default 10000 (1k to 10M)
+ *   --threads    Run only this thread count instead of 1..max
+ *   --mix        Percentages of create, deposit, withdraw, lookup and
+ *                transfer operations; default deposit=45,withdraw=45,
+ *                transfer=10
+ *   --zipf       Pick accounts from a Zipfian distribution (default uniform)
+ *   --db         Database to build, default bench_accounts.dat
+ *   --keep       Keep the database afterwards and reuse it when it already
+ *                holds the requested number of accounts
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "bank_management_system.h"
+
+/** @brief Scratch database used by the benchmark */
+#define BENCH_FILENAME "bench_accounts.dat"
+
+/** @brief Records written per call while building the database */
+#define BENCH_BUILD_BATCH 8192
+
+/** @brief Histogram sub-buckets per power of two (log2 of) */
+#define LATENCY_SUB_BITS 5
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BITS)
+
+/** @brief Histogram buckets, covering latencies up to 2^40 ns */
+#define LATENCY_BUCKETS ((40 - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS)
+
+/** @brief Operation kinds of the mix */
+enum
+{
+    OP_CREATE,
+    OP_DEPOSIT,
+    OP_WITHDRAW,
+    OP_LOOKUP,
+    OP_TRANSFER,
+    OP_KINDS
+};
+
+static const char *const opNames[OP_KINDS] = {"create", "deposit", "withdraw", "lookup", "transfer"};
+
+/**
+ * @struct Histogram
+ * @brief Log-linear latency histogram in nanoseconds
+ */
+typedef struct
+{
+    uint64_t counts[LATENCY_BUCKETS];
+    uint64_t total;
+    uint64_t maximum;
+} Histogram;
+
+/**
+ * @struct Zipf
+ * @brief Constants of the Zipfian generator (Gray et al., "Quickly
+ *        generating billion-record synthetic databases")
+ */
+typedef struct
+{
+    uint64_t items;
+    double theta;
+    double alpha;
+    double zetan;
+    double eta;
+} Zipf;
+
+/**
+ * @struct Worker
+ * @brief Parameters and results of one benchmark thread
+ */
+typedef struct
+{
+    pthread_t thread;
+    uint64_t seed;
+    int accounts;
+    int operations;
+    int failures;
+    const int *mix;     /**< Cumulative percentages per operation kind */
+    const Zipf *zipf;   /**< NULL for uniform account choice */
+    Histogram *latency; /**< One histogram per operation kind */
+} Worker;
+
+/** @brief Next account number handed to a create operation */
+static int nextNewAccount;
+
+/**
+ * @brief xorshift64* pseudo-random generator, one state per thread
+ */
+static uint64_t nextRandom(uint64_t *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ull;
+}
+
+/**
+ * @brief Uniform random number in [0, 1)
+ */
+static double nextUnit(uint64_t *state)
+{
+    return (double)(nextRandom(state) >> 11) / 9007199254740992.0;
+}
+
+static void zipfInit(Zipf *zipf, uint64_t items, double theta)
+{
+    double zeta2 = 1.0 + pow(0.5, theta);
+
+    zipf->items = items;
+    zipf->theta = theta;
+    zipf->zetan = 0;
+    for (uint64_t i = 1; i <= items; i++)
+        zipf->zetan += 1.0 / pow((double)i, theta);
+    zipf->alpha = 1.0 / (1.0 - theta);
+    zipf->eta = (1.0 - pow(2.0 / (double)items, 1.0 - theta)) / (1.0 - zeta2 / zipf->zetan);
+}
+
+/**
+ * @brief Draws a rank in [0, items); rank 0 is the most popular
+ */
+static uint64_t zipfNext(const Zipf *zipf, uint64_t *state)
+{
+    double u = nextUnit(state);
+    double uz = u * zipf->zetan;
+
+    if (uz < 1.0)
+        return 0;
+    if (uz < 1.0 + pow(0.5, zipf->theta))
+        return 1;
+    uint64_t rank = (uint64_t)((double)zipf->items * pow(zipf->eta * u - zipf->eta + 1.0, zipf->alpha));
+    return rank < zipf->items ? rank : zipf->items - 1;
+}
+
+/**
+ * @brief Picks an existing account number
+ */
+static int pickAccount(const Worker *worker, uint64_t *state)
+{
+    if (worker->zipf)
+        return 1 + (int)zipfNext(worker->zipf, state);
+    return 1 + (int)(nextRandom(state) % (uint64_t)worker->accounts);
+}
+
+/**
+ * @brief Histogram bucket of a latency
+ */
+static size_t bucketOf(uint64_t nanoseconds)
+{
+    if (nanoseconds < LATENCY_SUB_BUCKETS)
+        return (size_t)nanoseconds;
+    int magnitude = 63 - __builtin_clzll(nanoseconds); // >= LATENCY_SUB_BITS
+    size_t bucket = (size_t)(magnitude - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS +
+                    (size_t)((nanoseconds >> (magnitude - LATENCY_SUB_BITS)) - LATENCY_SUB_BUCKETS);
+    return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+
+/**
+ * @brief Upper bound of the latencies counted in a bucket
+ */
+static uint64_t bucketLimit(size_t bucket)
+{
+    if (bucket < LATENCY_SUB_BUCKETS)
+        return bucket;
+    int magnitude = (int)(bucket / LATENCY_SUB_BUCKETS) + LATENCY_SUB_BITS - 1;
+    uint64_t sub = bucket % LATENCY_SUB_BUCKETS + LATENCY_SUB_BUCKETS;
+    return ((sub + 1) << (magnitude - LATENCY_SUB_BITS)) - 1;
+}
+
+static void record(Histogram *histogram, uint64_t nanoseconds)
+{
+    histogram->counts[bucketOf(nanoseconds)]++;
+    histogram->total++;
+    if (nanoseconds > histogram->maximum)
+        histogram->maximum = nanoseconds;
+}
+
+static void merge(Histogram *into, const Histogram *from)
+{
+    for (size_t i = 0; i < LATENCY_BUCKETS; i++)
+        into->counts[i] += from->counts[i];
+    into->total += from->total;
+    if (from->maximum > into->maximum)
+        into->maximum = from->maximum;
+}
+
+/**
+ * @brief Latency below which a fraction of the operations completed
+ */
+static double percentile(const Histogram *histogram, double fraction)
+{
+    uint64_t wanted = (uint64_t)ceil(fraction * (double)histogram->total), seen = 0;
+
+    for (size_t i = 0; i < LATENCY_BUCKETS; i++)
+    {
+        seen += histogram->counts[i];
+        if (seen >= wanted && seen > 0)
+        {
+            uint64_t limit = bucketLimit(i);
+            return (double)(limit < histogram->maximum ? limit : histogram->maximum) / 1000.0;
+        }
+    }
+    return 0;
+}
+
+static uint64_t nanosecondsNow()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @brief Runs the operation mix, timing every operation
+ */
+static void *runWorker(void *arg)
+{
+    Worker *worker = (Worker *)arg;
+
+    for (int i = 0; i < worker->operations; i++)
+    {
+        uint64_t r = nextRandom(&worker->seed);
+        int percent = (int)(r % 100);
+        int kind = 0;
+        while (percent >= worker->mix[kind])
+            kind++;
+        int account = kind == OP_CREATE ? 0 : pickAccount(worker, &worker->seed);
+        int status;
+        money_t balance;
+
+        uint64_t start = nanosecondsNow();
+        switch (kind)
+        {
+        case OP_CREATE:
+            status = engineCreate("bench", __atomic_fetch_add(&nextNewAccount, 1, __ATOMIC_RELAXED));
+            break;
+        case OP_DEPOSIT:
+            status = engineDeposit(account, 10 * MONEY_SCALE, NULL);
+            break;
+        case OP_WITHDRAW:
+            status = engineWithdraw(account, 5 * MONEY_SCALE, NULL);
+            break;
+        case OP_LOOKUP:
+            status = engineBalance(account, &balance);
+            break;
+        default:
+            status = engineTransfer(account, pickAccount(worker, &worker->seed), MONEY_SCALE);
+        }
+        record(&worker->latency[kind], nanosecondsNow() - start);
+
+        if (status == BANK_IO_ERROR)
+            worker->failures++;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Seconds elapsed since a starting point
+ */
+static double secondsSince(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/**
+ * @brief Parses "op=percent,..." into cumulative percentages
+ * @return 1 on success, 0 if the mix is malformed or does not add up to 100
+ */
+static int parseMix(const char *text, int *mix)
+{
+    int percents[OP_KINDS] = {0};
+    char copy[256];
+
+    snprintf(copy, sizeof(copy), "%s", text);
+    for (char *part = strtok(copy, ","); part; part = strtok(NULL, ","))
+    {
+        char *equals = strchr(part, '=');
+        int kind = 0;
+        if (!equals)
+            return 0;
+        *equals = '\0';
+        while (kind < OP_KINDS && strcmp(part, opNames[kind]) != 0)
+            kind++;
+        if (kind == OP_KINDS || atoi(equals + 1) < 0)
+            return 0;
+        percents[kind] = atoi(equals + 1);
+    }
+
+    int total = 0;
+    for (int kind = 0; kind < OP_KINDS; kind++)
+    {
+        total += percents[kind];
+        mix[kind] = total;
+    }
+    return total == 100;
+}
+
+static void removeDatabase(const char *path)
+{
+    const char *suffixes[] = {"", ".idx", ".wal", ".names", ".ledger-heads"};
+    char name[512];
+
+    for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); i++)
+    {
+        snprintf(name, sizeof(name), "%s%s", path, suffixes[i]);
+        remove(name);
+    }
+    for (int segment = 0;; segment++)
+    {
+        snprintf(name, sizeof(name), "%s.ledger-%06d", path, segment);
+        if (remove(name) != 0)
+            break;
+    }
+}
+
+/**
+ * @brief Writes a fresh database of numbered accounts straight to the store
+ * @return 1 on success, 0 on failure
+ *
+ * Going around the log makes building millions of accounts a sequential
+ * write; bankOpen() then indexes them in one pass.
+ */
+static int buildDatabase(const char *path, int accounts)
+{
+    Account *batch = (Account *)calloc(BENCH_BUILD_BATCH, sizeof(Account));
+    int ok = batch && storeOpen(path);
+
+    for (int first = 1; ok && first <= accounts; first += BENCH_BUILD_BATCH)
+    {
+        size_t count = 0;
+        for (int n = first; n <= accounts && count < BENCH_BUILD_BATCH; n++, count++)
+        {
+            snprintf(batch[count].username, sizeof(batch[count].username), "bench%d", n);
+            batch[count].accountNumber = n;
+            batch[count].balance = 1000 * MONEY_SCALE;
+        }
+        ok = storeAppendRecords(batch, count) == count;
+    }
+    ok = ok && storeSync();
+    storeClose();
+    free(batch);
+    return ok;
+}
+
+static void printRow(const char *label, long threads, uint64_t operations, double seconds, const Histogram *latency)
+{
+    printf("%-9s %7ld %12llu %9.3f %11.0f %9.1f %9.1f %9.1f\n", label, threads, (unsigned long long)operations,
+           seconds, seconds > 0 ? (double)operations / seconds : 0.0, percentile(latency, 0.50),
+           percentile(latency, 0.99), percentile(latency, 0.999));
+}
+
+int main(int argc, char *argv[])
+{
+    int accounts = 10000, operations = 2000, keep = 0, positional = 0;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN), fixedThreads = 0;
+    double theta = 0;
+    const char *path = BENCH_FILENAME;
+    int mix[OP_KINDS];
+    struct timespec start;
+
+    parseMix("deposit=45,withdraw=45,transfer=10", mix);
+    for (int i = 1; i < argc; i++)
+    {
+        int ok = 1;
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            ok = (fixedThreads = atol(argv[++i])) > 0;
+        else if (strcmp(argv[i], "--mix") == 0 && i + 1 < argc)
+            ok = parseMix(argv[++i], mix);
+        else if (strcmp(argv[i], "--zipf") == 0 && i + 1 < argc)
+            ok = (theta = atof(argv[++i])) > 0 && theta < 1;
+        else if (strcmp(argv[i], "--db") == 0 && i + 1 < argc)
+            path = argv[++i];
+        else if (strcmp(argv[i], "--keep") == 0)
+            keep = 1;
+        else if (argv[i][0] != '-' && positional == 0)
+            accounts = atoi(argv[i]), positional++;
+        else if (argv[i][0] != '-' && positional == 1)
+            operations = atoi(argv[i]), positional++;
+        else if (argv[i][0] != '-' && positional == 2)
+            cores = atol(argv[i]), positional++;
+        else
+            ok = 0;
+
+        if (!ok)
+            accounts = 0;
+    }
+    if (accounts <= 0 || operations <= 0)
+    {
+        fprintf(stderr,
+                "Usage: %s [accounts] [operations per thread] [max threads]\n"
+                "          [--threads <n>] [--mix <op>=<percent>,...] [--zipf <theta>]\n"
+                "          [--db <file>] [--keep]\n"
+                "Operations: create, deposit, withdraw, lookup, transfer (percentages add up to 100)\n",
+                argv[0]);
+        return 1;
+    }
+    if (cores < 1)
+        cores = 1;
+
+    // Reuse a kept database only if it holds exactly the requested accounts
+    int reuse = 0;
+    if (keep && storeOpen(path))
+    {
+        reuse = storeRecordCount() == (size_t)accounts;
+        storeClose();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (!reuse)
+    {
+        removeDatabase(path);
+        if (!buildDatabase(path, accounts))
+        {
+            fprintf(stderr, "Cannot build %s\n", path);
+            return 1;
+        }
+    }
+    if (!bankOpen(path))
+    {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return 1;
+    }
+    printf("%s %d accounts in %.3f s\n", reuse ? "Opened" : "Built", accounts, secondsSince(&start));
+    nextNewAccount = accounts + 1;
+
+    Zipf zipf;
+    if (theta > 0)
+        zipfInit(&zipf, (uint64_t)accounts, theta);
+    printf("Accounts: %s", theta > 0 ? "zipfian" : "uniform");
+    if (theta > 0)
+        printf(" (theta %.2f)", theta);
+    printf("  Mix:");
+    for (int kind = 0; kind < OP_KINDS; kind++)
+    {
+        int percent = mix[kind] - (kind ? mix[kind - 1] : 0);
+        if (percent)
+            printf(" %s %d%%", opNames[kind], percent);
+    }
+    printf("\n");
+
+    long threadsFrom = fixedThreads ? fixedThreads : 1, threadsTo = fixedThreads ? fixedThreads : cores;
+    Worker *workers = (Worker *)calloc((size_t)threadsTo, sizeof(Worker));
+    Histogram *latency = (Histogram *)calloc((size_t)threadsTo * OP_KINDS, sizeof(Histogram));
+    Histogram byKind[OP_KINDS], overall;
+    double seconds = 0;
+    if (!workers || !latency)
+        return 1;
+
+    printf("%-9s %7s %12s %9s %11s %9s %9s %9s\n", "", "threads", "operations", "seconds", "ops/sec", "p50 us",
+           "p99 us", "p99.9 us");
+    for (long threads = threadsFrom; threads <= threadsTo; threads++)
+    {
+        int failures = 0;
+
+        memset(latency, 0, (size_t)threadsTo * OP_KINDS * sizeof(Histogram));
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (long t = 0; t < threads; t++)
+        {
+            workers[t].seed = 0x9E3779B97F4A7C15ull * (uint64_t)(t + 1);
+            workers[t].accounts = accounts;
+            workers[t].operations = operations;
+            workers[t].failures = 0;
+            workers[t].mix = mix;
+            workers[t].zipf = theta > 0 ? &zipf : NULL;
+            workers[t].latency = &latency[t * OP_KINDS];
+            pthread_create(&workers[t].thread, NULL, runWorker, &workers[t]);
+        }
+        for (long t = 0; t < threads; t++)
+        {
+            pthread_join(workers[t].thread, NULL);
+            failures += workers[t].failures;
+        }
+        seconds = secondsSince(&start);
+
+        memset(byKind, 0, sizeof(byKind));
+        memset(&overall, 0, sizeof(overall));
+        for (long t = 0; t < threads; t++)
+            for (int kind = 0; kind < OP_KINDS; kind++)
+                merge(&byKind[kind], &workers[t].latency[kind]);
+        for (int kind = 0; kind < OP_KINDS; kind++)
+            merge(&overall, &byKind[kind]);
+        printRow("all", threads, overall.total, seconds, &overall);
+        if (failures)
+            printf("          %d operations failed with an I/O error\n", failures);
+    }
+
+    // Breakdown of the last run; each kind's rate is its share of that run
+    for (int kind = 0; kind < OP_KINDS; kind++)
+    {
+        if (byKind[kind].total)
+            printRow(opNames[kind], threadsTo, byKind[kind].total, seconds, &byKind[kind]);
+    }
+
+    CacheStats cache;
+    cacheGetStats(&cache);
+    printf("Record cache: %llu hits, %llu misses (%.1f%% hit rate), %llu evictions\n",
+           (unsigned long long)cache.hits, (unsigned long long)cache.misses,
+           cache.hits + cache.misses ? 100.0 * cache.hits / (cache.hits + cache.misses) : 0.0,
+           (unsigned long long)cache.evictions);
+
+    free(workers);
+    free(latency);
+    bankClose();
+    if (!keep)
+        removeDatabase(path);
+    return 0;
+}
@@ -0,0 +1,587 @@
+/**
+ * @file bank_engine.c
+ * @brief Thread-safe transaction engine with striped per-account locks
+ *
+ * Any number of threads may call these functions at once. Each account
+ * number hashes onto one of a fixed set of lock stripes; an operation holds
+ * its account's stripe while it reads the record, applies the change and
+ * appends the new version to the write-ahead log, so two updates of the
+ * same account can never lose each other's changes. Operations on accounts
+ * in different stripes proceed in parallel.
+ *
+ * The stripe is released as soon as the new version is in the log's pending
+ * group and the record cache, where later readers already see it. Engine
+ * updates are always logged at once, whatever the cache's write policy,
+ * since a BANK_OK result promises durability. The caller then waits for the
+ * group commit, which lets the fsync of one leader cover the updates of
+ * every thread that joined its group. engineExecute() exposes the two
+ * halves separately, so a caller serving many requests (the socket server)
+ * can apply a whole batch and then wait for its commit once.
+ *
+ * Each change carries its ledger entry into the log with the new records,
+ * while the stripe is held, so an account's history is in the same order
+ * as its updates and holds only changes that committed.
+ *
+ * A transfer takes both accounts' stripes, always in increasing stripe
+ * order, so two opposite transfers cannot deadlock. Both new balances are
+ * logged as one transaction and therefore survive a crash together.
+ *
+ * Closing an account overwrites its record with a tombstone and puts the
+ * slot on the free list, where the next new account picks it up.
+ * engineCompact() keeps the record file dense while accounts churn: it
+ * moves the last live records into the lowest free slots, one account (and
+ * one stripe) at a time, then takes every stripe only long enough to cut
+ * the closed records off the end of the file.
+ *
+ * The database must be opened (bankOpen()) before worker threads start.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "bank_management_system.h"
+
+/** @brief Number of lock stripes (a power of two) */
+#define ENGINE_LOCK_STRIPES 4096
+
+static pthread_mutex_t stripes[ENGINE_LOCK_STRIPES];
+static pthread_once_t stripesReady = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Initialises every stripe mutex, once per process
+ */
+static void initStripes()
+{
+    for (int i = 0; i < ENGINE_LOCK_STRIPES; i++)
+        pthread_mutex_init(&stripes[i], NULL);
+}
+
+/**
+ * @brief Maps an account number onto its lock stripe
+ */
+static unsigned stripeOf(int accountNumber)
+{
+    return (((uint32_t)accountNumber * 2654435769u) >> 20) & (ENGINE_LOCK_STRIPES - 1);
+}
+
+static void lockAccount(int accountNumber)
+{
+    pthread_once(&stripesReady, initStripes);
+    pthread_mutex_lock(&stripes[stripeOf(accountNumber)]);
+}
+
+static void unlockAccount(int accountNumber)
+{
+    pthread_mutex_unlock(&stripes[stripeOf(accountNumber)]);
+}
+
+/**
+ * @brief Takes every stripe, stopping all engine operations
+ */
+static void lockAll()
+{
+    pthread_once(&stripesReady, initStripes);
+    for (int i = 0; i < ENGINE_LOCK_STRIPES; i++)
+        pthread_mutex_lock(&stripes[i]);
+}
+
+static void unlockAll()
+{
+    for (int i = ENGINE_LOCK_STRIPES; i-- > 0;)
+        pthread_mutex_unlock(&stripes[i]);
+}
+
+/**
+ * @brief Finds and reads an account; caller holds its stripe
+ * @return Slot of the account, or -1 if it does not exist
+ */
+static long loadAccount(int accountNumber, Account *account)
+{
+    long slot = indexLookup(accountNumber);
+    if (slot < 0 || !bankReadRecord((size_t)slot, account))
+        return -1;
+    if (account->accountNumber != accountNumber || (account->flags & ACCOUNT_CLOSED))
+        return -1;
+    return slot;
+}
+
+/**
+ * @brief Waits for a logged change to become durable
+ */
+static int commitStatus(int status, uint64_t lsn)
+{
+    if (status != BANK_OK || lsn == 0)
+        return status;
+    return walCommitUpTo(lsn) ? BANK_OK : BANK_IO_ERROR;
+}
+
+/**
+ * @brief Logs a new account; caller waits for lsn to commit
+ */
+static int applyCreate(const char *username, int accountNumber, uint64_t *lsn)
+{
+    Account account;
+    LedgerEntry history;
+    size_t slot;
+
+    memset(&account, 0, sizeof(account));
+    snprintf(account.username, sizeof(account.username), "%s", username);
+    account.accountNumber = accountNumber;
+
+    lockAccount(accountNumber);
+    if (indexLookup(accountNumber) >= 0)
+    {
+        unlockAccount(accountNumber);
+        return BANK_DUPLICATE_ACCOUNT;
+    }
+    ledgerEntryInit(&history, accountNumber, LEDGER_OPEN, 0, 0);
+    *lsn = bankInsertRecord(&account, &slot, &history);
+    if (*lsn)
+    {
+        indexInsert(accountNumber, slot);
+        namesInsert(account.username, accountNumber);
+    }
+    unlockAccount(accountNumber);
+
+    return *lsn ? BANK_OK : BANK_IO_ERROR;
+}
+
+static int applyBalance(int accountNumber, money_t *balance)
+{
+    Account account;
+
+    lockAccount(accountNumber);
+    long slot = loadAccount(accountNumber, &account);
+    unlockAccount(accountNumber);
+
+    if (slot < 0)
+        return BANK_NOT_FOUND;
+    *balance = account.balance;
+    return BANK_OK;
+}
+
+/**
+ * @brief Logs a deposit (positive amount) or withdrawal (negative amount)
+ *
+ * A deposit that would take the balance past the range of money_t is
+ * rejected as an invalid amount.
+ */
+static int applyChange(int accountNumber, money_t change, money_t *balance, uint64_t *lsn)
+{
+    Account account;
+
+    lockAccount(accountNumber);
+    long slot = loadAccount(accountNumber, &account);
+    money_t updated;
+    if (slot < 0 || -change > account.balance || __builtin_add_overflow(account.balance, change, &updated))
+    {
+        unlockAccount(accountNumber);
+        return slot < 0 ? BANK_NOT_FOUND : change < 0 ? BANK_INSUFFICIENT_FUNDS : BANK_INVALID_AMOUNT;
+    }
+    account.balance = updated;
+    size_t at = (size_t)slot;
+    LedgerEntry history;
+    ledgerEntryInit(&history, accountNumber, change > 0 ? LEDGER_DEPOSIT : LEDGER_WITHDRAW, change, account.balance);
+    *lsn = walAppendHistory(&at, &account, 1, &history, 1);
+    if (*lsn)
+        cacheStore(at, &account, 0);
+    unlockAccount(accountNumber);
+
+    if (balance)
+        *balance = account.balance;
+    return *lsn ? BANK_OK : BANK_IO_ERROR;
+}
+
+static int applyTransfer(int fromAccount, int toAccount, money_t amount, money_t *balance, uint64_t *lsn)
+{
+    Account accounts[2];
+    size_t slots[2];
+
+    // Lock ordering by stripe keeps opposite transfers from deadlocking
+    pthread_once(&stripesReady, initStripes);
+    unsigned first = stripeOf(fromAccount), second = stripeOf(toAccount);
+    if (first > second)
+    {
+        unsigned swap = first;
+        first = second;
+        second = swap;
+    }
+    pthread_mutex_lock(&stripes[first]);
+    if (second != first)
+        pthread_mutex_lock(&stripes[second]);
+
+    int status = BANK_OK;
+    money_t credited;
+    long fromSlot = loadAccount(fromAccount, &accounts[0]);
+    long toSlot = loadAccount(toAccount, &accounts[1]);
+    if (fromSlot < 0 || toSlot < 0)
+        status = BANK_NOT_FOUND;
+    else if (amount > accounts[0].balance)
+        status = BANK_INSUFFICIENT_FUNDS;
+    else if (__builtin_add_overflow(accounts[1].balance, amount, &credited))
+        status = BANK_INVALID_AMOUNT; // The credit would leave the range of money_t
+
+    if (status == BANK_OK)
+    {
+        accounts[0].balance -= amount;
+        accounts[1].balance = credited;
+        slots[0] = (size_t)fromSlot;
+        slots[1] = (size_t)toSlot;
+        LedgerEntry history[2];
+        ledgerEntryInit(&history[0], fromAccount, LEDGER_TRANSFER, -amount, accounts[0].balance);
+        ledgerEntryInit(&history[1], toAccount, LEDGER_TRANSFER, amount, accounts[1].balance);
+        *lsn = walAppendHistory(slots, accounts, 2, history, 2);
+        if (*lsn)
+        {
+            cacheStore(slots[0], &accounts[0], 0);
+            cacheStore(slots[1], &accounts[1], 0);
+            if (balance)
+                *balance = accounts[0].balance;
+        }
+        else
+            status = BANK_IO_ERROR;
+    }
+
+    if (second != first)
+        pthread_mutex_unlock(&stripes[second]);
+    pthread_mutex_unlock(&stripes[first]);
+    return status;
+}
+
+/**
+ * @brief Replaces an account with a tombstone and frees its slot
+ */
+static int applyClose(int accountNumber, uint64_t *lsn)
+{
+    Account account;
+
+    lockAccount(accountNumber);
+    long slot = loadAccount(accountNumber, &account);
+    if (slot < 0 || account.balance != 0)
+    {
+        unlockAccount(accountNumber);
+        return slot < 0 ? BANK_NOT_FOUND : BANK_NOT_EMPTY;
+    }
+
+    char username[sizeof(account.username)];
+    memcpy(username, account.username, sizeof(username));
+    memset(account.username, 0, sizeof(account.username));
+    account.flags |= ACCOUNT_CLOSED;
+    size_t at = (size_t)slot;
+    LedgerEntry history;
+    ledgerEntryInit(&history, accountNumber, LEDGER_CLOSE, 0, 0);
+    *lsn = walAppendHistory(&at, &account, 1, &history, 1);
+    if (*lsn)
+    {
+        cacheStore(at, &account, 0);
+        indexRemove(accountNumber);
+        namesRemove(username, accountNumber);
+        indexReleaseSlot(at);
+    }
+    unlockAccount(accountNumber);
+
+    return *lsn ? BANK_OK : BANK_IO_ERROR;
+}
+
+/**
+ * @brief Applies one request without waiting for it to become durable
+ * @param request Operation and its arguments
+ * @param result Receives the status, the resulting balance (of the source
+ *        account for transfers) and the log position to wait for
+ * @return The status, as also stored in result
+ *
+ * The change is visible to later requests at once. A caller serving many
+ * requests can run a whole batch and then make them all durable with one
+ * walCommitUpTo() on the largest result->lsn before replying to any.
+ */
+int engineExecute(const BankRequest *request, BankResult *result)
+{
+    result->balance = 0;
+    result->lsn = 0;
+
+    int status;
+    if (!bankEnsureOpen())
+        status = BANK_IO_ERROR;
+    else
+        switch (request->op)
+        {
+        case BANK_OP_CREATE:
+            // An empty name would make the record look like mmap padding
+            status = request->username[0] == '\0' ? BANK_BAD_REQUEST
+                                                  : applyCreate(request->username, request->accountNumber, &result->lsn);
+            break;
+        case BANK_OP_BALANCE:
+            status = applyBalance(request->accountNumber, &result->balance);
+            break;
+        case BANK_OP_DEPOSIT:
+            status = request->amount <= 0 ? BANK_INVALID_AMOUNT
+                                          : applyChange(request->accountNumber, request->amount, &result->balance,
+                                                        &result->lsn);
+            break;
+        case BANK_OP_WITHDRAW:
+            status = request->amount <= 0 ? BANK_INVALID_AMOUNT
+                                          : applyChange(request->accountNumber, -request->amount, &result->balance,
+                                                        &result->lsn);
+            break;
+        case BANK_OP_TRANSFER:
+            status = request->amount <= 0                         ? BANK_INVALID_AMOUNT
+                     : request->accountNumber == request->toAccount ? BANK_SAME_ACCOUNT
+                                                                    : applyTransfer(request->accountNumber,
+                                                                                    request->toAccount, request->amount,
+                                                                                    &result->balance, &result->lsn);
+            break;
+        case BANK_OP_CLOSE:
+            status = applyClose(request->accountNumber, &result->lsn);
+            break;
+        default:
+            status = BANK_BAD_REQUEST;
+        }
+
+    result->status = status;
+    return status;
+}
+
+/**
+ * @brief Opens a new account with a zero balance
+ * @param username Name of the account holder (truncated to fit), not empty
+ * @param accountNumber Number of the new account
+ * @return BANK_OK, BANK_DUPLICATE_ACCOUNT, BANK_BAD_REQUEST or BANK_IO_ERROR
+ */
+int engineCreate(const char *username, int accountNumber)
+{
+    BankRequest request = {BANK_OP_CREATE, accountNumber, 0, 0, ""};
+    BankResult result;
+
+    strncpy(request.username, username, sizeof(request.username) - 1);
+    engineExecute(&request, &result);
+    return commitStatus(result.status, result.lsn);
+}
+
+/**
+ * @brief Reads the balance of an account
+ * @param accountNumber Account to query
+ * @param balance Receives the balance in minor units
+ * @return BANK_OK or BANK_NOT_FOUND
+ */
+int engineBalance(int accountNumber, money_t *balance)
+{
+    BankRequest request = {BANK_OP_BALANCE, accountNumber, 0, 0, ""};
+    BankResult result;
+
+    if (engineExecute(&request, &result) == BANK_OK)
+        *balance = result.balance;
+    return result.status;
+}
+
+/**
+ * @brief Adds money to an account
+ * @param accountNumber Account to credit
+ * @param amount Amount to deposit in minor units, must be positive and keep
+ *        the balance within the range of money_t
+ * @param balance Receives the new balance (may be NULL)
+ * @return BANK_OK, BANK_NOT_FOUND, BANK_INVALID_AMOUNT or BANK_IO_ERROR
+ */
+int engineDeposit(int accountNumber, money_t amount, money_t *balance)
+{
+    BankRequest request = {BANK_OP_DEPOSIT, accountNumber, 0, amount, ""};
+    BankResult result;
+
+    engineExecute(&request, &result);
+    if (balance && result.status == BANK_OK)
+        *balance = result.balance;
+    return commitStatus(result.status, result.lsn);
+}
+
+/**
+ * @brief Takes money out of an account
+ * @param accountNumber Account to debit
+ * @param amount Amount to withdraw in minor units, positive and at most
+ *        the balance
+ * @param balance Receives the new balance (may be NULL)
+ * @return BANK_OK, BANK_NOT_FOUND, BANK_INVALID_AMOUNT,
+ *         BANK_INSUFFICIENT_FUNDS or BANK_IO_ERROR
+ */
+int engineWithdraw(int accountNumber, money_t amount, money_t *balance)
+{
+    BankRequest request = {BANK_OP_WITHDRAW, accountNumber, 0, amount, ""};
+    BankResult result;
+
+    engineExecute(&request, &result);
+    if (balance && result.status == BANK_OK)
+        *balance = result.balance;
+    return commitStatus(result.status, result.lsn);
+}
+
+/**
+ * @brief Moves money between two accounts atomically
+ * @param fromAccount Account to debit
+ * @param toAccount Account to credit
+ * @param amount Amount to move in minor units, positive and at most the
+ *        source balance
+ * @return BANK_OK, BANK_NOT_FOUND, BANK_INVALID_AMOUNT,
+ *         BANK_INSUFFICIENT_FUNDS, BANK_SAME_ACCOUNT or BANK_IO_ERROR
+ */
+int engineTransfer(int fromAccount, int toAccount, money_t amount)
+{
+    BankRequest request = {BANK_OP_TRANSFER, fromAccount, toAccount, amount, ""};
+    BankResult result;
+
+    engineExecute(&request, &result);
+    return commitStatus(result.status, result.lsn);
+}
+
+/**
+ * @brief Closes an account
+ * @param accountNumber Account to close; its balance must be zero
+ * @return BANK_OK, BANK_NOT_FOUND, BANK_NOT_EMPTY or BANK_IO_ERROR
+ */
+int engineClose(int accountNumber)
+{
+    BankRequest request = {BANK_OP_CLOSE, accountNumber, 0, 0, ""};
+    BankResult result;
+
+    engineExecute(&request, &result);
+    return commitStatus(result.status, result.lsn);
+}
+
+/**
+ * @brief Reads a record without caching what it finds
+ * @param slot Record slot
+ * @param account Receives the record
+ * @param useCache Non-zero to look in the cache first; only safe while the
+ *        account's stripe is held, since that is when the cache holds its
+ *        newest version
+ * @return 1 on success, 0 on failure
+ *
+ * Unlike bankReadRecord() a miss never fills the cache, so a copy read
+ * without the stripe cannot replace a version stored meanwhile.
+ */
+static int peekRecord(size_t slot, Account *account, int useCache)
+{
+    return (useCache && cacheLookup(slot, account)) || walPendingLookup(slot, account) ||
+           storeReadRecord(slot, account);
+}
+
+/**
+ * @brief Moves one live record into a lower free slot
+ * @param slot Slot of the record to move
+ * @param target Free slot below it, taken from the free list
+ * @return Log position of the move, 0 if the record was not moved
+ */
+static uint64_t moveRecord(size_t slot, size_t target)
+{
+    Account accounts[2];
+    size_t slots[2] = {target, slot};
+    uint64_t lsn = 0;
+
+    // Only to learn whose record it is: without the stripe it may be stale
+    if (!peekRecord(slot, &accounts[0], 0) || (accounts[0].flags & ACCOUNT_CLOSED))
+        return 0;
+    int accountNumber = accounts[0].accountNumber;
+
+    // The account may have been closed or changed since it was read
+    lockAccount(accountNumber);
+    if (indexLookup(accountNumber) == (long)slot && peekRecord(slot, &accounts[0], 1))
+    {
+        accounts[1] = accounts[0];
+        memset(accounts[1].username, 0, sizeof(accounts[1].username));
+        accounts[1].flags |= ACCOUNT_CLOSED;
+        lsn = walAppendRecords(slots, accounts, 2);
+        if (lsn)
+        {
+            cacheStore(target, &accounts[0], 0);
+            cacheStore(slot, &accounts[1], 0);
+            indexRemove(accountNumber);
+            indexInsert(accountNumber, target);
+            indexReleaseSlot(slot);
+        }
+    }
+    unlockAccount(accountNumber);
+    return lsn;
+}
+
+/**
+ * @brief Compacts the record file while the engine keeps serving
+ * @param moved Receives the number of accounts moved (may be NULL)
+ * @return 1 on success, 0 on failure
+ *
+ * Live records from the end of the file are moved into the lowest free
+ * slots until no free slot lies below a live record, then the trailing
+ * closed records are cut off. Engine operations may run meanwhile; batch
+ * and bulk jobs must not.
+ */
+int engineCompact(size_t *moved)
+{
+    size_t count = 0;
+    uint64_t lastLsn = 0;
+    Account account;
+
+    if (!bankEnsureOpen() || !bankCommit())
+        return 0;
+
+    for (size_t slot = walNextAppendSlot(); slot-- > 0;)
+    {
+        long target = indexTakeFreeSlot(slot);
+        if (target < 0)
+            break;
+        uint64_t lsn = moveRecord(slot, (size_t)target);
+        if (lsn)
+        {
+            lastLsn = lsn;
+            count++;
+        }
+        else
+            indexReleaseSlot((size_t)target);
+    }
+    if (moved)
+        *moved = count;
+    if (lastLsn && !walCommitUpTo(lastLsn))
+        return 0;
+
+    // Accounts created meanwhile may have landed at the end of the file
+    lockAll();
+    int ok = cacheFlush();
+    size_t end = walNextAppendSlot(), keep = end;
+    while (ok && keep > 0 && bankReadRecord(keep - 1, &account) && (account.flags & ACCOUNT_CLOSED))
+        keep--;
+    if (ok && keep < end)
+    {
+        ok = walTruncate(keep);
+        if (ok)
+        {
+            indexTruncate(keep);
+            cacheClear();
+        }
+    }
+    unlockAll();
+    return ok;
+}
+
+/**
+ * @brief Describes an engine status code
+ */
+const char *bankStatusName(int status)
+{
+    switch (status)
+    {
+    case BANK_OK:
+        return "OK";
+    case BANK_NOT_FOUND:
+        return "NOT_FOUND";
+    case BANK_INVALID_AMOUNT:
+        return "INVALID_AMOUNT";
+    case BANK_INSUFFICIENT_FUNDS:
+        return "INSUFFICIENT_FUNDS";
+    case BANK_DUPLICATE_ACCOUNT:
+        return "DUPLICATE_ACCOUNT";
+    case BANK_SAME_ACCOUNT:
+        return "SAME_ACCOUNT";
+    case BANK_BAD_REQUEST:
+        return "BAD_REQUEST";
+    case BANK_NOT_EMPTY:
+        return "NOT_EMPTY";
+    default:
+        return "IO_ERROR";
+    }
+}
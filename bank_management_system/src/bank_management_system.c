@@ -4,16 +4,31 @@
  *
  * This program provides functionality for creating bank accounts, depositing and
  * withdrawing money, and checking account balances. All account data is stored
- * in a binary file for persistence.
+ * in a binary file for persistence, with a sidecar hash index so that accounts
+ * are found without scanning the whole file.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include "bank_management_system.h"
 
 /** @brief Filename for storing account data */
 #define FILENAME "accounts.dat"
 
+/** @brief Suffix appended to the data filename to name its index file */
+#define INDEX_SUFFIX ".idx"
+
+/** @brief Suffix appended to the data filename to name its write-ahead log */
+#define WAL_SUFFIX ".wal"
+
+/** @brief Suffix appended to the data filename to name its ledger files */
+#define LEDGER_SUFFIX ".ledger"
+
+/** @brief Suffix appended to the data filename to name its name index */
+#define NAMES_SUFFIX ".names"
+
 /* Color codes for styling console output */
 #define RESET "\033[0m"
 #define BOLD "\033[1m"
@@ -22,40 +37,11 @@
 #define YELLOW "\033[33m"
 #define CYAN "\033[36m"
 
-/**
- * @struct Account
- * @brief Structure to hold bank account information
- *
- * @var username The account holder's name
- * @var accountNumber Unique identifier for the account
- * @var balance Current balance in the account
- */
-typedef struct
-{
-    char username[30];
-    int accountNumber;
-    float balance;
-} Account;
-
-/* Function prototypes */
-void createAccount();
-void depositMoney();
-void withdrawMoney();
-void checkBalance();
-void menu();
-int isUniqueAccountNumber(int accountNumber);
-Account *getAccountByNumber(int accountNumber);
-void saveAccount(Account account);
+/** @brief Non-zero while the record file and index are open */
+static int bankIsOpen = 0;
 
-/**
- * @brief Main entry point of the program
- * @return 0 on successful execution
- */
-int main()
-{
-    menu();
-    return 0;
-}
+/** @brief Record updates gathered into one log commit (1 = commit each) */
+static size_t groupCommitSize = 1;
 
 /**
  * @brief Displays the main menu and handles user input
@@ -73,7 +59,8 @@ void menu()
         printf("%s2. Deposit Money%s\n", YELLOW, RESET);
         printf("%s3. Withdraw Money%s\n", YELLOW, RESET);
         printf("%s4. Check Balance%s\n", YELLOW, RESET);
-        printf("%s5. Exit%s\n", YELLOW, RESET);
+        printf("%s5. Close Account%s\n", YELLOW, RESET);
+        printf("%s6. Exit%s\n", YELLOW, RESET);
         printf("%sEnter your choice: %s", BOLD, RESET);
         scanf("%d", &choice);
 
@@ -92,6 +79,9 @@ void menu()
             checkBalance();
             break;
         case 5:
+            closeAccount();
+            break;
+        case 6:
             printf("%sExiting program. Goodbye!%s\n", GREEN, RESET);
             exit(0);
         default:
@@ -103,28 +93,32 @@ void menu()
 /**
  * @brief Creates a new bank account
  *
- * Prompts user for account details, validates the account number for uniqueness,
- * and saves the new account to the database file.
+ * Prompts user for account details and opens the account through the
+ * engine, which rejects account numbers already in use.
  */
 void createAccount()
 {
-    Account newAccount;
+    char username[30] = "";
+    int accountNumber = 0;
     printf("%sEnter username: %s", BOLD, RESET);
-    scanf("%s", newAccount.username);
+    scanf("%29s", username);
     printf("%sEnter account number: %s", BOLD, RESET);
-    scanf("%d", &newAccount.accountNumber);
+    scanf("%d", &accountNumber);
 
-    if (!isUniqueAccountNumber(newAccount.accountNumber))
+    int status = engineCreate(username, accountNumber);
+    if (status == BANK_DUPLICATE_ACCOUNT)
     {
         printf("%s%sAccount number already in use. Try again with a unique number.%s\n", BOLD, RED, RESET);
         return;
     }
-
-    newAccount.balance = 0.0;
-    saveAccount(newAccount);
+    if (status != BANK_OK)
+    {
+        printf("%s%sAccount could not be created (%s).%s\n", BOLD, RED, bankStatusName(status), RESET);
+        return;
+    }
 
     printf("%s%sAccount created successfully!%s\n", BOLD, GREEN, RESET);
-    printf("Username: %s, Account Number: %d, Balance: %.2f\n", newAccount.username, newAccount.accountNumber, newAccount.balance);
+    printf("Username: %s, Account Number: %d, Balance: 0.00\n", username, accountNumber);
 }
 
 /**
@@ -134,31 +128,36 @@ void createAccount()
  */
 void depositMoney()
 {
-    int accountNumber;
-    float amount;
+    int accountNumber = 0;
+    money_t amount, current;
+    char input[32], balance[24];
     printf("%sEnter account number: %s", BOLD, RESET);
     scanf("%d", &accountNumber);
 
-    Account *account = getAccountByNumber(accountNumber);
-    if (account == NULL)
+    if (engineBalance(accountNumber, &current) != BANK_OK)
     {
         printf("%sAccount not found.%s\n", RED, RESET);
         return;
     }
 
     printf("%sEnter amount to deposit: %s", BOLD, RESET);
-    scanf("%f", &amount);
-    if (amount <= 0)
+    if (scanf("%31s", input) != 1 || !parseMoney(input, &amount))
+        amount = 0;
+
+    int status = engineDeposit(accountNumber, amount, &current);
+    if (status == BANK_INVALID_AMOUNT)
     {
         printf("%sInvalid amount.%s\n", RED, RESET);
-        free(account);
+        return;
+    }
+    if (status != BANK_OK)
+    {
+        printf("%sDeposit failed (%s).%s\n", RED, bankStatusName(status), RESET);
         return;
     }
 
-    account->balance += amount;
-    saveAccount(*account);
-    printf("%s%sDeposit successful!%s New balance: %.2f\n", BOLD, GREEN, RESET, account->balance);
-    free(account);
+    printf("%s%sDeposit successful!%s New balance: %s\n", BOLD, GREEN, RESET,
+           formatMoney(current, balance, sizeof(balance)));
 }
 
 /**
@@ -169,31 +168,36 @@ void depositMoney()
  */
 void withdrawMoney()
 {
-    int accountNumber;
-    float amount;
+    int accountNumber = 0;
+    money_t amount, current;
+    char input[32], balance[24];
     printf("%sEnter account number: %s", BOLD, RESET);
     scanf("%d", &accountNumber);
 
-    Account *account = getAccountByNumber(accountNumber);
-    if (account == NULL)
+    if (engineBalance(accountNumber, &current) != BANK_OK)
     {
         printf("%sAccount not found.%s\n", RED, RESET);
         return;
     }
 
     printf("%sEnter amount to withdraw: %s", BOLD, RESET);
-    scanf("%f", &amount);
-    if (amount <= 0 || amount > account->balance)
+    if (scanf("%31s", input) != 1 || !parseMoney(input, &amount))
+        amount = 0;
+
+    int status = engineWithdraw(accountNumber, amount, &current);
+    if (status == BANK_INVALID_AMOUNT || status == BANK_INSUFFICIENT_FUNDS)
     {
         printf("%sInvalid amount. Withdrawal exceeds balance.%s\n", RED, RESET);
-        free(account);
+        return;
+    }
+    if (status != BANK_OK)
+    {
+        printf("%sWithdrawal failed (%s).%s\n", RED, bankStatusName(status), RESET);
         return;
     }
 
-    account->balance -= amount;
-    saveAccount(*account);
-    printf("%s%sWithdrawal successful!%s New balance: %.2f\n", BOLD, GREEN, RESET, account->balance);
-    free(account);
+    printf("%s%sWithdrawal successful!%s New balance: %s\n", BOLD, GREEN, RESET,
+           formatMoney(current, balance, sizeof(balance)));
 }
 
 /**
@@ -201,19 +205,296 @@ void withdrawMoney()
  */
 void checkBalance()
 {
-    int accountNumber;
+    int accountNumber = 0;
+    money_t current;
+    char balance[24];
     printf("%sEnter account number: %s", BOLD, RESET);
     scanf("%d", &accountNumber);
 
-    Account *account = getAccountByNumber(accountNumber);
-    if (account == NULL)
+    if (engineBalance(accountNumber, &current) != BANK_OK)
     {
         printf(BOLD "%sAccount not found.%s\n", RED, RESET);
         return;
     }
 
-    printf(BOLD "%sAccount balance: %.2f%s\n", GREEN, account->balance, RESET);
-    free(account);
+    printf(BOLD "%sAccount balance: %s%s\n", GREEN, formatMoney(current, balance, sizeof(balance)), RESET);
+}
+
+/**
+ * @brief Closes an account whose balance is zero
+ *
+ * The account number can be used for a new account afterwards, and its
+ * record slot is reused by the next account created.
+ */
+void closeAccount()
+{
+    int accountNumber = 0;
+    printf("%sEnter account number: %s", BOLD, RESET);
+    scanf("%d", &accountNumber);
+
+    int status = engineClose(accountNumber);
+    if (status == BANK_NOT_FOUND)
+        printf(BOLD "%sAccount not found.%s\n", RED, RESET);
+    else if (status == BANK_NOT_EMPTY)
+        printf(BOLD "%sWithdraw the remaining balance before closing the account.%s\n", RED, RESET);
+    else if (status != BANK_OK)
+        printf(BOLD "%sAccount could not be closed (%s).%s\n", RED, bankStatusName(status), RESET);
+    else
+        printf(BOLD "%sAccount closed.%s\n", GREEN, RESET);
+}
+
+/**
+ * @brief Prints an account's transaction history
+ * @param accountNumber Account to show
+ * @param from Start of the time window, microseconds since the epoch
+ * @param to End of the time window (inclusive)
+ * @param count Maximum number of entries; the most recent are shown
+ * @return 1 if the account exists, 0 otherwise
+ */
+int showHistory(int accountNumber, int64_t from, int64_t to, size_t count)
+{
+    if (isUniqueAccountNumber(accountNumber))
+    {
+        printf("%sAccount not found.%s\n", RED, RESET);
+        return 0;
+    }
+
+    LedgerEntry *entries = (LedgerEntry *)malloc((count ? count : 1) * sizeof(LedgerEntry));
+    if (!entries)
+        return 0;
+    size_t found = ledgerRange(accountNumber, from, to, entries, count);
+
+    printf("%s%s%-26s %-9s %16s %16s%s\n", BOLD, CYAN, "time", "operation", "amount", "balance", RESET);
+    for (size_t i = 0; i < found; i++)
+    {
+        const LedgerEntry *e = &entries[i];
+        const char *name = e->op == LEDGER_OPEN       ? "open"
+                           : e->op == LEDGER_DEPOSIT  ? "deposit"
+                           : e->op == LEDGER_WITHDRAW ? "withdraw"
+                           : e->op == LEDGER_TRANSFER ? "transfer"
+                           : e->op == LEDGER_INTEREST ? "interest"
+                           : e->op == LEDGER_FEE      ? "fee"
+                           : e->op == LEDGER_CLOSE    ? "close"
+                                                      : "?";
+        time_t seconds = (time_t)(e->timestamp / 1000000);
+        char when[32], amount[24], balance[24];
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&seconds));
+        printf("%s.%06d %-9s %16s %16s\n", when, (int)(e->timestamp % 1000000), name,
+               formatMoney(e->amount, amount, sizeof(amount)), formatMoney(e->balance, balance, sizeof(balance)));
+    }
+    if (found == 0)
+        printf("%sNo transactions.%s\n", YELLOW, RESET);
+    free(entries);
+    return 1;
+}
+
+/**
+ * @brief Prints the accounts whose holder name matches
+ * @param text Exact name, or the start of the names to list
+ * @param prefix Non-zero to list every name starting with text
+ * @param count Maximum number of accounts to list
+ * @return 1 if any account matched, 0 otherwise
+ */
+int showMatches(const char *text, int prefix, size_t count)
+{
+    if (!bankEnsureOpen())
+        return 0;
+
+    NameEntry *matches = (NameEntry *)malloc((count ? count : 1) * sizeof(NameEntry));
+    if (!matches)
+        return 0;
+    size_t found = namesSearch(text, prefix, matches, count);
+
+    printf("%s%s%-29s %14s %16s%s\n", BOLD, CYAN, "username", "account", "balance", RESET);
+    for (size_t i = 0; i < found; i++)
+    {
+        money_t current;
+        char balance[24] = "?";
+        if (engineBalance(matches[i].accountNumber, &current) == BANK_OK)
+            formatMoney(current, balance, sizeof(balance));
+        printf("%-29s %14d %16s\n", matches[i].username, matches[i].accountNumber, balance);
+    }
+    if (found == 0)
+        printf("%sNo matching accounts.%s\n", YELLOW, RESET);
+    free(matches);
+    return found > 0;
+}
+
+/**
+ * @brief Opens the account database, its log and its index
+ * @param path Location of the record file; the log and index live next to it
+ * @return 1 on success, 0 on failure
+ *
+ * Any database opened earlier is closed first. Changes left in the log by
+ * a crash are replayed before the index is opened. The database is closed
+ * automatically when the program exits.
+ */
+int bankOpen(const char *path)
+{
+    static int closeRegistered = 0;
+    char indexPath[512], walPath[512], ledgerPath[512], namesPath[512];
+
+    bankClose();
+    cacheClear();
+    if (snprintf(indexPath, sizeof(indexPath), "%s%s", path, INDEX_SUFFIX) >= (int)sizeof(indexPath) ||
+        snprintf(walPath, sizeof(walPath), "%s%s", path, WAL_SUFFIX) >= (int)sizeof(walPath) ||
+        snprintf(ledgerPath, sizeof(ledgerPath), "%s%s", path, LEDGER_SUFFIX) >= (int)sizeof(ledgerPath) ||
+        snprintf(namesPath, sizeof(namesPath), "%s%s", path, NAMES_SUFFIX) >= (int)sizeof(namesPath))
+        return 0;
+    if (!storeOpen(path))
+        return 0;
+    if (!walOpen(walPath) || walRecover() < 0)
+    {
+        walClose();
+        storeClose();
+        return 0;
+    }
+    if (!indexOpen(indexPath, storeRecordCount()))
+    {
+        walClose();
+        storeClose();
+        return 0;
+    }
+    if (!ledgerOpen(ledgerPath))
+    {
+        indexClose();
+        walClose();
+        storeClose();
+        return 0;
+    }
+    if (!namesOpen(namesPath, storeRecordCount()))
+    {
+        ledgerClose();
+        indexClose();
+        walClose();
+        storeClose();
+        return 0;
+    }
+
+    if (!closeRegistered)
+    {
+        atexit(bankClose);
+        closeRegistered = 1;
+    }
+    bankIsOpen = 1;
+    return 1;
+}
+
+/**
+ * @brief Commits pending updates and closes the account database
+ */
+void bankClose()
+{
+    if (!bankIsOpen)
+        return;
+    if (!cacheFlush())
+        fprintf(stderr, "accounts: cannot log cached updates\n");
+    cacheClear();
+    walClose();
+    ledgerClose();
+    indexClose();
+    namesClose();
+    storeClose();
+    bankIsOpen = 0;
+}
+
+/**
+ * @brief Opens the default database on first use
+ * @return 1 if the database is open, 0 otherwise
+ */
+int bankEnsureOpen()
+{
+    return bankIsOpen || bankOpen(FILENAME);
+}
+
+/**
+ * @brief Sets how many record updates share one log commit
+ * @param size Updates per group; 1 makes every update durable on return
+ * @return The previous group size
+ */
+size_t bankSetGroupCommit(size_t size)
+{
+    size_t previous = groupCommitSize;
+    groupCommitSize = size ? size : 1;
+    return previous;
+}
+
+/**
+ * @brief Commits the current group of updates with a single fsync
+ * @return 1 on success, 0 on failure
+ *
+ * Records held dirty by a write-back cache are logged first, and buffered
+ * ledger entries are handed to the operating system.
+ */
+int bankCommit()
+{
+    return cacheFlush() && walCommit() && ledgerFlush();
+}
+
+/**
+ * @brief Reads a record, seeing updates not yet committed
+ * @return 1 on success, 0 on failure
+ *
+ * Served from the record cache when possible; a miss reads the log's
+ * pending groups or the store and caches the result.
+ */
+int bankReadRecord(size_t slot, Account *account)
+{
+    if (cacheLookup(slot, account))
+        return 1;
+    if (!walPendingLookup(slot, account) && !storeReadRecord(slot, account))
+        return 0;
+    cacheStore(slot, account, 0);
+    return 1;
+}
+
+/**
+ * @brief Records a new version of an existing record
+ * @return 1 on success, 0 on failure
+ *
+ * With a write-through cache the change is logged at once and the store is
+ * updated once its group is committed; with a write-back cache it stays in
+ * the cache until evicted or flushed.
+ */
+int bankUpdateRecord(size_t slot, const Account *account)
+{
+    if (cachePolicy() == CACHE_WRITE_BACK && cacheStore(slot, account, 1))
+        return walPendingCount() < groupCommitSize || walCommit();
+
+    if (!walAppend(slot, account))
+        return 0;
+    cacheStore(slot, account, 0);
+    return walPendingCount() < groupCommitSize || walCommit();
+}
+
+/**
+ * @brief Logs a new record, reusing the lowest free slot if there is one
+ * @param account Contents of the new record
+ * @param slot Receives the slot the record occupies
+ * @param history Ledger entry recorded once the record commits (may be NULL)
+ * @return Sequence number of the update, or 0 on failure
+ *
+ * Safe to call from several threads. The record is cached at once, so an
+ * old cached copy of a reused slot can never be read back.
+ */
+uint64_t bankInsertRecord(const Account *account, size_t *slot, const LedgerEntry *history)
+{
+    uint64_t lsn;
+    long freeSlot = indexTakeFreeSlot(SIZE_MAX);
+
+    if (freeSlot >= 0)
+    {
+        *slot = (size_t)freeSlot;
+        lsn = walAppendHistory(slot, account, 1, history, history ? 1 : 0);
+        if (!lsn)
+            indexReleaseSlot(*slot);
+    }
+    else
+        lsn = walAppendNew(account, slot, history);
+
+    if (lsn)
+        cacheStore(*slot, account, 0);
+    return lsn;
 }
 
 /**
@@ -223,22 +504,10 @@ void checkBalance()
  */
 int isUniqueAccountNumber(int accountNumber)
 {
-    FILE *file = fopen(FILENAME, "rb");
-    if (!file)
+    if (!bankEnsureOpen())
         return 1;
 
-    Account temp;
-    while (fread(&temp, sizeof(Account), 1, file))
-    {
-        if (temp.accountNumber == accountNumber)
-        {
-            fclose(file);
-            return 0;
-        }
-    }
-
-    fclose(file);
-    return 1;
+    return indexLookup(accountNumber) < 0;
 }
 
 /**
@@ -248,56 +517,65 @@ int isUniqueAccountNumber(int accountNumber)
  */
 Account *getAccountByNumber(int accountNumber)
 {
-    FILE *file = fopen(FILENAME, "rb");
-    if (!file)
-        return NULL;
-
     Account *account = (Account *)malloc(sizeof(Account));
-    while (fread(account, sizeof(Account), 1, file))
+    if (account && !findAccount(accountNumber, account))
     {
-        if (account->accountNumber == accountNumber)
-        {
-            fclose(file);
-            return account;
-        }
+        free(account);
+        return NULL;
     }
+    return account;
+}
+
+/**
+ * @brief Reads an account into caller-provided storage
+ * @param accountNumber The account number to search for
+ * @param account Receives the account if found
+ * @return 1 if found, 0 otherwise
+ */
+int findAccount(int accountNumber, Account *account)
+{
+    if (!bankEnsureOpen())
+        return 0;
 
-    fclose(file);
-    free(account);
-    return NULL;
+    long slot = indexLookup(accountNumber);
+    return slot >= 0 && bankReadRecord((size_t)slot, account);
 }
 
 /**
  * @brief Saves or updates account information in the database file
  * @param account The account structure to save
  *
- * If the account number already exists, the record is updated;
- * otherwise, a new record is appended to the file.
+ * If the account number already exists, the record is updated in place;
+ * otherwise, a new record is added (in the slot of a closed account if
+ * there is one) and indexed.
+ * Either way the change goes through the write-ahead log and becomes
+ * durable with the group it belongs to.
  */
 void saveAccount(Account account)
 {
-    FILE *file = fopen(FILENAME, "r+b");
-    if (!file)
-        file = fopen(FILENAME, "wb");
-
-    Account temp;
-    int found = 0;
+    if (!bankEnsureOpen())
+        return;
 
-    while (fread(&temp, sizeof(Account), 1, file))
+    long slot = indexLookup(account.accountNumber);
+    if (slot >= 0)
     {
-        if (temp.accountNumber == account.accountNumber)
+        Account previous;
+        if (bankReadRecord((size_t)slot, &previous) && bankUpdateRecord((size_t)slot, &account) &&
+            strncmp(previous.username, account.username, sizeof(account.username)) != 0)
         {
-            fseek(file, -(long int)sizeof(Account), SEEK_CUR);
-            fwrite(&account, sizeof(Account), 1, file);
-            found = 1;
-            break;
+            namesRemove(previous.username, account.accountNumber);
+            namesInsert(account.username, account.accountNumber);
         }
+        return;
     }
 
-    if (!found)
-    {
-        fwrite(&account, sizeof(Account), 1, file);
-    }
-
-    fclose(file);
-}
\ No newline at end of file
+    // The index may get ahead of the store here; after a crash it is
+    // rebuilt from the records anyway.
+    size_t newSlot;
+    if (!bankInsertRecord(&account, &newSlot, NULL))
+        return;
+    indexInsert(account.accountNumber, newSlot);
+    namesInsert(account.username, account.accountNumber);
+    if (walPendingCount() >= groupCommitSize)
+        walCommit();
+}
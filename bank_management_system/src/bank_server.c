@@ -0,0 +1,536 @@
+/**
+ * @file bank_server.c
+ * @brief Socket front end serving engine requests to many clients
+ *
+ * One process owns the database and serves any number of clients over a
+ * Unix-domain or TCP socket, so tellers and batch jobs share it instead of
+ * each opening accounts.dat. A single thread runs an epoll event loop over
+ * non-blocking sockets.
+ *
+ * The protocol is a stream of fixed-size binary frames in native byte
+ * order: ServerRequest (56 bytes) from the client, ServerResponse (16 bytes)
+ * back, one response per request and in request order. Clients may pipeline:
+ * send many requests without waiting, and match replies by requestId.
+ *
+ * Each loop iteration applies every complete request that has arrived, on
+ * every ready connection, through engineExecute(); then makes all of their
+ * changes durable with one log commit; and only then sends the replies. A
+ * reply is therefore never sent for a change that could still be lost, and
+ * pipelined or concurrent requests share one fsync.
+ *
+ * When a backup path is set, SIGUSR1 writes a point-in-time backup there
+ * from a second thread (see account_backup.c) while requests keep being
+ * served.
+ *
+ * Addresses containing a '/' name a Unix socket; anything else is
+ * "[host:]port" for TCP, the host defaulting to 127.0.0.1.
+ */
+
+#define _GNU_SOURCE // accept4()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "bank_management_system.h"
+
+/** @brief Events handled per epoll_wait() call */
+#define SERVER_MAX_EVENTS 64
+
+/** @brief Bytes read from a connection per event */
+#define SERVER_READ_CHUNK 65536
+
+/** @brief Unsent reply bytes at which a connection stops being read */
+#define SERVER_MAX_PENDING_OUTPUT (1 << 20)
+
+/** @brief Milliseconds between checks of the stop flag */
+#define SERVER_POLL_INTERVAL 100
+
+/**
+ * @struct Connection
+ * @brief State of one client connection
+ */
+typedef struct Connection
+{
+    int fd;
+    unsigned char *in; /**< Received bytes not yet forming a whole frame */
+    size_t inLength;
+    unsigned char *out; /**< Replies, sent from outSent to outLength */
+    size_t outLength;
+    size_t outSent;
+    size_t outCapacity;
+    size_t roundStart; /**< Start of this round's (uncommitted) replies */
+    int inRound;
+    int closing;
+    int paused; /**< Reading stopped until the replies drain */
+    struct Connection *nextInRound;
+    struct Connection *prev, *next; /**< Every open connection, to close them on stop */
+} Connection;
+
+/** @brief Open connections of the running server loop */
+static Connection *connections = NULL;
+
+static volatile sig_atomic_t stopRequested = 0;
+static volatile sig_atomic_t backupRequested = 0;
+
+/** @brief Destination of backups requested with SIGUSR1, or NULL */
+static const char *backupPath = NULL;
+
+/** @brief Set by the backup thread as it finishes, so joining it never blocks */
+static int backupDone = 0;
+
+/**
+ * @brief Asks a running server loop to finish
+ *
+ * Safe to call from a signal handler or another thread.
+ */
+void serverStop()
+{
+    stopRequested = 1;
+}
+
+static void onSignal(int signal)
+{
+    if (signal == SIGUSR1)
+        backupRequested = 1;
+    else
+        serverStop();
+}
+
+/**
+ * @brief Sets the file a running server backs up to on SIGUSR1
+ * @param path Backup file, or NULL to ignore the signal
+ */
+void serverSetBackupPath(const char *path)
+{
+    backupPath = path;
+}
+
+static void *backupThread(void *argument)
+{
+    (void)argument;
+    if (bankBackup(backupPath))
+        printf("Backed up accounts to %s\n", backupPath);
+    else
+        fprintf(stderr, "Backup to %s failed\n", backupPath);
+    fflush(stdout);
+    __atomic_store_n(&backupDone, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/**
+ * @brief Resolves an address into a socket address
+ * @return Socket family, or -1 if the address is invalid
+ */
+static int resolveAddress(const char *address, struct sockaddr_storage *storage, socklen_t *length)
+{
+    memset(storage, 0, sizeof(*storage));
+    if (strchr(address, '/'))
+    {
+        struct sockaddr_un *un = (struct sockaddr_un *)storage;
+        if (strlen(address) >= sizeof(un->sun_path))
+            return -1;
+        un->sun_family = AF_UNIX;
+        strcpy(un->sun_path, address);
+        *length = sizeof(*un);
+        return AF_UNIX;
+    }
+
+    char host[256] = "127.0.0.1";
+    const char *port = strrchr(address, ':');
+    if (port)
+    {
+        size_t hostLength = (size_t)(port - address);
+        if (hostLength == 0 || hostLength >= sizeof(host))
+            return -1;
+        memcpy(host, address, hostLength);
+        host[hostLength] = '\0';
+        port++;
+    }
+    else
+        port = address;
+
+    struct addrinfo hints, *found;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, port, &hints, &found) != 0)
+        return -1;
+    memcpy(storage, found->ai_addr, found->ai_addrlen);
+    *length = found->ai_addrlen;
+    freeaddrinfo(found);
+    return AF_INET;
+}
+
+/**
+ * @brief Opens a client connection to a server
+ * @param address Unix socket path or "[host:]port"
+ * @return Connected socket, or -1 on failure
+ */
+int serverConnect(const char *address)
+{
+    struct sockaddr_storage storage;
+    socklen_t length;
+    int family = resolveAddress(address, &storage, &length);
+    if (family < 0)
+        return -1;
+
+    int fd = socket(family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, (struct sockaddr *)&storage, length) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    if (family == AF_INET)
+    {
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+    return fd;
+}
+
+/**
+ * @brief Creates the listening socket
+ * @return Listening socket, or -1 on failure
+ */
+static int listenOn(const char *address)
+{
+    struct sockaddr_storage storage;
+    socklen_t length;
+    int family = resolveAddress(address, &storage, &length);
+    if (family < 0)
+    {
+        fprintf(stderr, "Invalid server address %s\n", address);
+        return -1;
+    }
+
+    int fd = socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    int on = 1;
+    if (family == AF_UNIX)
+        unlink(address);
+    else
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    if (bind(fd, (struct sockaddr *)&storage, length) != 0 || listen(fd, SOMAXCONN) != 0)
+    {
+        perror(address);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Appends a reply to a connection's output
+ * @return 1 on success, 0 if out of memory
+ */
+static int queueReply(Connection *conn, const ServerResponse *response)
+{
+    if (conn->outLength + sizeof(*response) > conn->outCapacity)
+    {
+        // Compact away what has been sent before growing
+        if (conn->outSent > 0 && conn->outSent >= conn->roundStart)
+        {
+            memmove(conn->out, conn->out + conn->outSent, conn->outLength - conn->outSent);
+            conn->outLength -= conn->outSent;
+            conn->roundStart -= conn->outSent;
+            conn->outSent = 0;
+        }
+        if (conn->outLength + sizeof(*response) > conn->outCapacity)
+        {
+            size_t capacity = conn->outCapacity ? conn->outCapacity * 2 : 4096;
+            unsigned char *out = (unsigned char *)realloc(conn->out, capacity);
+            if (!out)
+                return 0;
+            conn->out = out;
+            conn->outCapacity = capacity;
+        }
+    }
+    memcpy(conn->out + conn->outLength, response, sizeof(*response));
+    conn->outLength += sizeof(*response);
+    return 1;
+}
+
+/**
+ * @brief Applies one request frame and queues its reply
+ * @return 1 on success, 0 if out of memory
+ */
+static int serveFrame(Connection *conn, const ServerRequest *frame, uint64_t *maxLsn)
+{
+    BankRequest request;
+    BankResult result;
+    ServerResponse response;
+
+    memset(&request, 0, sizeof(request));
+    request.op = (char)frame->op;
+    request.accountNumber = frame->accountNumber;
+    request.toAccount = frame->toAccount;
+    request.amount = frame->amount;
+    memcpy(request.username, frame->username, sizeof(request.username) - 1);
+
+    engineExecute(&request, &result);
+    if (result.lsn > *maxLsn)
+        *maxLsn = result.lsn;
+
+    memset(&response, 0, sizeof(response));
+    response.op = frame->op;
+    response.status = (uint8_t)result.status;
+    response.requestId = frame->requestId;
+    response.balance = result.balance;
+    return queueReply(conn, &response);
+}
+
+/**
+ * @brief Reads what a connection has sent and serves every whole frame
+ * @return 1 on success, 0 if the connection failed
+ */
+static int readRequests(Connection *conn, uint64_t *maxLsn, size_t *served)
+{
+    ssize_t n = recv(conn->fd, conn->in + conn->inLength, SERVER_READ_CHUNK, 0);
+    if (n < 0)
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    if (n == 0)
+    {
+        conn->closing = 1;
+        return 1;
+    }
+    conn->inLength += (size_t)n;
+
+    size_t offset = 0;
+    ServerRequest frame;
+    while (conn->inLength - offset >= sizeof(frame))
+    {
+        memcpy(&frame, conn->in + offset, sizeof(frame));
+        if (!serveFrame(conn, &frame, maxLsn))
+            return 0;
+        offset += sizeof(frame);
+        (*served)++;
+    }
+    memmove(conn->in, conn->in + offset, conn->inLength - offset);
+    conn->inLength -= offset;
+    return 1;
+}
+
+/**
+ * @brief Sends queued replies up to a limit
+ * @return 1 on success, 0 if the connection failed
+ */
+static int sendReplies(Connection *conn, size_t limit)
+{
+    while (conn->outSent < limit)
+    {
+        ssize_t n = send(conn->fd, conn->out + conn->outSent, limit - conn->outSent, MSG_NOSIGNAL);
+        if (n < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        conn->outSent += (size_t)n;
+    }
+    if (conn->outSent == conn->outLength)
+        conn->outSent = conn->outLength = conn->roundStart = 0;
+    return 1;
+}
+
+/**
+ * @brief Chooses the events a connection waits for
+ */
+static void updateInterest(int epollFd, Connection *conn)
+{
+    struct epoll_event event;
+    size_t unsent = conn->outLength - conn->outSent;
+
+    conn->paused = unsent > SERVER_MAX_PENDING_OUTPUT;
+    event.events = (conn->paused || conn->closing ? 0 : EPOLLIN) | (unsent ? EPOLLOUT : 0);
+    event.data.ptr = conn;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, conn->fd, &event);
+}
+
+static void closeConnection(int epollFd, Connection *conn)
+{
+    if (conn->prev)
+        conn->prev->next = conn->next;
+    else
+        connections = conn->next;
+    if (conn->next)
+        conn->next->prev = conn->prev;
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    free(conn->in);
+    free(conn->out);
+    free(conn);
+}
+
+/**
+ * @brief Accepts every pending connection
+ */
+static void acceptClients(int epollFd, int listenFd)
+{
+    for (;;)
+    {
+        int fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+        Connection *conn = (Connection *)calloc(1, sizeof(Connection));
+        unsigned char *in = (unsigned char *)malloc(SERVER_READ_CHUNK + sizeof(ServerRequest));
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = conn;
+        if (!conn || !in || epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0)
+        {
+            free(conn);
+            free(in);
+            close(fd);
+            continue;
+        }
+        conn->fd = fd;
+        conn->in = in;
+        conn->next = connections;
+        if (connections)
+            connections->prev = conn;
+        connections = conn;
+    }
+}
+
+/**
+ * @brief Serves clients until serverStop() is called or a signal arrives
+ * @param address Unix socket path or "[host:]port" to listen on
+ * @return 1 after a clean stop, 0 if the server could not start
+ */
+int serverRun(const char *address)
+{
+    if (!bankEnsureOpen())
+        return 0;
+
+    int listenFd = listenOn(address);
+    if (listenFd < 0)
+        return 0;
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = NULL; // NULL marks the listening socket
+    if (epollFd < 0 || epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event) != 0)
+    {
+        close(listenFd);
+        return 0;
+    }
+
+    struct sigaction action, oldInt, oldTerm, oldUsr1;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = onSignal;
+    sigaction(SIGINT, &action, &oldInt);
+    sigaction(SIGTERM, &action, &oldTerm);
+    sigaction(SIGUSR1, &action, &oldUsr1);
+
+    printf("Serving accounts on %s\n", address);
+    fflush(stdout);
+
+    size_t served = 0, commits = 0;
+    struct epoll_event events[SERVER_MAX_EVENTS];
+    pthread_t backup;
+    int backingUp = 0;
+    stopRequested = 0;
+    backupRequested = 0;
+    while (!stopRequested)
+    {
+        if (backingUp && __atomic_load_n(&backupDone, __ATOMIC_ACQUIRE))
+        {
+            pthread_join(backup, NULL);
+            backingUp = 0;
+        }
+        // A request during a backup waits for it to finish rather than for the clients
+        if (backupRequested && backupPath && !backingUp)
+        {
+            backupRequested = 0;
+            __atomic_store_n(&backupDone, 0, __ATOMIC_RELAXED);
+            backingUp = pthread_create(&backup, NULL, backupThread, NULL) == 0;
+        }
+
+        int ready = epoll_wait(epollFd, events, SERVER_MAX_EVENTS, SERVER_POLL_INTERVAL);
+        Connection *round = NULL;
+        uint64_t maxLsn = 0;
+
+        for (int i = 0; i < ready; i++)
+        {
+            Connection *conn = (Connection *)events[i].data.ptr;
+            if (!conn)
+            {
+                acceptClients(epollFd, listenFd);
+                continue;
+            }
+
+            if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !conn->paused && !conn->closing)
+            {
+                if (!conn->inRound)
+                {
+                    conn->inRound = 1;
+                    conn->roundStart = conn->outLength;
+                    conn->nextInRound = round;
+                    round = conn;
+                }
+                if (!readRequests(conn, &maxLsn, &served))
+                    conn->closing = 1;
+            }
+            // Replies from earlier rounds are committed and may go now
+            if ((events[i].events & EPOLLOUT) && !sendReplies(conn, conn->inRound ? conn->roundStart : conn->outLength))
+                conn->closing = 1;
+            if (!conn->inRound)
+            {
+                if (conn->closing && conn->outSent == conn->outLength)
+                    closeConnection(epollFd, conn);
+                else
+                    updateInterest(epollFd, conn);
+            }
+        }
+
+        // One commit makes every change of this round durable
+        int committed = maxLsn == 0 || walCommitUpTo(maxLsn);
+        if (maxLsn)
+            commits++;
+
+        while (round)
+        {
+            Connection *conn = round;
+            round = conn->nextInRound;
+            conn->inRound = 0;
+
+            // Without the commit no reply of the round can be trusted: even a
+            // balance may show changes that never became durable
+            if (!committed)
+                for (size_t at = conn->roundStart; at < conn->outLength; at += sizeof(ServerResponse))
+                    ((ServerResponse *)(conn->out + at))->status = BANK_IO_ERROR;
+            if (!sendReplies(conn, conn->outLength) || (conn->closing && conn->outSent == conn->outLength))
+                closeConnection(epollFd, conn);
+            else
+                updateInterest(epollFd, conn);
+        }
+    }
+
+    if (backingUp)
+        pthread_join(backup, NULL);
+    while (connections)
+        closeConnection(epollFd, connections);
+    sigaction(SIGINT, &oldInt, NULL);
+    sigaction(SIGTERM, &oldTerm, NULL);
+    sigaction(SIGUSR1, &oldUsr1, NULL);
+    close(epollFd);
+    close(listenFd);
+    if (strchr(address, '/'))
+        unlink(address);
+    printf("Served %zu requests with %zu log commits\n", served, commits);
+    return 1;
+}
@@ -0,0 +1,179 @@
+/**
+ * @file main.c
+ * @brief Entry point of the bank management system
+ *
+ * Usage: bank_management_system [--mmap] [--cache <records>] [--write-back]
+ *                               [--kernel <name>]
+ *                               [--batch <transactions> <results>]
+ *                               [--bulk stats | interest <percent> | fee <amount>]
+ *                               [--history <account> [count]]
+ *                               [--history-range <account> <from> <to>]
+ *                               [--serve <address>] [--compact]
+ *                               [--find <name> | --find-prefix <prefix>]
+ *                               [--backup <file>]
+ *   --mmap    Use the memory-mapped storage engine for accounts.dat
+ *   --cache   Number of account records kept resident (0 disables the cache)
+ *   --write-back  Log cached updates only on eviction, commit or exit
+ *   --kernel  Force the bulk kernel: scalar, sse or avx2 (default: fastest)
+ *   --batch   Apply a transaction file without the interactive menu
+ *   --bulk    Run a whole-book pass over every account
+ *   --history Show an account's most recent transactions (default 20)
+ *   --history-range  Show an account's transactions between two times,
+ *             given in seconds since the epoch
+ *   --serve   Serve clients on a Unix socket path or "[host:]port" until
+ *             interrupted
+ *   --compact Move accounts into the slots of closed ones and shrink
+ *             accounts.dat
+ *   --find    List the accounts held under exactly this name
+ *   --find-prefix  List the accounts whose holder name starts with prefix
+ *             (at most 100)
+ *   --backup  Write a point-in-time copy of accounts.dat to file; with
+ *             --serve, write it each time the server receives SIGUSR1
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bank_management_system.h"
+
+/**
+ * @brief Main entry point of the program
+ * @return 0 on successful execution, 1 on invalid arguments
+ */
+int main(int argc, char *argv[])
+{
+    const char *batchInput = NULL, *batchOutput = NULL;
+    const char *bulkJob = NULL, *bulkArgument = NULL;
+    const char *serveAddress = NULL, *findText = NULL, *backupFile = NULL;
+    int findPrefix = 0;
+    long cacheSize = -1;
+    int historyAccount = 0, showingHistory = 0;
+    long historyCount = 20;
+    int64_t historyFrom = INT64_MIN, historyTo = INT64_MAX;
+    int cacheWriteBack = 0, compacting = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--mmap") == 0)
+        {
+            storeSetBackend(STORE_BACKEND_MMAP);
+        }
+        else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc && atol(argv[i + 1]) >= 0)
+        {
+            cacheSize = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--write-back") == 0)
+        {
+            cacheWriteBack = 1;
+        }
+        else if (strcmp(argv[i], "--batch") == 0 && i + 2 < argc)
+        {
+            batchInput = argv[++i];
+            batchOutput = argv[++i];
+        }
+        else if (strcmp(argv[i], "--bulk") == 0 && i + 1 < argc)
+        {
+            bulkJob = argv[++i];
+            if (strcmp(bulkJob, "stats") != 0 && i + 1 < argc)
+                bulkArgument = argv[++i];
+        }
+        else if (strcmp(argv[i], "--history") == 0 && i + 1 < argc)
+        {
+            showingHistory = 1;
+            historyAccount = atoi(argv[++i]);
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                historyCount = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--history-range") == 0 && i + 3 < argc)
+        {
+            showingHistory = 1;
+            historyAccount = atoi(argv[++i]);
+            historyFrom = atoll(argv[++i]) * 1000000;
+            historyTo = atoll(argv[++i]) * 1000000 + 999999;
+            historyCount = 1000000;
+        }
+        else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc)
+        {
+            serveAddress = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--find") == 0 || strcmp(argv[i], "--find-prefix") == 0) && i + 1 < argc)
+        {
+            findPrefix = strcmp(argv[i], "--find-prefix") == 0;
+            findText = argv[++i];
+        }
+        else if (strcmp(argv[i], "--backup") == 0 && i + 1 < argc)
+        {
+            backupFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "--compact") == 0)
+        {
+            compacting = 1;
+        }
+        else if (strcmp(argv[i], "--kernel") == 0 && i + 1 < argc)
+        {
+            const char *name = argv[++i];
+            int kernel = strcmp(name, "scalar") == 0 ? BULK_KERNEL_SCALAR
+                         : strcmp(name, "sse") == 0  ? BULK_KERNEL_SSE
+                         : strcmp(name, "avx2") == 0 ? BULK_KERNEL_AVX2
+                                                     : -1;
+            if (kernel < 0 || !bulkSetKernel(kernel))
+            {
+                fprintf(stderr, "Kernel %s is not available on this CPU\n", name);
+                return 1;
+            }
+        }
+        else
+        {
+            fprintf(stderr,
+                    "Usage: %s [--mmap] [--cache <records>] [--write-back] [--kernel <name>]\n"
+                    "          [--batch <transactions> <results>]\n"
+                    "          [--bulk stats | interest <percent> | fee <amount>]\n"
+                    "          [--history <account> [count]] [--history-range <account> <from> <to>]\n"
+                    "          [--serve <address>] [--compact]\n"
+                    "          [--find <name> | --find-prefix <prefix>] [--backup <file>]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    if (cacheSize >= 0 || cacheWriteBack)
+    {
+        CacheStats current;
+        cacheGetStats(&current);
+        cacheConfigure(cacheSize >= 0 ? (size_t)cacheSize : current.capacity,
+                       cacheWriteBack ? CACHE_WRITE_BACK : CACHE_WRITE_THROUGH);
+    }
+
+    if (batchInput)
+        return runBatch(batchInput, batchOutput) ? 0 : 1;
+    if (bulkJob)
+        return bankEnsureOpen() && runBulkJob(bulkJob, bulkArgument) ? 0 : 1;
+    if (findText)
+        return showMatches(findText, findPrefix, 100) ? 0 : 1;
+    if (compacting)
+    {
+        size_t moved = 0;
+        if (!engineCompact(&moved))
+            return 1;
+        printf("Moved %zu accounts; %zu records, %zu free slots\n", moved, storeRecordCount(), indexFreeCount());
+        return 0;
+    }
+    if (serveAddress)
+    {
+        serverSetBackupPath(backupFile);
+        int ok = serverRun(serveAddress);
+        bankClose();
+        return ok ? 0 : 1;
+    }
+    if (backupFile)
+    {
+        int ok = bankBackup(backupFile);
+        bankClose();
+        return ok ? 0 : 1;
+    }
+    if (showingHistory)
+        return historyCount > 0 && showHistory(historyAccount, historyFrom, historyTo, (size_t)historyCount) ? 0 : 1;
+
+    menu();
+    return 0;
+}
@@ -0,0 +1,74 @@
+/**
+ * @file money.c
+ * @brief Conversions between text and fixed-point money amounts
+ *
+ * Amounts are kept as a whole number of minor units (MONEY_SCALE per major
+ * unit) so that balances add and subtract exactly, whatever their size.
+ */
+
+#include <stdio.h>
+#include <ctype.h>
+#include <inttypes.h>
+#include "bank_management_system.h"
+
+/**
+ * @brief Parses a decimal amount such as "12", "12.5" or "-0.75"
+ * @param text Amount with at most two decimal places
+ * @param amount Receives the amount in minor units
+ * @return 1 on success, 0 if the text is not a valid amount
+ */
+int parseMoney(const char *text, money_t *amount)
+{
+    int negative = 0, digits = 0, decimals = 0;
+    money_t value = 0;
+
+    while (isspace((unsigned char)*text))
+        text++;
+    if (*text == '-' || *text == '+')
+        negative = *text++ == '-';
+
+    for (; isdigit((unsigned char)*text); text++, digits++)
+    {
+        if (value > (INT64_MAX / MONEY_SCALE - 9) / 10)
+            return 0;
+        value = value * 10 + (*text - '0');
+    }
+    value *= MONEY_SCALE;
+
+    if (*text == '.')
+    {
+        int unit = MONEY_SCALE / 10;
+        for (text++; isdigit((unsigned char)*text); text++, decimals++)
+        {
+            if (unit == 0)
+                return 0; // More precision than a minor unit
+            value += (*text - '0') * unit;
+            unit /= 10;
+        }
+    }
+
+    while (isspace((unsigned char)*text))
+        text++;
+    if (*text != '\0' || digits + decimals == 0)
+        return 0;
+
+    *amount = negative ? -value : value;
+    return 1;
+}
+
+/**
+ * @brief Formats an amount with two decimal places
+ * @param amount Amount in minor units
+ * @param buffer Destination for the text
+ * @param size Size of the destination (24 bytes always suffice)
+ * @return The buffer, for use directly in printf arguments
+ */
+const char *formatMoney(money_t amount, char *buffer, size_t size)
+{
+    const char *sign = amount < 0 ? "-" : "";
+    uint64_t magnitude = amount < 0 ? -(uint64_t)amount : (uint64_t)amount;
+
+    snprintf(buffer, size, "%s%" PRIu64 ".%02" PRIu64, sign,
+             magnitude / MONEY_SCALE, magnitude % MONEY_SCALE);
+    return buffer;
+}
@@ -1,20 +1,289 @@
 #ifndef BANK_MANAGEMENT_SYSTEM_H
 #define BANK_MANAGEMENT_SYSTEM_H
 
+#include <stddef.h>
+#include <stdio.h>
+#include <stdint.h>
+
+// Money is held as a whole number of minor units (paise/cents)
+typedef int64_t money_t;
+#define MONEY_SCALE 100
+
 typedef struct
 {
     char username[30];
     int accountNumber;
-    float balance;
+    uint32_t flags; // ACCOUNT_* bits, zero for an open account
+    money_t balance;
 } Account;
 
+// A closed account's record is a tombstone whose slot can be reused
+#define ACCOUNT_CLOSED 0x1u
+
+// Structure-of-arrays copy of the accounts for whole-book passes
+typedef struct
+{
+    size_t count;
+    size_t *slots; // Record slot of each open account
+    int *accountNumbers;
+    money_t *balances;
+    char (*usernames)[30];
+} AccountColumns;
+
+// One entry of an account's transaction history (see the ledger functions)
+typedef struct
+{
+    int64_t timestamp; // Microseconds since the epoch, never decreasing
+    money_t amount;    // Signed change of the balance
+    money_t balance;   // Balance after the change
+    uint64_t previous; // Sequence number + 1 of the account's previous entry
+    int32_t accountNumber;
+    char op;
+    char reserved[3];
+} LedgerEntry;
+
 void createAccount();
 void depositMoney();
 void withdrawMoney();
 void checkBalance();
+void closeAccount();
 void menu();
 int isUniqueAccountNumber(int accountNumber);
 Account *getAccountByNumber(int accountNumber);
+int findAccount(int accountNumber, Account *account);
 void saveAccount(Account account);
 
+// Database lifecycle (opened lazily on FILENAME if never called)
+int bankOpen(const char *path);
+int bankEnsureOpen();
+void bankClose();
+size_t bankSetGroupCommit(size_t size);
+int bankCommit();
+int bankReadRecord(size_t slot, Account *account);
+int bankUpdateRecord(size_t slot, const Account *account);
+uint64_t bankInsertRecord(const Account *account, size_t *slot, const LedgerEntry *history);
+
+// Thread-safe transaction engine; every call returns one of these codes
+#define BANK_OK 0
+#define BANK_NOT_FOUND 1
+#define BANK_INVALID_AMOUNT 2
+#define BANK_INSUFFICIENT_FUNDS 3
+#define BANK_DUPLICATE_ACCOUNT 4
+#define BANK_SAME_ACCOUNT 5
+#define BANK_IO_ERROR 6
+#define BANK_BAD_REQUEST 7
+#define BANK_NOT_EMPTY 8 // Only accounts with a zero balance can be closed
+
+// Engine operations, also the op codes of the server protocol
+#define BANK_OP_CREATE 'C'
+#define BANK_OP_BALANCE 'B'
+#define BANK_OP_DEPOSIT 'D'
+#define BANK_OP_WITHDRAW 'W'
+#define BANK_OP_TRANSFER 'T'
+#define BANK_OP_CLOSE 'X'
+
+typedef struct
+{
+    char op;
+    int accountNumber;
+    int toAccount; // Transfers only
+    money_t amount;
+    char username[30]; // Creates only
+} BankRequest;
+
+typedef struct
+{
+    int status;
+    money_t balance;
+    uint64_t lsn; // Log position to commit before reporting success
+} BankResult;
+
+int engineExecute(const BankRequest *request, BankResult *result);
+int engineCreate(const char *username, int accountNumber);
+int engineBalance(int accountNumber, money_t *balance);
+int engineDeposit(int accountNumber, money_t amount, money_t *balance);
+int engineWithdraw(int accountNumber, money_t amount, money_t *balance);
+int engineTransfer(int fromAccount, int toAccount, money_t amount);
+int engineClose(int accountNumber);
+int engineCompact(size_t *moved);
+const char *bankStatusName(int status);
+
+// Resident record cache between the bank functions and the log/store
+#define CACHE_WRITE_THROUGH 0 // Updates are logged at once (default)
+#define CACHE_WRITE_BACK 1    // Updates are logged on eviction or flush
+
+typedef struct
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t writeBacks; // Dirty records logged by eviction or flush
+    size_t entries;
+    size_t capacity;
+} CacheStats;
+
+int cacheConfigure(size_t size, int writePolicy);
+int cachePolicy();
+int cacheLookup(size_t slot, Account *account);
+int cacheStore(size_t slot, const Account *account, int dirty);
+int cacheFlush();
+void cacheClear();
+void cacheGetStats(CacheStats *stats);
+
+// Fixed-point money conversions
+int parseMoney(const char *text, money_t *amount);
+const char *formatMoney(money_t amount, char *buffer, size_t size);
+
+// Columnar account snapshots
+int columnsLoad(AccountColumns *columns);
+int columnsStoreBalances(const AccountColumns *columns, const money_t *previous);
+money_t columnsTotalBalance(const AccountColumns *columns);
+void columnsFree(AccountColumns *columns);
+
+// Whole-book bulk passes over a balance column, vectorised where supported
+#define BULK_KERNEL_AUTO 0
+#define BULK_KERNEL_SCALAR 1
+#define BULK_KERNEL_SSE 2
+#define BULK_KERNEL_AVX2 3
+
+// Histogram buckets: below 1.00, then one per decade up to 1e9, then above
+#define BULK_HISTOGRAM_BUCKETS 11
+
+typedef struct
+{
+    size_t count;
+    money_t total;
+    money_t minimum;
+    money_t maximum;
+    size_t histogram[BULK_HISTOGRAM_BUCKETS];
+} BulkStats;
+
+int bulkSetKernel(int kernel);
+const char *bulkKernelName();
+int bulkParseRate(const char *percent, uint32_t *rate);
+void bulkStats(const money_t *balances, size_t count, BulkStats *stats);
+money_t bulkApplyInterest(money_t *balances, size_t count, uint32_t rate);
+money_t bulkApplyFee(money_t *balances, size_t count, money_t fee);
+int runBulkJob(const char *job, const char *argument);
+
+// Per-account transaction history in segmented append-only files
+#define LEDGER_OPEN 'O'
+#define LEDGER_DEPOSIT 'D'
+#define LEDGER_WITHDRAW 'W'
+#define LEDGER_TRANSFER 'T'
+#define LEDGER_INTEREST 'I'
+#define LEDGER_FEE 'F'
+#define LEDGER_CLOSE 'X'
+
+void ledgerSetSegmentSize(uint32_t entries);
+int ledgerOpen(const char *path);
+void ledgerClose();
+int ledgerAppend(int accountNumber, char op, money_t amount, money_t balance);
+int ledgerAppendAt(int accountNumber, char op, money_t amount, money_t balance, int64_t timestamp);
+void ledgerEntryInit(LedgerEntry *entry, int accountNumber, char op, money_t amount, money_t balance);
+int ledgerRecord(const LedgerEntry *entries, size_t count);
+int ledgerFlush();
+uint64_t ledgerCount();
+size_t ledgerLast(int accountNumber, size_t count, LedgerEntry *entries);
+size_t ledgerRange(int accountNumber, int64_t from, int64_t to, LedgerEntry *entries, size_t count);
+int showHistory(int accountNumber, int64_t from, int64_t to, size_t count);
+
+// Secondary index from account holder names to account numbers
+typedef struct
+{
+    char username[30];
+    int accountNumber;
+} NameEntry;
+
+int namesOpen(const char *path, size_t recordCount);
+void namesClose();
+int namesInsert(const char *username, int accountNumber);
+int namesRemove(const char *username, int accountNumber);
+size_t namesSearch(const char *text, int prefix, NameEntry *matches, size_t count);
+size_t namesCount();
+int showMatches(const char *text, int prefix, size_t count);
+
+// Point-in-time copy of the database taken while it stays in use
+int bankBackup(const char *path);
+
+// Batch ingestion of a transaction file (see bank_batch.c for the formats)
+int runBatch(const char *inputPath, const char *outputPath);
+
+// Socket server: fixed-size frames in native byte order (see bank_server.c)
+typedef struct
+{
+    uint8_t op; // BANK_OP_*
+    uint8_t reserved[3];
+    uint32_t requestId; // Echoed in the response
+    int32_t accountNumber;
+    int32_t toAccount;
+    int64_t amount; // Minor units
+    char username[32];
+} ServerRequest;
+
+typedef struct
+{
+    uint8_t op;
+    uint8_t status; // BANK_* status code
+    uint8_t reserved[2];
+    uint32_t requestId;
+    int64_t balance; // Minor units, after the operation
+} ServerResponse;
+
+int serverRun(const char *address);
+void serverStop();
+void serverSetBackupPath(const char *path);
+int serverConnect(const char *address);
+
+// Record file: fixed-size Account records addressed by slot number
+#define STORE_BACKEND_STDIO 0 // Buffered stdio reads and writes (default)
+#define STORE_BACKEND_MMAP 1  // Records accessed in place on mapped pages
+
+void storeSetBackend(int which);
+int storeOpen(const char *path);
+int storeSync();
+void storeClose();
+size_t storeRecordCount();
+int storeReadRecord(size_t slot, Account *account);
+size_t storeReadRecords(size_t first, Account *buffer, size_t count);
+int storeWriteRecord(size_t slot, const Account *account);
+long storeAppendRecord(const Account *account);
+size_t storeAppendRecords(const Account *accounts, size_t count);
+int storeTruncate(size_t count);
+int storeWriteHeader(FILE *file);
+long storeSnapshotBegin();
+size_t storeSnapshotRead(size_t first, Account *buffer, size_t count);
+size_t storeSnapshotEnd();
+
+// Write-ahead log: record after-images made durable in groups
+int walOpen(const char *path);
+long walRecover();
+uint64_t walAppend(size_t slot, const Account *account);
+uint64_t walAppendRecords(const size_t *slots, const Account *accounts, int count);
+uint64_t walAppendHistory(const size_t *slots, const Account *accounts, int count, const LedgerEntry *history,
+                          int historyCount);
+uint64_t walAppendNew(const Account *account, size_t *slot, const LedgerEntry *history);
+size_t walPendingCount();
+size_t walNextAppendSlot();
+int walPendingLookup(size_t slot, Account *account);
+int walCommitUpTo(uint64_t lsn);
+int walCommit();
+int walCheckpoint();
+int walTruncate(size_t recordCount);
+long walSnapshot();
+void walClose();
+
+// Persistent hash index (accountNumber -> slot) and free-slot list, kept
+// in a sidecar file
+int indexOpen(const char *path, size_t recordCount);
+void indexClose();
+long indexLookup(int accountNumber);
+int indexInsert(int accountNumber, size_t slot);
+int indexRemove(int accountNumber);
+int indexRebuild(size_t recordCount);
+int indexReleaseSlot(size_t slot);
+long indexTakeFreeSlot(size_t below);
+size_t indexFreeCount();
+void indexTruncate(size_t recordCount);
+
 #endif // BANK_MANAGEMENT_SYSTEM_H
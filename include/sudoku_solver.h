@@ -2,11 +2,46 @@
 #define SUDOKU_SOLVER_H
 
 #include <stdbool.h>
+#include <stdio.h>
 
 #define N 9
+#define ANSI_COLOR_RED "\x1b[91m"
+#define ANSI_COLOR_GREEN "\x1b[92m"
+#define ANSI_COLOR_BLUE "\x1b[96m"
+#define ANSI_COLOR_YELLOW "\x1b[93m"
+#define ANSI_COLOR_MAGENTA "\x1b[95m"
+#define ANSI_COLOR_RESET "\x1b[0m"
+
+// Solver backends, for solveSudokuWith()
+#define SUDOKU_BACKEND_BITMASK 0      // Candidate masks, singles and MRV (default)
+#define SUDOKU_BACKEND_DLX 1          // Exact cover with Dancing Links
+#define SUDOKU_BACKEND_BACKTRACKING 2 // Plain backtracking in cell order
+#define SUDOKU_BACKEND_COUNT 3
+
+// Candidate kernels of the bitmask backend, chosen by CPU detection by default
+#define SUDOKU_KERNEL_AUTO 0
+#define SUDOKU_KERNEL_SCALAR 1
+#define SUDOKU_KERNEL_SSE 2
+#define SUDOKU_KERNEL_AVX2 3
+
+// Totals of a batch run
+typedef struct
+{
+    long puzzles; // Puzzle lines read
+    long solved;
+    double seconds;
+} SudokuBatchStats;
 
 bool isSafe(int grid[N][N], int row, int col, int num);
 bool solveSudoku(int grid[N][N]);
+bool solveSudokuWith(int grid[N][N], int backend);
+bool solveSudokuBacktracking(int grid[N][N]);
+bool solveSudokuDlx(int grid[N][N]);
+int countSudokuSolutions(int grid[N][N], int limit);
+const char *sudokuBackendName(int backend);
+bool sudokuSetKernel(int kernel);
+const char *sudokuKernelName();
+bool solveSudokuFile(const char *inputPath, FILE *output, int threads, int backend, SudokuBatchStats *stats);
 bool findEmptyLocation(int grid[N][N], int *row, int *col);
 void printGrid(int grid[N][N]);
 
@@ -1,7 +1,26 @@
 #ifndef TIC_TAC_TOE_H
 #define TIC_TAC_TOE_H
 
-#define SIZE 3 // Define the size of the board
+#include <stdint.h>
+
+#define SIZE 3 // Default board size, and the one the bitboard search plays
+#define CELLS (SIZE * SIZE)
+#define MAX_SIZE 15 // Largest supported board (15x15 gomoku)
+
+// An N x N board on which K stones in a row win
+typedef struct
+{
+    int size;               // Rows and columns in play
+    int k;                  // Stones in a row needed to win
+    int moves;              // Stones placed so far
+    int last_row, last_col; // Most recent move, -1 before the first
+    char cells[MAX_SIZE][MAX_SIZE];
+} Board;
+
+extern Board board; // The game in progress
+extern int board_size, win_length;
+extern int search_time_ms; // Thinking time per move beyond 3x3
+extern uint64_t game_rng;  // Random state of the interactive game
 
 // Function prototypes
 void initialize_board();
@@ -12,9 +31,88 @@ int is_winner(char symbol);
 int is_draw();
 void player_move();
 void computer_move(int difficulty);
-int minimax(char board[SIZE][SIZE], int depth, int isMaximizing);
+int minimax(char board[MAX_SIZE][MAX_SIZE], int depth, int isMaximizing);
 int check_available_moves();
 void play_game(int difficulty);
+void play_games();
 int prompt_difficulty();
 
+// Headless engines (engine.c); the numbers match the difficulty levels
+#define ENGINE_RANDOM 0
+#define ENGINE_HUMAN 1 // Wins or blocks when it can, else plays at random
+#define ENGINE_GOD 2   // Perfect play on 3x3, timed search beyond
+#define ENGINE_MCTS 3  // Monte Carlo tree search on any board
+#define ENGINE_COUNT 4
+
+void rng_seed(uint64_t *state, uint64_t seed);
+uint64_t rng_next(uint64_t *state);
+int rng_below(uint64_t *state, int n);
+int engine_move(int engine, const Board *b, char symbol, uint64_t *rng, int *row, int *col);
+char engine_play_game(int x_engine, int o_engine, int size, int k, char first, uint64_t *rng);
+const char *engine_name(int engine);
+int engine_lookup(const char *name);
+
+// Board operations (board.c)
+int board_init(Board *b, int size, int k);
+void board_play(Board *b, int row, int col, char symbol);
+void board_undo(Board *b, int row, int col);
+int board_wins(const Board *b, int row, int col);
+int board_full(const Board *b);
+unsigned board_mask(const Board *b, char symbol);
+int tablebase_move(unsigned own, unsigned opponent, int *outcome);
+
+// Bitboard search: one 9-bit mask per player, bit 3 * row + col
+int bitboard_best_move(unsigned own, unsigned opponent, int *score);
+unsigned long bitboard_nodes();
+void bitboard_clear_table();
+
+// Perfect-play table for 3x3, generated at build time (tablebase_gen.c)
+#define TABLEBASE_SIZE 19683 // 3^9 positions
+#define TABLEBASE_NONE 0xFF
+extern const unsigned short tablebase_digits[1 << CELLS];
+extern const unsigned char tablebase[TABLEBASE_SIZE];
+extern const unsigned short threat_cells[1 << CELLS]; // Cells completing a line of the given stones
+
+// Depth-limited alpha-beta search for any board (search.c)
+#define SEARCH_WIN 1000000000 // Scores beyond SEARCH_WIN - MAX_SIZE * MAX_SIZE are forced wins
+
+typedef struct
+{
+    int row, col; // Chosen move, -1 if the board is full
+    int score;    // For the side to move
+    int depth;    // Deepest iteration completed
+    unsigned long nodes;
+} SearchResult;
+
+int search_best_move(const Board *b, char symbol, int time_limit_ms, SearchResult *result);
+void search_set_threads(int threads);
+void search_set_max_depth(int depth);
+
+// Monte Carlo tree search for any board (mcts.c)
+typedef struct
+{
+    int row, col;    // Chosen move, -1 if the board is full
+    double win_rate; // Share of the move's playouts won, draws counting half
+    long iterations;
+} MctsResult;
+
+extern int mcts_iterations; // Playouts per move of the MCTS engine, 0: think for search_time_ms
+
+int mcts_best_move(const Board *b, char symbol, long iterations, int time_limit_ms, uint64_t *rng, MctsResult *result);
+void mcts_set_threads(int threads);
+
+// Work-stealing thread pool (thread_pool.c)
+typedef struct ThreadPool ThreadPool;
+typedef void (*PoolTask)(void *arg);
+
+typedef struct
+{
+    int pending; // Tasks of the batch not yet finished
+} PoolBatch;
+
+ThreadPool *pool_create(int threads);
+void pool_submit(ThreadPool *pool, PoolBatch *batch, PoolTask function, void *arg);
+void pool_wait(ThreadPool *pool, PoolBatch *batch);
+void pool_destroy(ThreadPool *pool);
+
 #endif // TIC_TAC_TOE_H
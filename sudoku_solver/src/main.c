@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "sudoku_solver.h"
+
+// Usage: sudoku_solver                      Solve the built-in example
+//        sudoku_solver --batch <file> [--output <file>] [--threads N] [--backend name] [--kernel name]
+//   --batch    Solve every puzzle of a file, one 81-character line each; the
+//              solutions go to stdout (or --output) in the same order
+//   --threads  Worker threads (default: one per CPU)
+//   --backend  bitmask (default), dlx or backtracking
+//   --kernel   Candidate kernel of the bitmask backend: auto (default, by CPU
+//              detection), scalar, sse or avx2
+
+// Function to solve a puzzle file and report the throughput on stderr
+static int runBatch(const char *inputPath, const char *outputPath, int threads, int backend)
+{
+    FILE *output = outputPath ? fopen(outputPath, "w") : stdout;
+    if (!output)
+    {
+        perror(outputPath);
+        return 1;
+    }
+
+    SudokuBatchStats stats;
+    bool ok = solveSudokuFile(inputPath, output, threads, backend, &stats);
+    if (outputPath && fclose(output) != 0)
+        ok = false;
+    if (!ok)
+    {
+        perror(inputPath);
+        return 1;
+    }
+    fprintf(stderr, "%ld puzzles (%ld solved) in %.3f s: %.0f puzzles/s with %d thread%s, %s",
+            stats.puzzles, stats.solved, stats.seconds, stats.seconds > 0 ? stats.puzzles / stats.seconds : 0,
+            threads, threads == 1 ? "" : "s", sudokuBackendName(backend));
+    if (backend == SUDOKU_BACKEND_BITMASK)
+        fprintf(stderr, " (%s)", sudokuKernelName());
+    fprintf(stderr, "\n");
+    return 0;
+}
+
+// Main function to test the solver
+int main(int argc, char *argv[])
+{
+    const char *inputPath = NULL, *outputPath = NULL;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN), backend = SUDOKU_BACKEND_BITMASK;
+    bool usage = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+            inputPath = argv[++i];
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+            outputPath = argv[++i];
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+            threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc)
+        {
+            const char *name = argv[++i];
+            for (backend = 0; backend < SUDOKU_BACKEND_COUNT; backend++)
+                if (strcmp(name, sudokuBackendName(backend)) == 0)
+                    break;
+            usage = usage || backend == SUDOKU_BACKEND_COUNT;
+        }
+        else if (strcmp(argv[i], "--kernel") == 0 && i + 1 < argc)
+        {
+            static const char *const kernels[] = {"auto", "scalar", "sse", "avx2"};
+            const char *name = argv[++i];
+            int kernel = 0;
+            while (kernel < 4 && strcmp(name, kernels[kernel]) != 0)
+                kernel++;
+            if (kernel == 4)
+                usage = true;
+            else if (!sudokuSetKernel(kernel))
+            {
+                fprintf(stderr, "%s: this CPU cannot run the %s kernel\n", argv[0], name);
+                return 1;
+            }
+        }
+        else
+            usage = true;
+    }
+    if (usage || (outputPath && !inputPath))
+    {
+        fprintf(stderr, "Usage: %s [--batch <file> [--output <file>] [--threads N] [--backend bitmask|dlx|backtracking]\n"
+                        "       [--kernel auto|scalar|sse|avx2]]\n",
+                argv[0]);
+        return 1;
+    }
+    if (inputPath)
+        return runBatch(inputPath, outputPath, threads, backend);
+
+    int grid[N][N] = {
+        {0, 0, 0, 2, 6, 0, 7, 0, 1},
+        {6, 8, 0, 0, 7, 0, 0, 9, 0},
+        {1, 9, 0, 0, 0, 4, 5, 0, 0},
+        {8, 2, 0, 1, 0, 0, 0, 4, 0},
+        {0, 0, 4, 6, 0, 2, 9, 0, 0},
+        {0, 5, 0, 0, 0, 3, 0, 2, 8},
+        {0, 0, 9, 3, 0, 0, 0, 7, 4},
+        {0, 4, 0, 0, 5, 0, 0, 3, 6},
+        {7, 0, 3, 0, 1, 8, 0, 0, 0}};
+
+    printf(ANSI_COLOR_YELLOW "\nUnsolved Sudoku:" ANSI_COLOR_RESET);
+    printGrid(grid);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    bool solved = solveSudoku(grid);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if (solved == true)
+    {
+        printf(ANSI_COLOR_YELLOW "\nSolved Sudoku:" ANSI_COLOR_RESET);
+        printGrid(grid);
+    }
+    else
+        printf(ANSI_COLOR_RED "No solution exists\n" ANSI_COLOR_RESET);
+    printf("Solved in %.1f microseconds\n", (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3);
+
+    return 0;
+}
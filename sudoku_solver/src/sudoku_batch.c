@@ -0,0 +1,238 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "sudoku_solver.h"
+
+// Batch solving of puzzle files, one puzzle per line as 81 characters ('1'-'9',
+// '.' or '0' for empty), as most published collections are. Anything after the
+// 81st character, such as ",solution" in CSV dumps, is ignored, as are lines
+// that do not start with a puzzle (headers, comments, blank lines).
+//
+// The file is mapped and read in place. It is cut into chunks of about
+// CHUNK_BYTES, each starting at the first line that starts inside it, so a
+// worker finds its chunk's puzzles without any pass over the whole file. Worker
+// threads claim chunks in order and fill a per-chunk output buffer; the calling
+// thread writes the buffers out in chunk order, so solutions come out in the
+// order of the puzzles. At most WINDOW_PER_THREAD chunks per thread are ahead
+// of the writer, which keeps memory flat however large the file is.
+//
+// Each solution is written as an 81-digit line; a puzzle without a solution
+// gets a line of 81 dots.
+
+#define CHUNK_BYTES (64 * 1024)
+#define WINDOW_PER_THREAD 4
+#define LINE_LENGTH (N * N + 1) // Output: 81 digits and a newline
+
+typedef struct
+{
+    char *output;
+    size_t length; // Bytes of output, valid once done
+    long puzzles, solved;
+    bool done;
+} BatchSlot;
+
+typedef struct
+{
+    const char *data;
+    size_t size;
+    size_t chunks;
+    int backend;
+    pthread_mutex_t lock; // Guards everything below
+    pthread_cond_t changed;
+    size_t nextChunk; // Next chunk to be claimed
+    size_t written;   // Chunks written out so far
+    size_t window;
+    BatchSlot *slots; // Chunk k uses slot k % window
+} BatchJob;
+
+// Function to find the first line starting at or after 'offset'
+static size_t lineStart(const BatchJob *job, size_t offset)
+{
+    if (offset == 0)
+        return 0;
+    if (offset >= job->size)
+        return job->size;
+    const char *newline = memchr(job->data + offset - 1, '\n', job->size - offset + 1);
+    return newline ? (size_t)(newline - job->data) + 1 : job->size;
+}
+
+// Function to solve the puzzles of one chunk into its slot's buffer
+static void solveChunk(const BatchJob *job, size_t chunk, BatchSlot *slot)
+{
+    size_t position = lineStart(job, chunk * CHUNK_BYTES), end = lineStart(job, (chunk + 1) * CHUNK_BYTES);
+    char *out = slot->output;
+    slot->puzzles = slot->solved = 0;
+
+    while (position < end)
+    {
+        const char *line = job->data + position;
+        const char *newline = memchr(line, '\n', end - position);
+        size_t length = newline ? (size_t)(newline - line) : end - position;
+        position += length + 1;
+
+        int grid[N][N];
+        size_t cell = 0;
+        for (; cell < N * N && cell < length; cell++)
+        {
+            char c = line[cell];
+            if (c >= '1' && c <= '9')
+                grid[cell / N][cell % N] = c - '0';
+            else if (c == '.' || c == '0')
+                grid[cell / N][cell % N] = 0;
+            else
+                break;
+        }
+        if (cell < N * N)
+            continue; // Not a puzzle line
+
+        slot->puzzles++;
+        if (solveSudokuWith(grid, job->backend))
+        {
+            slot->solved++;
+            for (cell = 0; cell < N * N; cell++)
+                out[cell] = (char)('0' + grid[cell / N][cell % N]);
+        }
+        else
+            memset(out, '.', N * N);
+        out[N * N] = '\n';
+        out += LINE_LENGTH;
+    }
+    slot->length = (size_t)(out - slot->output);
+}
+
+// Worker thread: claims chunks in order while the writer has room for them
+static void *batchWorker(void *arg)
+{
+    BatchJob *job = (BatchJob *)arg;
+    pthread_mutex_lock(&job->lock);
+    while (job->nextChunk < job->chunks)
+    {
+        if (job->nextChunk >= job->written + job->window)
+        {
+            pthread_cond_wait(&job->changed, &job->lock);
+            continue;
+        }
+        size_t chunk = job->nextChunk++;
+        BatchSlot *slot = &job->slots[chunk % job->window];
+        pthread_mutex_unlock(&job->lock);
+
+        solveChunk(job, chunk, slot);
+
+        pthread_mutex_lock(&job->lock);
+        slot->done = true;
+        pthread_cond_broadcast(&job->changed);
+    }
+    pthread_mutex_unlock(&job->lock);
+    return NULL;
+}
+
+// Function to solve every puzzle of a file with 'threads' workers and write the
+// solutions, in order, to 'output'. Returns false if the file cannot be read or
+// the output cannot be written
+bool solveSudokuFile(const char *inputPath, FILE *output, int threads, int backend, SudokuBatchStats *stats)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    memset(stats, 0, sizeof(*stats));
+
+    int fd = open(inputPath, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    BatchJob job;
+    memset(&job, 0, sizeof(job));
+    job.size = (size_t)info.st_size;
+    job.backend = backend;
+    if (job.size > 0)
+    {
+        void *data = mmap(NULL, job.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            close(fd);
+            return false;
+        }
+        madvise(data, job.size, MADV_SEQUENTIAL);
+        job.data = (const char *)data;
+    }
+    close(fd);
+
+    if (threads < 1)
+        threads = 1;
+    sudokuKernelName(); // Settle the candidate kernel before the workers use it
+    job.chunks = (job.size + CHUNK_BYTES - 1) / CHUNK_BYTES;
+    job.window = (size_t)threads * WINDOW_PER_THREAD;
+    job.slots = (BatchSlot *)calloc(job.window, sizeof(BatchSlot));
+    pthread_t *workers = (pthread_t *)calloc(threads, sizeof(pthread_t));
+    bool ok = job.slots && workers;
+    for (size_t i = 0; ok && i < job.window; i++)
+    {
+        // A chunk holds at most one puzzle per 82 bytes, plus a last line cut short
+        job.slots[i].output = (char *)malloc((CHUNK_BYTES / LINE_LENGTH + 2) * LINE_LENGTH);
+        ok = job.slots[i].output != NULL;
+    }
+
+    int started = 0;
+    if (ok)
+    {
+        pthread_mutex_init(&job.lock, NULL);
+        pthread_cond_init(&job.changed, NULL);
+        for (; started < threads; started++)
+            if (pthread_create(&workers[started], NULL, batchWorker, &job) != 0)
+                break;
+
+        // Write the chunks out in order as they complete
+        for (size_t chunk = 0; chunk < job.chunks; chunk++)
+        {
+            BatchSlot *slot = &job.slots[chunk % job.window];
+            if (started == 0)
+            { // No threads could be started: solve on this one
+                solveChunk(&job, chunk, slot);
+                slot->done = true;
+            }
+            pthread_mutex_lock(&job.lock);
+            while (!slot->done)
+                pthread_cond_wait(&job.changed, &job.lock);
+            pthread_mutex_unlock(&job.lock);
+
+            if (ok && fwrite(slot->output, 1, slot->length, output) != slot->length)
+                ok = false; // Keep draining so the workers can finish
+            stats->puzzles += slot->puzzles;
+            stats->solved += slot->solved;
+
+            pthread_mutex_lock(&job.lock);
+            slot->done = false;
+            job.written++;
+            pthread_cond_broadcast(&job.changed);
+            pthread_mutex_unlock(&job.lock);
+        }
+
+        for (int i = 0; i < started; i++)
+            pthread_join(workers[i], NULL);
+        pthread_mutex_destroy(&job.lock);
+        pthread_cond_destroy(&job.changed);
+        if (fflush(output) != 0)
+            ok = false;
+    }
+
+    for (size_t i = 0; job.slots && i < job.window; i++)
+        free(job.slots[i].output);
+    free(job.slots);
+    free(workers);
+    if (job.size > 0)
+        munmap((void *)job.data, job.size);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    stats->seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    return ok;
+}
@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sudoku_solver.h"
+
+// Benchmark of the solver backends on the same puzzles, from easy to ones built to
+// defeat cell-order backtracking.
+//
+// Usage: sudoku_bench [--kernel auto|scalar|sse|avx2] [backend ...]   (default: bitmask dlx backtracking)
+// Each backend solves each puzzle repeatedly for at least MIN_SECONDS (once for
+// puzzles that take longer) and the mean time per solve is printed.
+
+#define MIN_SECONDS 0.2
+
+static const struct
+{
+    const char *name;
+    const char *puzzle;
+} puzzles[] = {
+    {"easy", "...26.7.168..7..9.19...45..82.1...4...46.29...5...3.28..93...74.4..5..367.3.18..."},
+    {"inkala", "8..........36......7..9.2...5...7.......457.....1...3...1....68..85...1..9....4.."},
+    {"norvig-hard", "4.....8.5.3..........7......2.....6.....8.4......1.......6.3.7.5..2.....1.4......"},
+    {"anti-backtracking", "..............3.85..1.2.......5.7.....4...1...9.......5......73..2.1........4...9"},
+};
+
+// Function to load an 81-character puzzle, '.' or '0' for empty cells
+static void loadGrid(int grid[N][N], const char *puzzle)
+{
+    for (int cell = 0; cell < N * N; cell++)
+        grid[cell / N][cell % N] = puzzle[cell] >= '1' && puzzle[cell] <= '9' ? puzzle[cell] - '0' : 0;
+}
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    static const char *const kernels[] = {"auto", "scalar", "sse", "avx2"};
+    int backends[SUDOKU_BACKEND_COUNT], backendCount = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--kernel") == 0 && i + 1 < argc)
+        {
+            int kernel = 0;
+            while (kernel < 4 && strcmp(argv[i + 1], kernels[kernel]) != 0)
+                kernel++;
+            if (kernel == 4 || !sudokuSetKernel(kernel))
+            {
+                fprintf(stderr, "Kernel %s is unknown or not supported by this CPU\n", argv[i + 1]);
+                return 1;
+            }
+            i++;
+            continue;
+        }
+        int backend = 0;
+        while (backend < SUDOKU_BACKEND_COUNT && strcmp(argv[i], sudokuBackendName(backend)) != 0)
+            backend++;
+        if (backend == SUDOKU_BACKEND_COUNT || backendCount == SUDOKU_BACKEND_COUNT)
+        {
+            fprintf(stderr, "Usage: %s [--kernel auto|scalar|sse|avx2] [bitmask|dlx|backtracking ...]\n", argv[0]);
+            return 1;
+        }
+        backends[backendCount++] = backend;
+    }
+    if (backendCount == 0)
+        for (backendCount = 0; backendCount < SUDOKU_BACKEND_COUNT; backendCount++)
+            backends[backendCount] = backendCount;
+
+    printf("Candidate kernel: %s\n", sudokuKernelName());
+    printf("%-18s %10s", "puzzle", "solutions");
+    for (int b = 0; b < backendCount; b++)
+        printf(" %14s", sudokuBackendName(backends[b]));
+    printf("\n");
+
+    for (size_t p = 0; p < sizeof(puzzles) / sizeof(puzzles[0]); p++)
+    {
+        int grid[N][N], reference[N][N];
+        loadGrid(grid, puzzles[p].puzzle);
+        printf("%-18s %10d", puzzles[p].name, countSudokuSolutions(grid, 0));
+        fflush(stdout);
+
+        for (int b = 0; b < backendCount; b++)
+        {
+            long runs = 0;
+            double start = now(), elapsed;
+            do
+            {
+                loadGrid(grid, puzzles[p].puzzle);
+                if (!solveSudokuWith(grid, backends[b]))
+                {
+                    printf(" %14s", "unsolved");
+                    break;
+                }
+                runs++;
+                elapsed = now() - start;
+            } while (elapsed < MIN_SECONDS);
+            if (runs == 0)
+                continue;
+
+            // Every backend must find the same (unique) solution
+            if (b == 0)
+                memcpy(reference, grid, sizeof(grid));
+            else if (memcmp(reference, grid, sizeof(grid)) != 0)
+            {
+                printf("\nBackend %s disagrees on %s\n", sudokuBackendName(backends[b]), puzzles[p].name);
+                return 1;
+            }
+            double perSolve = elapsed / runs;
+            if (perSolve < 1e-3)
+                printf(" %11.1f us", perSolve * 1e6);
+            else if (perSolve < 1)
+                printf(" %11.2f ms", perSolve * 1e3);
+            else
+                printf(" %12.2f s", perSolve);
+            fflush(stdout);
+        }
+        printf("\n");
+    }
+    return 0;
+}
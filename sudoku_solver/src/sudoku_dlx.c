@@ -0,0 +1,194 @@
+#include <limits.h>
+#include <string.h>
+#include "sudoku_solver.h"
+
+// Sudoku as exact cover, solved with Knuth's Algorithm X on Dancing Links.
+//
+// Each of the 729 candidate placements (cell, digit) is a row covering four of
+// the 324 constraints: the cell is filled, and the digit appears once in its
+// row, its column and its box. A solution is a set of rows covering every
+// constraint exactly once. The matrix lives in one fixed-size arena of nodes
+// linked by 16-bit indices on the caller's stack, built once per call, so the
+// search never allocates.
+
+#define DLX_CELLS (N * N)
+#define DLX_COLUMNS (4 * DLX_CELLS) // Cell, row-digit, column-digit and box-digit constraints
+#define DLX_ROWS (DLX_CELLS * N)    // One per (cell, digit)
+#define DLX_NODES (1 + DLX_COLUMNS + 4 * DLX_ROWS)
+
+typedef struct
+{
+    unsigned short left, right, up, down;
+    unsigned short column; // Header node of the node's column
+    unsigned short row;    // Placement: cell * N + digit - 1
+} DlxNode;
+
+typedef struct
+{
+    DlxNode nodes[DLX_NODES]; // Node 0 is the root, then the column headers, then the rows
+    unsigned short size[1 + DLX_COLUMNS];
+    unsigned char covered[1 + DLX_COLUMNS];
+    unsigned short chosen[DLX_CELLS];
+    int depth;
+    int count, limit;
+    unsigned short first[DLX_CELLS]; // Rows of the first solution found
+    int firstDepth;
+} DlxMatrix;
+
+// Function to link every placement row under its four constraint columns
+static void buildMatrix(DlxMatrix *m)
+{
+    for (int c = 0; c <= DLX_COLUMNS; c++)
+    {
+        m->nodes[c].left = (unsigned short)(c == 0 ? DLX_COLUMNS : c - 1);
+        m->nodes[c].right = (unsigned short)(c == DLX_COLUMNS ? 0 : c + 1);
+        m->nodes[c].up = m->nodes[c].down = m->nodes[c].column = (unsigned short)c;
+        m->size[c] = 0;
+        m->covered[c] = 0;
+    }
+
+    int next = 1 + DLX_COLUMNS;
+    for (int row = 0; row < DLX_ROWS; row++)
+    {
+        int cell = row / N, digit = row % N, r = cell / N, c = cell % N, box = r / 3 * 3 + c / 3;
+        int columns[4] = {1 + cell, 1 + DLX_CELLS + r * N + digit, 1 + 2 * DLX_CELLS + c * N + digit,
+                          1 + 3 * DLX_CELLS + box * N + digit};
+        for (int k = 0; k < 4; k++)
+        {
+            DlxNode *node = &m->nodes[next + k];
+            int column = columns[k];
+            node->left = (unsigned short)(next + (k + 3) % 4);
+            node->right = (unsigned short)(next + (k + 1) % 4);
+            node->column = (unsigned short)column;
+            node->row = (unsigned short)row;
+            node->up = m->nodes[column].up;
+            node->down = (unsigned short)column;
+            m->nodes[m->nodes[column].up].down = (unsigned short)(next + k);
+            m->nodes[column].up = (unsigned short)(next + k);
+            m->size[column]++;
+        }
+        next += 4;
+    }
+}
+
+// Function to remove a column and every row that covers it
+static void cover(DlxMatrix *m, int column)
+{
+    DlxNode *nodes = m->nodes;
+    nodes[nodes[column].right].left = nodes[column].left;
+    nodes[nodes[column].left].right = nodes[column].right;
+    m->covered[column] = 1;
+    for (int i = nodes[column].down; i != column; i = nodes[i].down)
+        for (int j = nodes[i].right; j != i; j = nodes[j].right)
+        {
+            nodes[nodes[j].down].up = nodes[j].up;
+            nodes[nodes[j].up].down = nodes[j].down;
+            m->size[nodes[j].column]--;
+        }
+}
+
+// Function to undo cover(), in exactly the reverse order
+static void uncover(DlxMatrix *m, int column)
+{
+    DlxNode *nodes = m->nodes;
+    for (int i = nodes[column].up; i != column; i = nodes[i].up)
+        for (int j = nodes[i].left; j != i; j = nodes[j].left)
+        {
+            m->size[nodes[j].column]++;
+            nodes[nodes[j].down].up = (unsigned short)j;
+            nodes[nodes[j].up].down = (unsigned short)j;
+        }
+    m->covered[column] = 0;
+    nodes[nodes[column].right].left = (unsigned short)column;
+    nodes[nodes[column].left].right = (unsigned short)column;
+}
+
+// Recursive Algorithm X, branching on the column with the fewest rows left.
+// Returns true once 'limit' solutions are found; the matrix is then left as is
+static bool searchCover(DlxMatrix *m)
+{
+    DlxNode *nodes = m->nodes;
+    if (nodes[0].right == 0)
+    {
+        if (m->count++ == 0)
+        {
+            memcpy(m->first, m->chosen, m->depth * sizeof(m->chosen[0]));
+            m->firstDepth = m->depth;
+        }
+        return m->count >= m->limit;
+    }
+
+    int column = nodes[0].right;
+    for (int c = nodes[column].right; c != 0 && m->size[column] > 1; c = nodes[c].right)
+        if (m->size[c] < m->size[column])
+            column = c;
+    if (m->size[column] == 0)
+        return false;
+
+    cover(m, column);
+    for (int r = nodes[column].down; r != column; r = nodes[r].down)
+    {
+        m->chosen[m->depth++] = nodes[r].row;
+        for (int j = nodes[r].right; j != r; j = nodes[j].right)
+            cover(m, nodes[j].column);
+        if (searchCover(m))
+            return true;
+        for (int j = nodes[r].left; j != r; j = nodes[j].left)
+            uncover(m, nodes[j].column);
+        m->depth--;
+    }
+    uncover(m, column);
+    return false;
+}
+
+// Function to run the search on a grid, stopping at 'limit' solutions.
+// Returns the number of solutions found, or -1 if the givens are invalid
+static int runCover(DlxMatrix *m, int grid[N][N], int limit)
+{
+    buildMatrix(m);
+    m->depth = 0;
+    m->count = 0;
+    m->limit = limit;
+
+    // Givens are chosen up front; one whose constraints are already taken clashes
+    for (int cell = 0; cell < DLX_CELLS; cell++)
+    {
+        int digit = grid[cell / N][cell % N];
+        if (digit < 0 || digit > N)
+            return -1;
+        if (digit == 0)
+            continue;
+        int first = 1 + DLX_COLUMNS + 4 * (cell * N + digit - 1);
+        for (int k = 0; k < 4; k++)
+            if (m->covered[m->nodes[first + k].column])
+                return -1;
+        for (int k = 0; k < 4; k++)
+            cover(m, m->nodes[first + k].column);
+    }
+
+    searchCover(m);
+    return m->count;
+}
+
+// Function to solve the Sudoku puzzle as an exact cover problem with Dancing Links.
+// Leaves the grid untouched if it has no solution
+bool solveSudokuDlx(int grid[N][N])
+{
+    DlxMatrix m;
+    if (runCover(&m, grid, 1) <= 0)
+        return false;
+    for (int i = 0; i < m.firstDepth; i++)
+    {
+        int cell = m.first[i] / N;
+        grid[cell / N][cell % N] = m.first[i] % N + 1;
+    }
+    return true;
+}
+
+// Function to count the solutions of a puzzle, stopping at 'limit' (0 for no limit).
+// Returns -1 if the givens clash; a proper puzzle has exactly one solution
+int countSudokuSolutions(int grid[N][N], int limit)
+{
+    DlxMatrix m;
+    return runCover(&m, grid, limit > 0 ? limit : INT_MAX);
+}
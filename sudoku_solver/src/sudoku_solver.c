@@ -1,46 +1,372 @@
 #include <stdio.h>
-#include <stdbool.h>
-
-#define N 9
-#define ANSI_COLOR_RED "\x1b[91m"
-#define ANSI_COLOR_GREEN "\x1b[92m"
-#define ANSI_COLOR_BLUE "\x1b[96m"
-#define ANSI_COLOR_YELLOW "\x1b[93m"
-#define ANSI_COLOR_MAGENTA "\x1b[95m"
-#define ANSI_COLOR_RESET "\x1b[0m"
-
-// Function prototypes
-bool isSafe(int grid[N][N], int row, int col, int num);
-bool solveSudoku(int grid[N][N]);
-bool findEmptyLocation(int grid[N][N], int *row, int *col);
-void printGrid(int grid[N][N]);
-
-// Main function to test the solver
-int main()
-{
-    int grid[N][N] = {
-        {0, 0, 0, 2, 6, 0, 7, 0, 1},
-        {6, 8, 0, 0, 7, 0, 0, 9, 0},
-        {1, 9, 0, 0, 0, 4, 5, 0, 0},
-        {8, 2, 0, 1, 0, 0, 0, 4, 0},
-        {0, 0, 4, 6, 0, 2, 9, 0, 0},
-        {0, 5, 0, 0, 0, 3, 0, 2, 8},
-        {0, 0, 9, 3, 0, 0, 0, 7, 4},
-        {0, 4, 0, 0, 5, 0, 0, 3, 6},
-        {7, 0, 3, 0, 1, 8, 0, 0, 0}};
-
-    printf(ANSI_COLOR_YELLOW "\nUnsolved Sudoku:" ANSI_COLOR_RESET);
-    printGrid(grid);
-
-    if (solveSudoku(grid) == true)
+#include <stdint.h>
+#include "sudoku_solver.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SUDOKU_HAVE_X86 1
+#endif
+
+#define ALL_DIGITS 0x1FF // Candidate mask: bit d - 1 set if digit d may go in a cell
+#define CELLS (N * N)
+#define UNITS (3 * N)    // Rows, then columns, then boxes
+#define LANES 16         // uint16 lanes per grid row: 9 cells and 7 of padding, one AVX2 register
+
+// State of the fast solver: the digit in each cell, the digits each unit already holds,
+// and the open cells as a grid of 16-bit masks laid out for the candidate kernels
+typedef struct
+{
+    uint16_t open[N][LANES];    // ALL_DIGITS for an empty cell, 0 for a filled one or padding
+    unsigned char cells[CELLS]; // 0 for empty
+    unsigned short used[UNITS];
+    int empty;
+} SudokuState;
+
+static int activeKernel = SUDOKU_KERNEL_AUTO;
+
+// Cells of each unit
+static const unsigned char unitCells[UNITS][N] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8},
+    {9, 10, 11, 12, 13, 14, 15, 16, 17},
+    {18, 19, 20, 21, 22, 23, 24, 25, 26},
+    {27, 28, 29, 30, 31, 32, 33, 34, 35},
+    {36, 37, 38, 39, 40, 41, 42, 43, 44},
+    {45, 46, 47, 48, 49, 50, 51, 52, 53},
+    {54, 55, 56, 57, 58, 59, 60, 61, 62},
+    {63, 64, 65, 66, 67, 68, 69, 70, 71},
+    {72, 73, 74, 75, 76, 77, 78, 79, 80},
+    {0, 9, 18, 27, 36, 45, 54, 63, 72},
+    {1, 10, 19, 28, 37, 46, 55, 64, 73},
+    {2, 11, 20, 29, 38, 47, 56, 65, 74},
+    {3, 12, 21, 30, 39, 48, 57, 66, 75},
+    {4, 13, 22, 31, 40, 49, 58, 67, 76},
+    {5, 14, 23, 32, 41, 50, 59, 68, 77},
+    {6, 15, 24, 33, 42, 51, 60, 69, 78},
+    {7, 16, 25, 34, 43, 52, 61, 70, 79},
+    {8, 17, 26, 35, 44, 53, 62, 71, 80},
+    {0, 1, 2, 9, 10, 11, 18, 19, 20},
+    {3, 4, 5, 12, 13, 14, 21, 22, 23},
+    {6, 7, 8, 15, 16, 17, 24, 25, 26},
+    {27, 28, 29, 36, 37, 38, 45, 46, 47},
+    {30, 31, 32, 39, 40, 41, 48, 49, 50},
+    {33, 34, 35, 42, 43, 44, 51, 52, 53},
+    {54, 55, 56, 63, 64, 65, 72, 73, 74},
+    {57, 58, 59, 66, 67, 68, 75, 76, 77},
+    {60, 61, 62, 69, 70, 71, 78, 79, 80},
+};
+
+// Function to find the units (row, column, box) a cell belongs to
+static void cellUnits(int cell, int units[3])
+{
+    int row = cell / N, col = cell % N;
+    units[0] = row;
+    units[1] = N + col;
+    units[2] = 2 * N + row / 3 * 3 + col / 3;
+}
+
+/* ---- Candidate kernels: the candidates of every cell from the unit masks ---- */
+
+// One cell at a time
+static void candidatesScalar(const SudokuState *state, uint16_t cand[N][LANES])
+{
+    for (int row = 0; row < N; row++)
+        for (int col = 0; col < N; col++)
+            cand[row][col] = state->open[row][col] &
+                             ~(state->used[row] | state->used[N + col] | state->used[2 * N + row / 3 * 3 + col / 3]);
+}
+
+#ifdef SUDOKU_HAVE_X86
+
+// Function to spread the column masks, and each band's box masks, over the lanes of a row
+static void laneMasks(const SudokuState *state, uint16_t columns[LANES], uint16_t boxes[3][LANES])
+{
+    for (int lane = 0; lane < LANES; lane++)
+    {
+        columns[lane] = lane < N ? state->used[N + lane] : 0;
+        for (int band = 0; band < 3; band++)
+            boxes[band][lane] = lane < N ? state->used[2 * N + band * 3 + lane / 3] : 0;
+    }
+}
+
+// A whole row per instruction: row mask broadcast, OR the column and box lanes, clear from the open cells
+__attribute__((target("avx2"))) static void candidatesAvx2(const SudokuState *state, uint16_t cand[N][LANES])
+{
+    uint16_t columns[LANES], boxes[3][LANES];
+    laneMasks(state, columns, boxes);
+    __m256i columnMask = _mm256_loadu_si256((const __m256i *)columns);
+    for (int band = 0; band < 3; band++)
+    {
+        __m256i fixed = _mm256_or_si256(columnMask, _mm256_loadu_si256((const __m256i *)boxes[band]));
+        for (int row = band * 3; row < band * 3 + 3; row++)
+        {
+            __m256i taken = _mm256_or_si256(fixed, _mm256_set1_epi16((short)state->used[row]));
+            __m256i open = _mm256_loadu_si256((const __m256i *)state->open[row]);
+            _mm256_storeu_si256((__m256i *)cand[row], _mm256_andnot_si256(taken, open));
+        }
+    }
+}
+
+// The same on two 8-lane halves per row
+__attribute__((target("sse2"))) static void candidatesSse(const SudokuState *state, uint16_t cand[N][LANES])
+{
+    uint16_t columns[LANES], boxes[3][LANES];
+    laneMasks(state, columns, boxes);
+    for (int half = 0; half < LANES; half += 8)
+    {
+        __m128i columnMask = _mm_loadu_si128((const __m128i *)(columns + half));
+        for (int band = 0; band < 3; band++)
+        {
+            __m128i fixed = _mm_or_si128(columnMask, _mm_loadu_si128((const __m128i *)(boxes[band] + half)));
+            for (int row = band * 3; row < band * 3 + 3; row++)
+            {
+                __m128i taken = _mm_or_si128(fixed, _mm_set1_epi16((short)state->used[row]));
+                __m128i open = _mm_loadu_si128((const __m128i *)(state->open[row] + half));
+                _mm_storeu_si128((__m128i *)(cand[row] + half), _mm_andnot_si128(taken, open));
+            }
+        }
+    }
+}
+
+#endif // SUDOKU_HAVE_X86
+
+// Function to check whether this CPU can run a kernel
+static bool kernelSupported(int kernel)
+{
+    if (kernel == SUDOKU_KERNEL_SCALAR)
+        return true;
+#ifdef SUDOKU_HAVE_X86
+    __builtin_cpu_init();
+    if (kernel == SUDOKU_KERNEL_AVX2)
+        return __builtin_cpu_supports("avx2");
+    if (kernel == SUDOKU_KERNEL_SSE)
+        return __builtin_cpu_supports("sse2");
+#endif
+    return false;
+}
+
+// Function to select the candidate kernel (SUDOKU_KERNEL_*); AUTO picks the widest one
+// this CPU supports. Returns false if the CPU cannot run the one asked for
+bool sudokuSetKernel(int kernel)
+{
+    if (kernel == SUDOKU_KERNEL_AUTO)
+    {
+        activeKernel = kernelSupported(SUDOKU_KERNEL_AVX2)  ? SUDOKU_KERNEL_AVX2
+                       : kernelSupported(SUDOKU_KERNEL_SSE) ? SUDOKU_KERNEL_SSE
+                                                            : SUDOKU_KERNEL_SCALAR;
+        return true;
+    }
+    if (!kernelSupported(kernel))
+        return false;
+    activeKernel = kernel;
+    return true;
+}
+
+// Function to get the kernel in use, resolving the default on first use
+static int currentKernel()
+{
+    if (activeKernel == SUDOKU_KERNEL_AUTO)
+        sudokuSetKernel(SUDOKU_KERNEL_AUTO);
+    return activeKernel;
+}
+
+// Function to name the kernel in use, for reports
+const char *sudokuKernelName()
+{
+    switch (currentKernel())
+    {
+    case SUDOKU_KERNEL_AVX2:
+        return "avx2";
+    case SUDOKU_KERNEL_SSE:
+        return "sse";
+    default:
+        return "scalar";
+    }
+}
+
+// Function to compute the candidates of every cell with the selected kernel
+static void computeCandidates(const SudokuState *state, uint16_t cand[N][LANES])
+{
+    switch (currentKernel())
     {
-        printf(ANSI_COLOR_YELLOW "\nSolved Sudoku:" ANSI_COLOR_RESET);
-        printGrid(grid);
+#ifdef SUDOKU_HAVE_X86
+    case SUDOKU_KERNEL_AVX2:
+        candidatesAvx2(state, cand);
+        break;
+    case SUDOKU_KERNEL_SSE:
+        candidatesSse(state, cand);
+        break;
+#endif
+    default:
+        candidatesScalar(state, cand);
     }
-    else
-        printf(ANSI_COLOR_RED "No solution exists\n" ANSI_COLOR_RESET);
+}
 
-    return 0;
+/* ---- Search ---- */
+
+// Function to put a digit in an empty cell; returns false if a unit of the cell already holds it
+static bool place(SudokuState *state, int cell, int digit)
+{
+    int units[3];
+    unsigned bit = 1u << (digit - 1);
+    cellUnits(cell, units);
+    if ((state->used[units[0]] | state->used[units[1]] | state->used[units[2]]) & bit)
+        return false;
+    state->cells[cell] = (unsigned char)digit;
+    state->open[cell / N][cell % N] = 0;
+    state->used[units[0]] |= bit;
+    state->used[units[1]] |= bit;
+    state->used[units[2]] |= bit;
+    state->empty--;
+    return true;
+}
+
+// Function to fill in every forced digit: cells with a single candidate (naked singles)
+// and digits with a single possible cell in a unit (hidden singles). Leaves the
+// candidates of the final grid in 'cand'.
+// Returns false if the grid turns out to have no solution
+static bool propagate(SudokuState *state, uint16_t cand[N][LANES])
+{
+    while (state->empty > 0)
+    {
+        computeCandidates(state, cand);
+
+        // Naked singles; a cell left without candidates is a dead end
+        bool placed = false;
+        for (int cell = 0; cell < CELLS; cell++)
+        {
+            if (state->cells[cell])
+                continue;
+            unsigned mask = cand[cell / N][cell % N];
+            if (mask == 0)
+                return false;
+            if ((mask & (mask - 1)) == 0)
+            {
+                if (!place(state, cell, __builtin_ctz(mask) + 1))
+                    return false; // Another single in the same unit took the digit
+                placed = true;
+            }
+        }
+        if (placed)
+            continue;
+
+        // Hidden singles: digits that are candidates in exactly one cell of a unit
+        for (int unit = 0; unit < UNITS; unit++)
+        {
+            unsigned once = 0, twice = 0;
+            for (int k = 0; k < N; k++)
+            {
+                int cell = unitCells[unit][k];
+                unsigned mask = cand[cell / N][cell % N];
+                twice |= once & mask;
+                once |= mask;
+            }
+            if ((once | state->used[unit]) != ALL_DIGITS)
+                return false; // Some digit has nowhere left to go
+            for (unsigned singles = once & ~twice & ~state->used[unit]; singles; singles &= singles - 1)
+            {
+                int digit = __builtin_ctz(singles) + 1;
+                int k = 0;
+                while (!(cand[unitCells[unit][k] / N][unitCells[unit][k] % N] & (1u << (digit - 1))))
+                    k++;
+                int cell = unitCells[unit][k];
+                if (state->cells[cell] == digit)
+                    continue; // Placed for another unit already
+                if (state->cells[cell] || !place(state, cell, digit))
+                    return false;
+                placed = true;
+            }
+        }
+        if (!placed)
+            return true;
+    }
+    return true;
+}
+
+// Recursive search: propagate, then branch on the empty cell with the fewest candidates
+static bool search(SudokuState *state)
+{
+    uint16_t cand[N][LANES];
+    if (!propagate(state, cand))
+        return false;
+    if (state->empty == 0)
+        return true;
+
+    int best = -1, fewest = N + 1;
+    for (int cell = 0; cell < CELLS && fewest > 2; cell++)
+    {
+        if (state->cells[cell])
+            continue;
+        int count = __builtin_popcount(cand[cell / N][cell % N]);
+        if (count < fewest)
+        {
+            fewest = count;
+            best = cell;
+        }
+    }
+
+    for (unsigned mask = cand[best / N][best % N]; mask; mask &= mask - 1)
+    {
+        SudokuState next = *state;
+        if (place(&next, best, __builtin_ctz(mask) + 1) && search(&next))
+        {
+            *state = next;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Function to solve the Sudoku puzzle with candidate bitmasks: every row, column and box
+// keeps a mask of the digits it holds, and a vector kernel turns them into the
+// candidates of all 81 cells at once. Forced digits are filled in before each guess,
+// and guesses go to the cell with the fewest candidates. Leaves the grid untouched if
+// it has no solution
+bool solveSudoku(int grid[N][N])
+{
+    SudokuState state = {{{0}}, {0}, {0}, CELLS};
+    for (int row = 0; row < N; row++)
+        for (int col = 0; col < N; col++)
+            state.open[row][col] = ALL_DIGITS;
+    for (int row = 0; row < N; row++)
+    {
+        for (int col = 0; col < N; col++)
+        {
+            int digit = grid[row][col];
+            if (digit < 0 || digit > N)
+                return false;
+            if (digit && !place(&state, row * N + col, digit))
+                return false; // The givens already clash
+        }
+    }
+
+    if (!search(&state))
+        return false;
+    for (int cell = 0; cell < CELLS; cell++)
+        grid[cell / N][cell % N] = state.cells[cell];
+    return true;
+}
+
+// Function to solve the Sudoku puzzle with the given backend (SUDOKU_BACKEND_*)
+bool solveSudokuWith(int grid[N][N], int backend)
+{
+    switch (backend)
+    {
+    case SUDOKU_BACKEND_BITMASK:
+        return solveSudoku(grid);
+    case SUDOKU_BACKEND_DLX:
+        return solveSudokuDlx(grid);
+    case SUDOKU_BACKEND_BACKTRACKING:
+        return solveSudokuBacktracking(grid);
+    default:
+        return false;
+    }
+}
+
+// Function to name a backend, for reports and command lines
+const char *sudokuBackendName(int backend)
+{
+    static const char *names[SUDOKU_BACKEND_COUNT] = {"bitmask", "dlx", "backtracking"};
+    return backend >= 0 && backend < SUDOKU_BACKEND_COUNT ? names[backend] : "unknown";
 }
 
 // Function to check if it's safe to place a number in a given cell
@@ -66,8 +392,9 @@ bool isSafe(int grid[N][N], int row, int col, int num)
     return true;
 }
 
-// Recursive backtracking function to solve the Sudoku puzzle
-bool solveSudoku(int grid[N][N])
+// Recursive backtracking function to solve the Sudoku puzzle, trying 1 to 9 in the
+// first empty cell; kept as the reference the fast solver is checked against
+bool solveSudokuBacktracking(int grid[N][N])
 {
     int row, col;
 
@@ -83,7 +410,7 @@ bool solveSudoku(int grid[N][N])
             grid[row][col] = num;
 
             // Recursively attempt to solve the rest of the grid
-            if (solveSudoku(grid))
+            if (solveSudokuBacktracking(grid))
                 return true;
 
             // If placing num doesn't lead to a solution, backtrack
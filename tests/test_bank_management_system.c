@@ -1,5 +1,12 @@
 #include <stdio.h>
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
 #include "../include/bank_management_system.h"
 
 void test_createAccount()
@@ -30,8 +37,1115 @@ void test_checkBalance()
     checkBalance();
 }
 
+#define TEST_DB "test_accounts.dat"
+#define TEST_INDEX TEST_DB ".idx"
+#define TEST_WAL TEST_DB ".wal"
+
+static long fileSize(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return -1;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    return size;
+}
+
+static void copyFile(const char *from, const char *to)
+{
+    char buffer[4096];
+    size_t n;
+    FILE *in = fopen(from, "rb");
+    FILE *out = fopen(to, "wb");
+    while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0)
+        fwrite(buffer, 1, n, out);
+    fclose(in);
+    fclose(out);
+}
+
+void test_indexedLookup()
+{
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    assert(bankOpen(TEST_DB));
+
+    // Enough accounts to force the index to grow past its initial size
+    size_t previous = bankSetGroupCommit(1000);
+    for (int i = 0; i < 5000; i++)
+    {
+        Account account = {"user", 100000 + i * 7, 0, 0};
+        assert(isUniqueAccountNumber(account.accountNumber));
+        saveAccount(account);
+    }
+    assert(bankCommit());
+    bankSetGroupCommit(previous);
+    assert(storeRecordCount() == 5000);
+    assert(!isUniqueAccountNumber(100000 + 4999 * 7));
+    assert(isUniqueAccountNumber(100001));
+
+    // Updates happen in place instead of appending a second record
+    Account *account = getAccountByNumber(100000 + 1234 * 7);
+    assert(account != NULL);
+    account->balance = 25000;
+    saveAccount(*account);
+    free(account);
+    assert(storeRecordCount() == 5000);
+
+    // The index is persistent and is reused on reopen
+    bankClose();
+    assert(bankOpen(TEST_DB));
+    account = getAccountByNumber(100000 + 1234 * 7);
+    assert(account != NULL && account->balance == 25000);
+    free(account);
+    assert(getAccountByNumber(42) == NULL);
+    bankClose();
+}
+
+void test_staleIndexRebuild()
+{
+    // Append a record behind the index's back; the next open must notice
+    FILE *file = fopen(TEST_DB, "ab");
+    Account extra = {"late", 7, 0, 1250};
+    fwrite(&extra, sizeof(Account), 1, file);
+    fclose(file);
+
+    assert(bankOpen(TEST_DB));
+    Account *account = getAccountByNumber(7);
+    assert(account != NULL && strcmp(account->username, "late") == 0);
+    free(account);
+    assert(!isUniqueAccountNumber(100000));
+    bankClose();
+
+    // A corrupted index file is rebuilt as well
+    file = fopen(TEST_INDEX, "r+b");
+    fwrite("garbage!", 8, 1, file);
+    fclose(file);
+    assert(bankOpen(TEST_DB));
+    assert(!isUniqueAccountNumber(7));
+    bankClose();
+
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    remove(TEST_WAL);
+}
+
+void test_mmapBackend()
+{
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    storeSetBackend(STORE_BACKEND_MMAP);
+    assert(bankOpen(TEST_DB));
+
+    // Crosses a mapping chunk boundary, so the mapping has to grow
+    size_t previous = bankSetGroupCommit(1000);
+    for (int i = 0; i < 20000; i++)
+    {
+        Account account = {"mapped", i + 1, 0, 100};
+        saveAccount(account);
+    }
+    bankSetGroupCommit(previous);
+    Account *account = getAccountByNumber(19999);
+    assert(account != NULL);
+    account->balance = 9950;
+    saveAccount(*account);
+    free(account);
+    assert(storeSync());
+    bankClose();
+
+    // Chunk padding is trimmed on close, so the stdio engine reads the same file
+    assert(fileSize(TEST_DB) == 64 + 20000 * (long)sizeof(Account));
+
+    storeSetBackend(STORE_BACKEND_STDIO);
+    assert(bankOpen(TEST_DB));
+    account = getAccountByNumber(19999);
+    assert(account != NULL && account->balance == 9950);
+    free(account);
+    assert(storeRecordCount() == 20000);
+    bankClose();
+
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    remove(TEST_WAL);
+}
+
+void test_batchIngestion()
+{
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    assert(bankOpen(TEST_DB));
+    Account first = {"first", 1, 0, 0};
+    Account second = {"second", 2, 0, 500};
+    saveAccount(first);
+    saveAccount(second);
+
+    FILE *file = fopen("test_batch.csv", "w");
+    fprintf(file, "# op,account,amount\n");
+    fprintf(file, "D,2,10\nD,1,100\nW,1,30.5\nW,2,50\nB,1\nD,3,1\nD,1,-4\nX,1,1\nnonsense\n");
+    fclose(file);
+
+    assert(runBatch("test_batch.csv", "test_batch_results.csv"));
+    Account *account = getAccountByNumber(1);
+    assert(account->balance == 6950);
+    free(account);
+    account = getAccountByNumber(2);
+    assert(account->balance == 1500);
+    free(account);
+
+    // Results come back in input order with one status per transaction
+    const char *expected[] = {"line,op,account,amount,status,balance",
+                              "1,D,2,10.00,OK,15.00",
+                              "2,D,1,100.00,OK,100.00",
+                              "3,W,1,30.50,OK,69.50",
+                              "4,W,2,50.00,INSUFFICIENT_FUNDS,15.00",
+                              "5,B,1,0.00,OK,69.50",
+                              "6,D,3,1.00,NOT_FOUND,0.00",
+                              "7,D,1,-4.00,INVALID_AMOUNT,69.50",
+                              "8,X,1,1.00,BAD_OP,69.50",
+                              "9,?,0,0.00,BAD_LINE,0.00"};
+    char line[128];
+    file = fopen("test_batch_results.csv", "r");
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++)
+    {
+        assert(fgets(line, sizeof(line), file));
+        line[strcspn(line, "\n")] = '\0';
+        assert(strcmp(line, expected[i]) == 0);
+    }
+    assert(!fgets(line, sizeof(line), file));
+    fclose(file);
+
+    // Binary input: magic followed by packed records with amounts in cents
+    struct
+    {
+        int64_t amount;
+        int accountNumber;
+        char op;
+        char reserved[3];
+    } records[] = {{500, 2, 'W', {0}}, {50, 1, 'D', {0}}, {INT64_MAX, 1, 'D', {0}}}; // The last would overflow
+    file = fopen("test_batch.bin", "wb");
+    fwrite("BANKTXN2", 8, 1, file);
+    fwrite(records, sizeof(records), 1, file);
+    fclose(file);
+
+    assert(runBatch("test_batch.bin", "test_batch_results.csv"));
+    account = getAccountByNumber(1);
+    assert(account->balance == 7000);
+    free(account);
+    account = getAccountByNumber(2);
+    assert(account->balance == 1000);
+    free(account);
+
+    // Files in the older float layout are rounded to the nearest cent
+    struct
+    {
+        int accountNumber;
+        float amount;
+        char op;
+        char reserved[3];
+    } legacy[] = {{1, 0.1f, 'D', {0}}, {2, 0.29f, 'W', {0}}};
+    file = fopen("test_batch.bin", "wb");
+    fwrite("BANKTXN1", 8, 1, file);
+    fwrite(legacy, sizeof(legacy), 1, file);
+    fclose(file);
+
+    assert(runBatch("test_batch.bin", "test_batch_results.csv"));
+    account = getAccountByNumber(1);
+    assert(account->balance == 7010);
+    free(account);
+    account = getAccountByNumber(2);
+    assert(account->balance == 971);
+    free(account);
+    bankClose();
+
+    remove("test_batch.csv");
+    remove("test_batch.bin");
+    remove("test_batch_results.csv");
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    remove(TEST_WAL);
+}
+
+void test_walRecovery()
+{
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    remove(TEST_WAL);
+
+    // Commit an update to the log, then "crash" before it is checkpointed by
+    // copying the log aside and restoring it after the clean shutdown.
+    assert(storeOpen("test_scratch.dat"));
+    assert(walOpen(TEST_WAL));
+    Account logged = {"logged", 31, 0, 7700};
+    assert(walAppend(0, &logged));
+    assert(walCommit());
+    copyFile(TEST_WAL, "test_saved.wal");
+    walClose();
+    storeClose();
+    remove("test_scratch.dat");
+    remove(TEST_WAL);
+    rename("test_saved.wal", TEST_WAL);
+
+    // A torn entry at the tail of the log must be ignored
+    FILE *file = fopen(TEST_WAL, "ab");
+    fwrite("torn entry", 10, 1, file);
+    fclose(file);
+
+    assert(bankOpen(TEST_DB));
+    Account *account = getAccountByNumber(31);
+    assert(account != NULL && account->balance == 7700);
+    free(account);
+    assert(storeRecordCount() == 1);
+    assert(fileSize(TEST_WAL) == 0);
+
+    // Grouped updates are visible before their commit and durable after it
+    size_t previous = bankSetGroupCommit(8);
+    for (int i = 0; i < 5; i++)
+    {
+        account = getAccountByNumber(31);
+        account->balance += 100;
+        saveAccount(*account);
+        free(account);
+    }
+    assert(walPendingCount() == 5);
+    account = getAccountByNumber(31);
+    assert(account->balance == 8200);
+    free(account);
+    assert(bankCommit());
+    assert(walPendingCount() == 0);
+    assert(fileSize(TEST_WAL) > 0);
+    bankSetGroupCommit(previous);
+    bankClose();
+
+    assert(bankOpen(TEST_DB));
+    account = getAccountByNumber(31);
+    assert(account->balance == 8200);
+    free(account);
+    bankClose();
+
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    remove(TEST_WAL);
+}
+
+static void *depositAndTransfer(void *arg)
+{
+    int direction = *(int *)arg;
+    for (int i = 0; i < 200; i++)
+    {
+        assert(engineDeposit(1, 100, NULL) == BANK_OK);
+        if (direction)
+            engineTransfer(2, 3, 200);
+        else
+            engineTransfer(3, 2, 200);
+    }
+    return NULL;
+}
+
+void test_concurrentEngine()
+{
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    remove(TEST_WAL);
+    assert(bankOpen(TEST_DB));
+    assert(engineCreate("hot", 1) == BANK_OK);
+    assert(engineCreate("left", 2) == BANK_OK);
+    assert(engineCreate("right", 3) == BANK_OK);
+    assert(engineCreate("dup", 3) == BANK_DUPLICATE_ACCOUNT);
+    assert(engineDeposit(2, 50000, NULL) == BANK_OK);
+    assert(engineDeposit(3, 50000, NULL) == BANK_OK);
+    assert(engineWithdraw(2, 100000, NULL) == BANK_INSUFFICIENT_FUNDS);
+    assert(engineTransfer(2, 2, 100) == BANK_SAME_ACCOUNT);
+    assert(engineTransfer(2, 99, 100) == BANK_NOT_FOUND);
+
+    // Concurrent deposits on one account and opposite transfers between two
+    // others: no update may be lost and no money may appear or vanish.
+    pthread_t threads[4];
+    int directions[4] = {0, 1, 0, 1};
+    for (int i = 0; i < 4; i++)
+        pthread_create(&threads[i], NULL, depositAndTransfer, &directions[i]);
+    for (int i = 0; i < 4; i++)
+        pthread_join(threads[i], NULL);
+
+    money_t hot, left, right;
+    assert(engineBalance(1, &hot) == BANK_OK && hot == 80000);
+    assert(engineBalance(2, &left) == BANK_OK);
+    assert(engineBalance(3, &right) == BANK_OK);
+    assert(left + right == 100000);
+    bankClose();
+
+    assert(bankOpen(TEST_DB));
+    assert(engineBalance(1, &hot) == BANK_OK && hot == 80000);
+
+    // Changes that would take a balance past the range of money_t are refused
+    assert(engineDeposit(1, INT64_MAX, NULL) == BANK_INVALID_AMOUNT);
+    assert(engineDeposit(1, INT64_MAX - 80000, &hot) == BANK_OK && hot == INT64_MAX);
+    assert(engineTransfer(2, 1, 1) == BANK_INVALID_AMOUNT);
+    assert(engineBalance(1, &hot) == BANK_OK && hot == INT64_MAX);
+    assert(engineBalance(2, &left) == BANK_OK && left + right == 100000);
+    bankClose();
+
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    remove(TEST_WAL);
+}
+
+void test_moneyConversions()
+{
+    money_t amount;
+    char text[24];
+
+    assert(parseMoney("12", &amount) && amount == 1200);
+    assert(parseMoney("12.5", &amount) && amount == 1250);
+    assert(parseMoney(" -0.75 ", &amount) && amount == -75);
+    assert(parseMoney(".05", &amount) && amount == 5);
+    assert(!parseMoney("1.234", &amount));
+    assert(!parseMoney("12abc", &amount));
+    assert(!parseMoney("-", &amount));
+    assert(!parseMoney("99999999999999999999", &amount));
+
+    // Well past the point where a float stops representing cents
+    assert(parseMoney("16777216.01", &amount) && amount == 1677721601);
+    assert(strcmp(formatMoney(amount + 1, text, sizeof(text)), "16777216.02") == 0);
+    assert(strcmp(formatMoney(-5, text, sizeof(text)), "-0.05") == 0);
+    assert(strcmp(formatMoney(INT64_MIN, text, sizeof(text)), "-92233720368547758.08") == 0);
+}
+
+void test_legacyMigration()
+{
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    remove(TEST_WAL);
+
+    // Headerless file of the original 40-byte records with float balances
+    struct
+    {
+        char username[30];
+        int accountNumber;
+        float balance;
+    } legacy[] = {{"old", 5, 10.25f}, {"older", 6, 0.1f}};
+    FILE *file = fopen(TEST_DB, "wb");
+    fwrite(legacy, sizeof(legacy), 1, file);
+    fclose(file);
+
+    assert(bankOpen(TEST_DB));
+    Account *account = getAccountByNumber(5);
+    assert(account != NULL && account->balance == 1025 && strcmp(account->username, "old") == 0);
+    free(account);
+    account = getAccountByNumber(6);
+    assert(account != NULL && account->balance == 10);
+    free(account);
+    bankClose();
+    assert(fileSize(TEST_DB) == 64 + 2 * (long)sizeof(Account));
+
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    remove(TEST_WAL);
+}
+
+void test_accountColumns()
+{
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    remove(TEST_WAL);
+    assert(bankOpen(TEST_DB));
+
+    size_t previous = bankSetGroupCommit(1000);
+    for (int i = 0; i < 5000; i++)
+    {
+        Account account = {"column", 1000 + i, 0, (money_t)i * 100 + 1};
+        saveAccount(account);
+    }
+    bankSetGroupCommit(previous);
+
+    // Loading commits the pending group first
+    AccountColumns columns;
+    assert(columnsLoad(&columns));
+    assert(columns.count == 5000);
+    assert(columns.accountNumbers[4999] == 5999 && strcmp(columns.usernames[0], "column") == 0);
+    assert(columnsTotalBalance(&columns) == (money_t)4999 * 5000 / 2 * 100 + 5000);
+
+    // Only balances that changed are written back
+    money_t *before = (money_t *)malloc(columns.count * sizeof(money_t));
+    memcpy(before, columns.balances, columns.count * sizeof(money_t));
+    columns.balances[10] += 5;
+    columns.balances[4000] = 0;
+    assert(columnsStoreBalances(&columns, before));
+    free(before);
+    columnsFree(&columns);
+    bankClose();
+
+    assert(bankOpen(TEST_DB));
+    Account *account = getAccountByNumber(1010);
+    assert(account->balance == 1006);
+    free(account);
+    account = getAccountByNumber(5000);
+    assert(account->balance == 0);
+    free(account);
+    bankClose();
+
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    remove(TEST_WAL);
+}
+
+void test_bulkKernels()
+{
+    // Odd length so every vector kernel also runs its scalar tail
+    const size_t count = 10007;
+    money_t *reference = (money_t *)malloc(count * sizeof(money_t));
+    money_t *balances = (money_t *)malloc(count * sizeof(money_t));
+    uint64_t seed = 42;
+    for (size_t i = 0; i < count; i++)
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        reference[i] = (money_t)(seed >> 24) % 100000000000LL - 1000000;
+    }
+    reference[3] = 0;
+    reference[4] = INT64_MAX / 4;
+
+    uint32_t rate;
+    assert(bulkParseRate("1", &rate) && rate == 42949673u);
+    assert(bulkParseRate("0", &rate) && rate == 0);
+    assert(!bulkParseRate("100", &rate) && !bulkParseRate("-1", &rate) && !bulkParseRate("1x", &rate));
+    assert(bulkParseRate("2.5", &rate));
+
+    // Every kernel the CPU supports must match the scalar reference exactly
+    BulkStats expected, stats;
+    money_t expectedInterest, expectedFees;
+    money_t *expectedBalances = (money_t *)malloc(count * sizeof(money_t));
+    assert(bulkSetKernel(BULK_KERNEL_SCALAR));
+    bulkStats(reference, count, &expected);
+    memcpy(expectedBalances, reference, count * sizeof(money_t));
+    expectedInterest = bulkApplyInterest(expectedBalances, count, rate);
+    expectedFees = bulkApplyFee(expectedBalances, count, 250);
+    assert(expected.count == count && expected.minimum >= -1000000 && expected.maximum == INT64_MAX / 4);
+
+    int kernels[] = {BULK_KERNEL_SSE, BULK_KERNEL_AVX2};
+    for (int k = 0; k < 2; k++)
+    {
+        if (!bulkSetKernel(kernels[k]))
+            continue;
+        bulkStats(reference, count, &stats);
+        assert(memcmp(&stats, &expected, sizeof(stats)) == 0);
+        memcpy(balances, reference, count * sizeof(money_t));
+        assert(bulkApplyInterest(balances, count, rate) == expectedInterest);
+        assert(bulkApplyFee(balances, count, 250) == expectedFees);
+        assert(memcmp(balances, expectedBalances, count * sizeof(money_t)) == 0);
+    }
+    assert(bulkSetKernel(BULK_KERNEL_AUTO));
+
+    // Known values: 1% on 100.00, nothing on zero or negative balances,
+    // fees capped at the balance
+    money_t small[] = {10000, 0, -500, 150, 99};
+    assert(bulkParseRate("1", &rate));
+    assert(bulkApplyInterest(small, 5, rate) == 100 + 2 + 1);
+    assert(small[0] == 10100 && small[1] == 0 && small[2] == -500 && small[3] == 152 && small[4] == 100);
+    assert(bulkApplyFee(small, 5, 125) == 125 + 125 + 100);
+    assert(small[0] == 9975 && small[2] == -500 && small[3] == 27 && small[4] == 0);
+    bulkStats(small, 5, &stats);
+    assert(stats.total == 9975 - 500 + 27 && stats.minimum == -500 && stats.maximum == 9975);
+    assert(stats.histogram[0] == 4 && stats.histogram[2] == 1);
+
+    // Credits stop at the largest balance and the total saturates, in
+    // every kernel alike
+    int all[] = {BULK_KERNEL_SCALAR, BULK_KERNEL_SSE, BULK_KERNEL_AVX2};
+    money_t largeScalar[7];
+    for (int k = 0; k < 3; k++)
+    {
+        if (!bulkSetKernel(all[k]))
+            continue;
+        money_t edge[] = {INT64_MAX - 5, -500, 0, INT64_MAX, 10000};
+        assert(bulkApplyInterest(edge, 5, rate) == 5 + 100);
+        assert(edge[0] == INT64_MAX && edge[1] == -500 && edge[2] == 0 && edge[3] == INT64_MAX && edge[4] == 10100);
+
+        money_t large[7];
+        for (int i = 0; i < 7; i++)
+            large[i] = INT64_MAX / 2 + (money_t)i * 1000000000;
+        assert(bulkApplyInterest(large, 7, 0xffffffffu) == INT64_MAX);
+        for (int i = 0; i < 7; i++)
+            assert(large[i] > INT64_MAX / 2 + (money_t)i * 1000000000);
+        assert(large[6] == INT64_MAX);
+        if (k == 0)
+            memcpy(largeScalar, large, sizeof(large));
+        assert(memcmp(large, largeScalar, sizeof(large)) == 0);
+    }
+    assert(bulkSetKernel(BULK_KERNEL_AUTO));
+
+    free(reference);
+    free(balances);
+    free(expectedBalances);
+}
+
+void test_recordCache()
+{
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    remove(TEST_WAL);
+    assert(cacheConfigure(64, CACHE_WRITE_THROUGH));
+    assert(bankOpen(TEST_DB));
+    size_t previous = bankSetGroupCommit(1000);
+    for (int i = 0; i < 500; i++)
+    {
+        Account account = {"cached", 1 + i, 0, 100};
+        saveAccount(account);
+    }
+    assert(bankCommit());
+    bankSetGroupCommit(previous);
+
+    // Repeated reads of a hot account are hits
+    Account account;
+    CacheStats before, after;
+    assert(findAccount(7, &account));
+    cacheGetStats(&before);
+    for (int i = 0; i < 10; i++)
+        assert(findAccount(7, &account) && account.balance == 100);
+    cacheGetStats(&after);
+    assert(after.hits == before.hits + 10 && after.misses == before.misses);
+
+    // Churning through far more accounts than fit evicts without losing data
+    for (int round = 0; round < 3; round++)
+        for (int n = 1; n <= 500; n++)
+        {
+            assert(findAccount(n, &account) && account.balance == 100 + round * n);
+            account.balance += n;
+            saveAccount(account);
+        }
+    cacheGetStats(&after);
+    assert(after.entries == 64 && after.evictions > 0);
+    bankClose();
+
+    // Write-back: updates of a hot account stay in memory until the commit
+    assert(cacheConfigure(64, CACHE_WRITE_BACK));
+    assert(bankOpen(TEST_DB));
+    long logged = fileSize(TEST_WAL);
+    for (int i = 0; i < 100; i++)
+    {
+        assert(findAccount(7, &account));
+        account.balance += 1;
+        saveAccount(account);
+    }
+    assert(walPendingCount() == 0 && fileSize(TEST_WAL) == logged);
+    assert(findAccount(7, &account) && account.balance == 100 + 3 * 7 + 100);
+    assert(bankCommit());
+    cacheGetStats(&after);
+    assert(after.writeBacks == 1 && fileSize(TEST_WAL) > logged);
+
+    // Dirty records evicted by churn are logged, and everything survives
+    for (int n = 1; n <= 500; n++)
+    {
+        assert(findAccount(n, &account));
+        account.balance += 1;
+        saveAccount(account);
+    }
+    cacheGetStats(&after);
+    assert(after.writeBacks > 400);
+    bankClose();
+
+    assert(cacheConfigure(4096, CACHE_WRITE_THROUGH));
+    assert(bankOpen(TEST_DB));
+    for (int n = 1; n <= 500; n++)
+        assert(findAccount(n, &account) && account.balance == 100 + 3 * n + 1 + (n == 7 ? 100 : 0));
+    bankClose();
+
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    remove(TEST_WAL);
+}
+
+#define TEST_LEDGER TEST_DB ".ledger"
+
+static void removeLedger()
+{
+    char path[64];
+    for (int i = 0; i < 200; i++)
+    {
+        snprintf(path, sizeof(path), "%s-%06d", TEST_LEDGER, i);
+        remove(path);
+    }
+    remove(TEST_LEDGER "-heads");
+}
+
+/**
+ * Entry i of the synthetic history belongs to account 1 + i % 7 and is
+ * stamped 10 * i; the amount is i and the balance the running sum.
+ */
+static void checkLedgerQueries()
+{
+    LedgerEntry entries[300];
+
+    // Last N follows the account's chain across segment boundaries
+    size_t n = ledgerLast(3, 5, entries);
+    assert(n == 5);
+    for (size_t k = 0; k < n; k++)
+    {
+        long i = 49999 - ((49999 - 2) % 7) - 7 * (long)k;
+        assert(entries[k].accountNumber == 3 && entries[k].amount == i && entries[k].timestamp == 10 * i);
+    }
+    assert(ledgerLast(99, 5, entries) == 0);
+
+    // Short window: scanned directly, inclusive bounds, oldest first
+    n = ledgerRange(5, 10 * 1000, 10 * 1100, entries, 300);
+    assert(n == 14);
+    for (size_t k = 0; k < n; k++)
+    {
+        assert(entries[k].accountNumber == 5 && entries[k].timestamp >= 10000 && entries[k].timestamp <= 11000);
+        assert(k == 0 || entries[k].timestamp > entries[k - 1].timestamp);
+    }
+
+    // Long window: walked along the chain; the most recent entries win
+    n = ledgerRange(5, 0, 10 * 40000, entries, 300);
+    assert(n == 300);
+    assert(entries[299].timestamp <= 400000 && entries[299].timestamp > 400000 - 70);
+    assert(entries[0].timestamp == entries[299].timestamp - 299 * 70);
+
+    // Windows outside the history are empty
+    assert(ledgerRange(5, 10 * 50000, INT64_MAX, entries, 300) == 0);
+    assert(ledgerRange(5, 20, 10, entries, 300) == 0);
+}
+
+void test_ledger()
+{
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    remove(TEST_WAL);
+    removeLedger();
+
+    ledgerSetSegmentSize(4096);
+    assert(ledgerOpen(TEST_LEDGER));
+    money_t balances[8] = {0};
+    for (long i = 0; i < 50000; i++)
+    {
+        int account = 1 + (int)(i % 7);
+        balances[account] += i;
+        assert(ledgerAppendAt(account, LEDGER_DEPOSIT, i, balances[account], 10 * i));
+    }
+    assert(ledgerCount() == 50000);
+    checkLedgerQueries();
+    ledgerClose();
+
+    // Reopening loads the saved heads; losing them forces a rebuild
+    assert(ledgerOpen(TEST_LEDGER) && ledgerCount() == 50000);
+    checkLedgerQueries();
+    ledgerClose();
+    remove(TEST_LEDGER "-heads");
+    assert(ledgerOpen(TEST_LEDGER));
+    checkLedgerQueries();
+
+    // Timestamps never go backwards
+    assert(ledgerAppendAt(1, LEDGER_WITHDRAW, -1, 0, 5));
+    LedgerEntry last;
+    assert(ledgerLast(1, 1, &last) == 1 && last.timestamp == 10 * 49999 && last.amount == -1);
+    ledgerClose();
+
+    // A torn entry at the tail is dropped and the stale heads rebuilt
+    FILE *file = fopen(TEST_LEDGER "-000012", "ab");
+    fwrite("torn", 4, 1, file);
+    fclose(file);
+    assert(ledgerOpen(TEST_LEDGER) && ledgerCount() == 50001);
+    assert(ledgerLast(1, 1, &last) == 1 && last.amount == -1);
+    ledgerClose();
+    removeLedger();
+    ledgerSetSegmentSize(0);
+
+    // Account operations are recorded
+    assert(bankOpen(TEST_DB));
+    assert(engineCreate("history", 11) == BANK_OK);
+    assert(engineCreate("other", 12) == BANK_OK);
+    assert(engineDeposit(11, 5000, NULL) == BANK_OK);
+    assert(engineTransfer(11, 12, 1500) == BANK_OK);
+    assert(engineWithdraw(11, 500, NULL) == BANK_OK);
+    LedgerEntry entries[8];
+    assert(ledgerLast(11, 8, entries) == 4);
+    assert(entries[0].op == LEDGER_WITHDRAW && entries[0].amount == -500 && entries[0].balance == 3000);
+    assert(entries[1].op == LEDGER_TRANSFER && entries[1].amount == -1500 && entries[1].balance == 3500);
+    assert(entries[2].op == LEDGER_DEPOSIT && entries[3].op == LEDGER_OPEN);
+    assert(ledgerLast(12, 8, entries) == 2 && entries[0].amount == 1500);
+    bankClose();
+
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    remove(TEST_WAL);
+    removeLedger();
+}
+
+#define TEST_SOCKET "./test_bank.sock"
+
+static void *runServer(void *arg)
+{
+    (void)arg;
+    assert(serverRun(TEST_SOCKET));
+    return NULL;
+}
+
+static ServerRequest frame(char op, uint32_t requestId, int accountNumber, int64_t amount)
+{
+    ServerRequest request;
+    memset(&request, 0, sizeof(request));
+    request.op = (uint8_t)op;
+    request.requestId = requestId;
+    request.accountNumber = accountNumber;
+    request.amount = amount;
+    return request;
+}
+
+void test_socketServer()
+{
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    remove(TEST_WAL);
+    removeLedger();
+    assert(bankOpen(TEST_DB));
+
+    pthread_t server;
+    pthread_create(&server, NULL, runServer, NULL);
+    int fd = -1;
+    for (int attempt = 0; fd < 0 && attempt < 200; attempt++)
+    {
+        fd = serverConnect(TEST_SOCKET);
+        if (fd < 0)
+            usleep(10000);
+    }
+    assert(fd >= 0);
+
+    // Pipelined: every request is written before any reply is read
+    ServerRequest requests[8];
+    requests[0] = frame(BANK_OP_CREATE, 100, 21, 0);
+    strcpy(requests[0].username, "remote");
+    requests[1] = frame(BANK_OP_DEPOSIT, 101, 21, 10000);
+    requests[2] = frame(BANK_OP_WITHDRAW, 102, 21, 2500);
+    requests[3] = frame(BANK_OP_WITHDRAW, 103, 21, 99999);
+    requests[4] = frame(BANK_OP_BALANCE, 104, 21, 0);
+    requests[5] = frame(BANK_OP_CREATE, 105, 21, 0);
+    strcpy(requests[5].username, "again");
+    requests[6] = frame('?', 106, 21, 0);
+    requests[7] = frame(BANK_OP_BALANCE, 107, 99, 0);
+    assert(write(fd, requests, sizeof(requests)) == (ssize_t)sizeof(requests));
+
+    ServerResponse responses[8];
+    size_t received = 0;
+    while (received < sizeof(responses))
+    {
+        ssize_t n = read(fd, (char *)responses + received, sizeof(responses) - received);
+        assert(n > 0);
+        received += (size_t)n;
+    }
+    int expected[8] = {BANK_OK, BANK_OK, BANK_OK, BANK_INSUFFICIENT_FUNDS, BANK_OK,
+                       BANK_DUPLICATE_ACCOUNT, BANK_BAD_REQUEST, BANK_NOT_FOUND};
+    for (int i = 0; i < 8; i++)
+    {
+        assert(responses[i].requestId == 100u + i && responses[i].op == requests[i].op);
+        assert(responses[i].status == expected[i]);
+    }
+    assert(responses[1].balance == 10000 && responses[2].balance == 7500 && responses[4].balance == 7500);
+    close(fd);
+
+    serverStop();
+    pthread_join(server, NULL);
+    bankClose();
+
+    // Acknowledged changes are durable
+    money_t balance;
+    assert(bankOpen(TEST_DB));
+    assert(engineBalance(21, &balance) == BANK_OK && balance == 7500);
+    bankClose();
+
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    remove(TEST_WAL);
+    removeLedger();
+}
+
+static void *depositDuringCompaction(void *arg)
+{
+    (void)arg;
+    for (int i = 0; i < 300; i++)
+        assert(engineDeposit(1000 + (i % 100) * 10, 1, NULL) == BANK_OK);
+    return NULL;
+}
+
+void test_accountClosure()
+{
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    remove(TEST_WAL);
+    removeLedger();
+    assert(bankOpen(TEST_DB));
+
+    for (int i = 0; i < 1000; i++)
+        assert(engineCreate("churn", 1000 + i) == BANK_OK);
+    assert(engineDeposit(1005, 100, NULL) == BANK_OK);
+    assert(engineClose(1005) == BANK_NOT_EMPTY);
+    assert(engineClose(4242) == BANK_NOT_FOUND);
+
+    // Close every account whose number is not a multiple of ten
+    for (int i = 0; i < 1000; i++)
+        if (i % 10 != 0 && i != 5)
+            assert(engineClose(1000 + i) == BANK_OK);
+    assert(engineBalance(1001, NULL) == BANK_NOT_FOUND);
+    assert(engineDeposit(1001, 100, NULL) == BANK_NOT_FOUND);
+    assert(indexFreeCount() == 899);
+
+    // New accounts (even a closed number) fill the lowest free slots
+    assert(engineCreate("reborn", 1001) == BANK_OK);
+    assert(engineCreate("fresh", 5000) == BANK_OK);
+    assert(indexLookup(1001) == 1 && indexLookup(5000) == 2);
+    assert(storeRecordCount() == 1000 && indexFreeCount() == 897);
+
+    // The free list survives a clean close
+    bankClose();
+    assert(bankOpen(TEST_DB));
+    assert(indexFreeCount() == 897);
+    money_t balance;
+    assert(engineBalance(1001, &balance) == BANK_OK && balance == 0);
+
+    // Compaction runs while deposits keep arriving
+    pthread_t depositor;
+    pthread_create(&depositor, NULL, depositDuringCompaction, NULL);
+    size_t moved = 0;
+    assert(engineCompact(&moved));
+    pthread_join(depositor, NULL);
+    assert(moved > 0 && storeRecordCount() == 103 && indexFreeCount() == 0);
+    for (int i = 0; i < 1000; i += 10)
+    {
+        assert(engineBalance(1000 + i, &balance) == BANK_OK && balance == 3);
+        assert(indexLookup(1000 + i) < 103);
+    }
+    assert(engineBalance(1005, &balance) == BANK_OK && balance == 100);
+    assert(engineCreate("after", 6000) == BANK_OK && indexLookup(6000) == 103);
+    bankClose();
+
+    // Also after a rebuild from the records
+    remove(TEST_INDEX);
+    assert(bankOpen(TEST_DB));
+    assert(storeRecordCount() == 104 && indexFreeCount() == 0);
+    assert(engineBalance(1990, &balance) == BANK_OK && balance == 3);
+    AccountColumns columns;
+    assert(columnsLoad(&columns) && columns.count == 104);
+    columnsFree(&columns);
+    bankClose();
+
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    remove(TEST_WAL);
+    removeLedger();
+}
+
+#define TEST_NAMES TEST_DB ".names"
+
+void test_nameIndex()
+{
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    remove(TEST_WAL);
+    remove(TEST_NAMES);
+    removeLedger();
+    assert(bankOpen(TEST_DB));
+
+    // Enough names to merge the delta into the base several times
+    char name[30];
+    for (int i = 0; i < 5000; i++)
+    {
+        snprintf(name, sizeof(name), "user%04d", (i * 7919) % 5000);
+        assert(engineCreate(name, 10000 + i) == BANK_OK);
+    }
+    assert(engineCreate("user0042", 20000) == BANK_OK);
+    assert(engineCreate("alice", 20001) == BANK_OK);
+    assert(namesCount() == 5002);
+
+    NameEntry matches[64];
+    assert(namesSearch("user0042", 0, matches, 64) == 2);
+    assert(strcmp(matches[0].username, "user0042") == 0 && matches[1].accountNumber == 20000);
+    assert(namesSearch("user004", 0, matches, 64) == 0);
+    assert(namesSearch("user004", 1, matches, 64) == 11);
+    for (int k = 1; k < 11; k++)
+        assert(strcmp(matches[k - 1].username, matches[k].username) <= 0);
+    assert(namesSearch("user", 1, matches, 64) == 64);
+    assert(namesSearch("", 1, matches, 1) == 1 && strcmp(matches[0].username, "alice") == 0);
+
+    // Closing and renaming keep the index in step
+    assert(engineClose(20000) == BANK_OK);
+    assert(namesSearch("user0042", 0, matches, 64) == 1);
+    Account account;
+    assert(findAccount(20001, &account));
+    strcpy(account.username, "alicia");
+    saveAccount(account);
+    assert(namesSearch("alice", 0, matches, 64) == 0);
+    assert(namesSearch("ali", 1, matches, 64) == 1 && matches[0].accountNumber == 20001);
+    bankClose();
+
+    // Saved on close, rebuilt when missing
+    assert(bankOpen(TEST_DB));
+    assert(namesCount() == 5001 && namesSearch("alicia", 0, matches, 64) == 1);
+    bankClose();
+    remove(TEST_NAMES);
+    assert(bankOpen(TEST_DB));
+    assert(namesCount() == 5001 && namesSearch("user004", 1, matches, 64) == 10);
+    bankClose();
+
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    remove(TEST_WAL);
+    remove(TEST_NAMES);
+    removeLedger();
+}
+
+#define TEST_BACKUP "test_backup.dat"
+
+static void *transferDuringBackup(void *arg)
+{
+    (void)arg;
+    for (int i = 0; i < 2000; i++)
+        assert(engineTransfer(30000 + i % 500, 30000 + (i * 7 + 3) % 500, 1) != BANK_IO_ERROR);
+    return NULL;
+}
+
+void test_onlineSnapshot()
+{
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    remove(TEST_WAL);
+    remove(TEST_NAMES);
+    removeLedger();
+    assert(bankOpen(TEST_DB));
+    for (int i = 0; i < 500; i++)
+    {
+        assert(engineCreate("snap", 30000 + i) == BANK_OK);
+        assert(engineDeposit(30000 + i, 1000, NULL) == BANK_OK);
+    }
+
+    // Committed writes after the snapshot do not show through it
+    assert(walSnapshot() == 500);
+    assert(walSnapshot() == -1);
+    assert(engineDeposit(30000, 5, NULL) == BANK_OK);
+    assert(engineDeposit(30499, 5, NULL) == BANK_OK);
+    assert(engineCreate("late", 40000) == BANK_OK);
+    assert(bankCommit());
+    Account records[500], live;
+    assert(storeSnapshotRead(0, records, 500) == 500);
+    assert(records[0].balance == 1000 && records[499].balance == 1000);
+    assert(storeRecordCount() == 501 && storeReadRecord(0, &live) && live.balance == 1005);
+    assert(storeSnapshotRead(500, records, 1) == 0);
+    assert(storeSnapshotEnd() == 2);
+
+    // A backup taken during transfers holds one consistent moment
+    pthread_t mover;
+    pthread_create(&mover, NULL, transferDuringBackup, NULL);
+    assert(bankBackup(TEST_BACKUP));
+    pthread_join(mover, NULL);
+    bankClose();
+
+    assert(bankOpen(TEST_BACKUP));
+    AccountColumns columns;
+    assert(columnsLoad(&columns) && columns.count == 501);
+    assert(columnsTotalBalance(&columns) == 500 * 1000 + 10);
+    columnsFree(&columns);
+    money_t balance;
+    assert(engineBalance(40000, &balance) == BANK_OK && balance == 0);
+
+    // Truncation to a count inside a page still preserves every later page
+    assert(walSnapshot() == 501);
+    assert(storeTruncate(60) && storeRecordCount() == 60);
+    assert(storeSnapshotRead(64, records, 6) == 6);
+    assert(records[0].accountNumber == 30064 && records[5].accountNumber == 30069);
+    assert(storeSnapshotRead(490, records, 11) == 11 && records[10].accountNumber == 40000);
+    storeSnapshotEnd();
+    bankClose();
+
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    remove(TEST_WAL);
+    remove(TEST_NAMES);
+    removeLedger();
+    remove(TEST_BACKUP);
+    remove(TEST_BACKUP ".idx");
+    remove(TEST_BACKUP ".wal");
+    remove(TEST_BACKUP ".names");
+    remove(TEST_BACKUP ".ledger-000000");
+    remove(TEST_BACKUP ".ledger-heads");
+}
+
+void test_walWriteFailure()
+{
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    remove(TEST_WAL);
+    remove(TEST_NAMES);
+    removeLedger();
+    assert(bankOpen(TEST_DB));
+    assert(engineCreate("durable", 1) == BANK_OK);
+    assert(engineDeposit(1, 100, NULL) == BANK_OK);
+    assert(ledgerCount() == 2);
+    FILE *file = fopen("test_batch.csv", "w");
+    fprintf(file, "D,1,2.00\n");
+    fclose(file);
+
+    // Files may not grow any more, so the next log write fails
+    struct stat info;
+    struct rlimit saved, limit;
+    assert(stat(TEST_WAL, &info) == 0 && info.st_size > 0);
+    assert(getrlimit(RLIMIT_FSIZE, &saved) == 0);
+    limit = saved;
+    limit.rlim_cur = (rlim_t)info.st_size;
+    signal(SIGXFSZ, SIG_IGN);
+    assert(setrlimit(RLIMIT_FSIZE, &limit) == 0);
+
+    // The failed deposit is neither reported durable nor read back, and the
+    // log refuses everything else until it is reopened
+    money_t balance;
+    assert(engineDeposit(1, 50, NULL) == BANK_IO_ERROR);
+    assert(engineBalance(1, &balance) == BANK_OK && balance == 100);
+    assert(setrlimit(RLIMIT_FSIZE, &saved) == 0);
+    signal(SIGXFSZ, SIG_DFL);
+    assert(engineDeposit(1, 1, NULL) == BANK_IO_ERROR);
+    assert(engineCreate("lost", 2) == BANK_IO_ERROR);
+    assert(walCommit() == 0);
+
+    // Failed changes leave no history, in the engine or in a batch
+    assert(!runBatch("test_batch.csv", "test_batch_results.csv"));
+    char line[128];
+    file = fopen("test_batch_results.csv", "r");
+    assert(fgets(line, sizeof(line), file) && fgets(line, sizeof(line), file) && strstr(line, "IO_ERROR"));
+    fclose(file);
+    assert(ledgerCount() == 2);
+    bankClose();
+
+    assert(bankOpen(TEST_DB));
+    assert(engineBalance(1, &balance) == BANK_OK && balance == 100);
+    LedgerEntry entries[4];
+    assert(ledgerLast(1, 4, entries) == 2 && entries[0].amount == 100 && entries[1].op == LEDGER_OPEN);
+    assert(engineBalance(2, NULL) == BANK_NOT_FOUND);
+    assert(engineDeposit(1, 5, &balance) == BANK_OK && balance == 105);
+    bankClose();
+
+    remove(TEST_DB);
+    remove(TEST_INDEX);
+    remove(TEST_WAL);
+    remove(TEST_NAMES);
+    removeLedger();
+    remove("test_batch.csv");
+    remove("test_batch_results.csv");
+}
+
 int main()
 {
+    test_indexedLookup();
+    test_staleIndexRebuild();
+    test_mmapBackend();
+    test_batchIngestion();
+    test_walRecovery();
+    test_concurrentEngine();
+    test_moneyConversions();
+    test_legacyMigration();
+    test_accountColumns();
+    test_bulkKernels();
+    test_recordCache();
+    test_ledger();
+    test_socketServer();
+    test_accountClosure();
+    test_nameIndex();
+    test_onlineSnapshot();
+    test_walWriteFailure();
+
     test_createAccount();
     test_depositMoney();
     test_withdrawMoney();
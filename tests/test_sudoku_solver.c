@@ -1,5 +1,7 @@
 #include <stdio.h>
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 #include "../include/sudoku_solver.h"
 
 void test_isSafe()
@@ -33,10 +35,174 @@ void test_solveSudoku()
     assert(solveSudoku(grid) == 1);
 }
 
+void loadGrid(int grid[N][N], const char *puzzle)
+{
+    for (int cell = 0; cell < N * N; cell++)
+        grid[cell / N][cell % N] = puzzle[cell] == '.' ? 0 : puzzle[cell] - '0';
+}
+
+void test_solveHardSudoku()
+{
+    // Needs guessing well beyond singles; must agree with plain backtracking
+    int grid[N][N], reference[N][N];
+    loadGrid(grid, "8..........36......7..9.2...5...7.......457.....1...3...1....68..85...1..9....4..");
+    memcpy(reference, grid, sizeof(grid));
+    assert(solveSudoku(grid) == 1);
+    assert(solveSudokuBacktracking(reference) == 1);
+    assert(memcmp(grid, reference, sizeof(grid)) == 0);
+    for (int row = 0; row < N; row++)
+        for (int col = 0; col < N; col++)
+        {
+            int digit = grid[row][col];
+            grid[row][col] = 0;
+            assert(isSafe(grid, row, col, digit));
+            grid[row][col] = digit;
+        }
+
+    // Built to defeat backtracking in order: the first row is 987654321
+    loadGrid(grid, "..............3.85..1.2.......5.7.....4...1...9.......5......73..2.1........4...9");
+    assert(solveSudoku(grid) == 1);
+    assert(grid[0][0] == 9 && grid[0][8] == 1);
+
+    // Clashing givens and dead ends leave the grid as it was
+    loadGrid(grid, "11...............................................................................");
+    memcpy(reference, grid, sizeof(grid));
+    assert(solveSudoku(grid) == 0);
+    assert(memcmp(grid, reference, sizeof(grid)) == 0);
+    loadGrid(grid, "12345678.........9...............................................................");
+    assert(solveSudoku(grid) == 0);
+}
+
+void test_dancingLinks()
+{
+    int grid[N][N], reference[N][N];
+
+    // Every backend finds the one solution
+    for (int backend = 0; backend < SUDOKU_BACKEND_COUNT; backend++)
+    {
+        loadGrid(grid, "...26.7.168..7..9.19...45..82.1...4...46.29...5...3.28..93...74.4..5..367.3.18...");
+        assert(solveSudokuWith(grid, backend) == 1);
+        if (backend == 0)
+            memcpy(reference, grid, sizeof(grid));
+        assert(memcmp(grid, reference, sizeof(grid)) == 0);
+    }
+    assert(solveSudokuWith(grid, SUDOKU_BACKEND_COUNT) == 0);
+
+    loadGrid(grid, "..............3.85..1.2.......5.7.....4...1...9.......5......73..2.1........4...9");
+    assert(countSudokuSolutions(grid, 0) == 1);
+    assert(solveSudokuDlx(grid) == 1 && grid[0][0] == 9);
+
+    // Counting tells proper puzzles from ones with several solutions
+    loadGrid(grid, "...26.7.168..7..9.19...45..82.1...4...46.29...5...3.28..93...74.4..5..367.3.18...");
+    assert(countSudokuSolutions(grid, 0) == 1);
+    grid[0][3] = grid[0][4] = grid[0][6] = 0;
+    assert(countSudokuSolutions(grid, 0) > 1);
+    loadGrid(grid, ".................................................................................");
+    assert(countSudokuSolutions(grid, 5) == 5);
+
+    // Clashing givens and dead ends
+    loadGrid(grid, "11...............................................................................");
+    assert(countSudokuSolutions(grid, 0) == -1 && solveSudokuDlx(grid) == 0);
+    loadGrid(grid, "12345678.........9...............................................................");
+    assert(countSudokuSolutions(grid, 0) == 0 && solveSudokuDlx(grid) == 0);
+}
+
+void test_simdKernels()
+{
+    const char *puzzles[] = {
+        "8..........36......7..9.2...5...7.......457.....1...3...1....68..85...1..9....4..",
+        "4.....8.5.3..........7......2.....6.....8.4......1.......6.3.7.5..2.....1.4......",
+        "..............3.85..1.2.......5.7.....4...1...9.......5......73..2.1........4...9",
+        "12345678.........9...............................................................",
+    };
+    int grid[N][N], reference[N][N];
+
+    // Every kernel this CPU runs agrees with the scalar one, solvable or not
+    assert(sudokuSetKernel(SUDOKU_KERNEL_SCALAR) == 1);
+    assert(strcmp(sudokuKernelName(), "scalar") == 0);
+    for (int kernel = SUDOKU_KERNEL_SSE; kernel <= SUDOKU_KERNEL_AVX2; kernel++)
+    {
+        for (size_t p = 0; p < sizeof(puzzles) / sizeof(puzzles[0]); p++)
+        {
+            assert(sudokuSetKernel(SUDOKU_KERNEL_SCALAR) == 1);
+            loadGrid(reference, puzzles[p]);
+            bool solved = solveSudoku(reference);
+            if (!sudokuSetKernel(kernel))
+                break;
+            loadGrid(grid, puzzles[p]);
+            assert(solveSudoku(grid) == solved);
+            assert(memcmp(grid, reference, sizeof(grid)) == 0);
+        }
+    }
+
+    assert(sudokuSetKernel(SUDOKU_KERNEL_AUTO) == 1);
+    assert(strcmp(sudokuKernelName(), "scalar") == 0 || strcmp(sudokuKernelName(), "sse") == 0 ||
+           strcmp(sudokuKernelName(), "avx2") == 0);
+}
+
+void test_solveSudokuFile()
+{
+    const char *easy = "...26.7.168..7..9.19...45..82.1...4...46.29...5...3.28..93...74.4..5..367.3.18...";
+    const char *clash = "11...............................................................................";
+    char path[] = "/tmp/test_sudoku_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    FILE *input = fdopen(fd, "w");
+
+    // Several chunks' worth of puzzles, with lines that are not puzzles in between
+    fprintf(input, "quizzes,solutions\n");
+    for (int i = 0; i < 3000; i++)
+    {
+        fprintf(input, "%s%s\n", i % 7 == 3 ? clash : easy, i % 2 ? ",ignored" : "");
+        if (i % 100 == 0)
+            fprintf(input, "# comment\n\n");
+    }
+    fclose(input);
+
+    int grid[N][N];
+    char solution[N * N + 1];
+    loadGrid(grid, easy);
+    solveSudoku(grid);
+    for (int cell = 0; cell < N * N; cell++)
+        solution[cell] = (char)('0' + grid[cell / N][cell % N]);
+    solution[N * N] = '\0';
+
+    for (int threads = 1; threads <= 4; threads += 3)
+    {
+        FILE *output = tmpfile();
+        SudokuBatchStats stats;
+        assert(solveSudokuFile(path, output, threads, SUDOKU_BACKEND_BITMASK, &stats));
+        assert(stats.puzzles == 3000 && stats.solved == 3000 - 429);
+
+        // Solutions come back in input order, dots for the puzzle that has none
+        rewind(output);
+        char line[128];
+        for (int i = 0; i < 3000; i++)
+        {
+            assert(fgets(line, sizeof(line), output));
+            assert(strlen(line) == N * N + 1);
+            if (i % 7 == 3)
+                assert(strspn(line, ".") == N * N);
+            else
+                assert(strncmp(line, solution, N * N) == 0);
+        }
+        assert(!fgets(line, sizeof(line), output));
+        fclose(output);
+    }
+
+    SudokuBatchStats stats;
+    assert(!solveSudokuFile("/nonexistent/puzzles.txt", stdout, 1, SUDOKU_BACKEND_BITMASK, &stats));
+    remove(path);
+}
+
 int main()
 {
     test_isSafe();
     test_solveSudoku();
+    test_solveHardSudoku();
+    test_dancingLinks();
+    test_simdKernels();
+    test_solveSudokuFile();
     printf("All tests passed!\n");
     return 0;
 }
@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include "../include/tic_tac_toe.h"
+
+void test_boardWins()
+{
+    Board b;
+    assert(!board_init(&b, 2, 2));
+    assert(!board_init(&b, 5, 6));
+    assert(board_init(&b, 5, 4));
+
+    // Down-left diagonal, completed in the middle
+    board_play(&b, 0, 4, 'X');
+    board_play(&b, 1, 3, 'X');
+    board_play(&b, 3, 1, 'X');
+    assert(!board_wins(&b, 3, 1));
+    board_play(&b, 2, 2, 'X');
+    assert(board_wins(&b, 2, 2) && board_wins(&b, 0, 4));
+    board_undo(&b, 2, 2);
+    board_play(&b, 2, 2, 'O');
+    assert(!board_wins(&b, 2, 2) && !board_wins(&b, 1, 3));
+    assert(b.moves == 4 && !board_full(&b));
+
+    // The interactive helpers see the global board
+    board_init(&board, 3, 3);
+    board_play(&board, 0, 0, 'O');
+    board_play(&board, 1, 1, 'O');
+    assert(!is_winner('O'));
+    board_play(&board, 2, 2, 'O');
+    assert(is_winner('O') && !is_winner('X') && !is_draw());
+    assert(board_mask(&board, 'O') == 0x111);
+}
+
+void test_tablebaseMatchesMinimax()
+{
+    int positions = 0;
+    for (int index = 0; index < TABLEBASE_SIZE; index++)
+    {
+        unsigned own = 0, opponent = 0;
+        for (int cell = 0, rest = index; cell < CELLS; cell++, rest /= 3)
+        {
+            if (rest % 3 == 1)
+                own |= 1u << cell;
+            else if (rest % 3 == 2)
+                opponent |= 1u << cell;
+        }
+        int outcome;
+        int move = tablebase_move(own, opponent, &outcome);
+        if (move < 0)
+            continue;
+        positions++;
+
+        // Put the mover on 'O', whom minimax() maximises for
+        board_init(&board, SIZE, SIZE);
+        for (int cell = 0; cell < CELLS; cell++)
+            if ((own | opponent) & (1u << cell))
+                board_play(&board, cell / SIZE, cell % SIZE, own & (1u << cell) ? 'O' : 'X');
+        assert(!is_winner('O') && !is_winner('X') && board.cells[move / SIZE][move % SIZE] == ' ');
+
+        int best = -1000, chosen = 0;
+        for (int cell = 0; cell < CELLS; cell++)
+        {
+            if (board.cells[cell / SIZE][cell % SIZE] != ' ')
+                continue;
+            board.cells[cell / SIZE][cell % SIZE] = 'O';
+            int score = minimax(board.cells, 0, 0);
+            board.cells[cell / SIZE][cell % SIZE] = ' ';
+            if (score > best)
+                best = score;
+            if (cell == move)
+                chosen = score;
+        }
+        assert(chosen == best);
+        assert(outcome == (best > 0) - (best < 0));
+    }
+    assert(positions == 4520);
+
+    // Perfect play from the empty board is a draw
+    int outcome;
+    assert(tablebase_move(0, 0, &outcome) >= 0 && outcome == 0);
+}
+
+void test_searchFindsWinAndBlock()
+{
+    Board b;
+    SearchResult result;
+
+    // 'O' has three of four in a row and takes the fourth
+    board_init(&b, 6, 4);
+    board_play(&b, 2, 1, 'O');
+    board_play(&b, 2, 2, 'O');
+    board_play(&b, 2, 3, 'O');
+    board_play(&b, 0, 0, 'X');
+    board_play(&b, 2, 0, 'X');
+    board_play(&b, 5, 5, 'X');
+    assert(search_best_move(&b, 'O', 200, &result));
+    assert(result.row == 2 && result.col == 4 && result.score > SEARCH_WIN - MAX_SIZE * MAX_SIZE);
+
+    // 'X' must block the same line
+    assert(search_best_move(&b, 'X', 200, &result));
+    assert(result.row == 2 && result.col == 4);
+
+    // On 15x15 the search still answers within its budget
+    board_init(&b, 15, 5);
+    board_play(&b, 7, 7, 'X');
+    assert(search_best_move(&b, 'O', 100, &result) && result.depth >= 1);
+    assert(b.cells[result.row][result.col] == ' ');
+}
+
+void test_parallelSearch()
+{
+    Board b;
+    SearchResult sequential, parallel;
+    board_init(&b, 9, 5);
+    board_play(&b, 4, 4, 'X');
+    board_play(&b, 4, 5, 'O');
+    board_play(&b, 3, 3, 'X');
+    board_play(&b, 5, 5, 'O');
+
+    // Root moves spread over four threads reach the same verdict
+    search_set_max_depth(4);
+    search_set_threads(1);
+    assert(search_best_move(&b, 'X', 0, &sequential) && sequential.depth == 4);
+    search_set_threads(4);
+    assert(search_best_move(&b, 'X', 0, &parallel) && parallel.depth == 4);
+    assert(parallel.score == sequential.score);
+    assert(b.cells[parallel.row][parallel.col] == ' ');
+    search_set_threads(0);
+    search_set_max_depth(0);
+}
+
+void test_headlessEngines()
+{
+    uint64_t rng, replay;
+    rng_seed(&rng, 42);
+    rng_seed(&replay, 42);
+    for (int i = 0; i < 100; i++)
+        assert(rng_below(&rng, 9) == rng_below(&replay, 9));
+
+    // Perfect play never loses, and draws against itself
+    for (int game = 0; game < 2000; game++)
+    {
+        char first = game % 2 ? 'O' : 'X';
+        assert(engine_play_game(ENGINE_GOD, ENGINE_GOD, 3, 3, first, &rng) == 'D');
+        assert(engine_play_game(ENGINE_GOD, ENGINE_RANDOM, 3, 3, first, &rng) != 'O');
+        assert(engine_play_game(ENGINE_HUMAN, ENGINE_GOD, 3, 3, first, &rng) != 'X');
+    }
+
+    // The same seed replays the same games
+    int results[2][64];
+    for (int run = 0; run < 2; run++)
+    {
+        rng_seed(&rng, 7);
+        for (int game = 0; game < 64; game++)
+            results[run][game] = engine_play_game(ENGINE_HUMAN, ENGINE_RANDOM, 4, 3, 'X', &rng);
+    }
+    assert(memcmp(results[0], results[1], sizeof(results[0])) == 0);
+
+    // A threat is exactly a free cell that would win for those stones
+    for (unsigned mask = 0; mask < (1u << CELLS); mask++)
+    {
+        for (int cell = 0; cell < CELLS; cell++)
+        {
+            if (mask & (1u << cell))
+                continue;
+            Board probe;
+            board_init(&probe, SIZE, SIZE);
+            for (int other = 0; other < CELLS; other++)
+                if (mask & (1u << other))
+                    board_play(&probe, other / SIZE, other % SIZE, 'X');
+            board_play(&probe, cell / SIZE, cell % SIZE, 'X');
+            assert(!!(threat_cells[mask] & (1u << cell)) == board_wins(&probe, cell / SIZE, cell % SIZE));
+        }
+    }
+
+    // The human engine takes its win before blocking
+    Board b;
+    int row, col;
+    board_init(&b, 3, 3);
+    board_play(&b, 0, 0, 'X');
+    board_play(&b, 0, 1, 'X');
+    board_play(&b, 2, 0, 'O');
+    board_play(&b, 2, 1, 'O');
+    assert(engine_move(ENGINE_HUMAN, &b, 'O', &rng, &row, &col) && row == 2 && col == 2);
+    assert(engine_move(ENGINE_HUMAN, &b, 'X', &rng, &row, &col) && row == 0 && col == 2);
+
+    assert(engine_lookup("god") == ENGINE_GOD && engine_lookup("nobody") < 0);
+    assert(strcmp(engine_name(ENGINE_HUMAN), "human") == 0);
+}
+
+void test_monteCarloSearch()
+{
+    Board b;
+    MctsResult result;
+    uint64_t rng;
+    rng_seed(&rng, 3);
+    mcts_set_threads(1);
+
+    // 'O' completes the top row rather than blocking the middle column
+    board_init(&b, 3, 3);
+    board_play(&b, 0, 0, 'O');
+    board_play(&b, 0, 1, 'O');
+    board_play(&b, 1, 1, 'X');
+    board_play(&b, 2, 1, 'X');
+    assert(mcts_best_move(&b, 'O', 2000, 0, &rng, &result));
+    assert(result.row == 0 && result.col == 2 && result.win_rate > 0.9 && result.iterations == 2000);
+
+    // 'X' to move must block it
+    assert(mcts_best_move(&b, 'X', 2000, 0, &rng, &result));
+    assert(result.row == 0 && result.col == 2);
+
+    // Tree parallelism keeps the budget, and a time budget is kept too
+    mcts_set_threads(4);
+    board_init(&b, 7, 4);
+    board_play(&b, 3, 3, 'X');
+    assert(mcts_best_move(&b, 'O', 3000, 0, &rng, &result) && result.iterations == 3000);
+    assert(b.cells[result.row][result.col] == ' ');
+    assert(mcts_best_move(&b, 'O', 0, 50, &rng, &result) && result.iterations > 0);
+    mcts_set_threads(0);
+
+    // Never loses to perfect play on 3x3
+    for (int game = 0; game < 20; game++)
+        assert(engine_play_game(ENGINE_GOD, ENGINE_MCTS, 3, 3, game % 2 ? 'O' : 'X', &rng) != 'X');
+}
+
+int main()
+{
+    test_boardWins();
+    test_tablebaseMatchesMinimax();
+    test_searchFindsWinAndBlock();
+    test_parallelSearch();
+    test_headlessEngines();
+    test_monteCarloSearch();
+    printf("All tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,217 @@
+/*******************************************************************************
+ * Bitboard Search for Tic Tac Toe
+ *
+ * A position is two 9-bit masks, one per player, with bit (3 * row + col)
+ * set for every occupied cell. Testing for a win is a comparison against the
+ * eight precomputed line masks, so no node rescans the board.
+ *
+ * The search is negamax with alpha-beta pruning. Its results are kept in a
+ * transposition table keyed by the canonical form of a position: the
+ * smallest encoding among its eight rotations and reflections. Symmetric
+ * positions therefore share one entry, and the table lives across moves, so
+ * once a game is under way the "God" move costs a handful of nodes.
+ *
+ * Scores are seen from the side to move. A win scores 10 minus the number of
+ * stones on the board when it happens (quicker wins, slower losses) and a
+ * draw scores 0. Unlike a depth counted from the root, this only depends on
+ * the position, which is what lets table entries be reused by any search.
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <string.h>
+#include "tic_tac_toe.h"
+
+#define FULL_BOARD 0x1FF
+#define TABLE_SIZE 2048 // Power of two, well above the 765 canonical positions
+
+/* Transposition table bounds */
+#define BOUND_EXACT 0
+#define BOUND_LOWER 1 // Score is at least the stored value
+#define BOUND_UPPER 2 // Score is at most the stored value
+
+/* The eight winning lines: rows, columns, diagonals */
+static const uint16_t win_masks[8] = {0x007, 0x038, 0x1C0, 0x049, 0x092, 0x124, 0x111, 0x054};
+
+/* Center first, then corners, then edges: strong moves cut the search early */
+static const int move_order[CELLS] = {4, 0, 2, 6, 8, 1, 3, 5, 7};
+
+typedef struct
+{
+    uint32_t key; // Canonical position + 1, 0 for an empty slot
+    int8_t score;
+    uint8_t bound;
+} TableEntry;
+
+static TableEntry table[TABLE_SIZE];
+static uint16_t symmetry[8][1 << CELLS]; // Each mask under each symmetry
+static int symmetry_ready = 0;
+static unsigned long nodes = 0;
+
+/*******************************************************************************
+ * Position Helpers
+ ******************************************************************************/
+
+/* Returns 1 if the mask holds a complete line */
+static int has_line(unsigned mask)
+{
+    for (int i = 0; i < 8; i++)
+        if ((mask & win_masks[i]) == win_masks[i])
+            return 1;
+    return 0;
+}
+
+/* Builds the image of every mask under the four rotations and their mirrors */
+static void init_symmetry()
+{
+    int cell_map[8][CELLS];
+    for (int s = 0; s < 8; s++)
+    {
+        for (int cell = 0; cell < CELLS; cell++)
+        {
+            int row = cell / SIZE, col = cell % SIZE;
+            if (s & 4)
+            { // Mirror along the main diagonal
+                int swap = row;
+                row = col;
+                col = swap;
+            }
+            for (int turn = 0; turn < (s & 3); turn++)
+            { // Quarter turn clockwise
+                int swap = row;
+                row = col;
+                col = SIZE - 1 - swap;
+            }
+            cell_map[s][cell] = row * SIZE + col;
+        }
+    }
+
+    for (int s = 0; s < 8; s++)
+    {
+        for (unsigned mask = 0; mask < (1u << CELLS); mask++)
+        {
+            uint16_t image = 0;
+            for (int cell = 0; cell < CELLS; cell++)
+                if (mask & (1u << cell))
+                    image |= 1u << cell_map[s][cell];
+            symmetry[s][mask] = image;
+        }
+    }
+    symmetry_ready = 1;
+}
+
+/* Smallest 18-bit encoding of the position among its symmetric variants */
+static uint32_t canonical_key(unsigned own, unsigned opponent)
+{
+    uint32_t best = UINT32_MAX;
+    for (int s = 0; s < 8; s++)
+    {
+        uint32_t key = symmetry[s][own] | (uint32_t)symmetry[s][opponent] << CELLS;
+        if (key < best)
+            best = key;
+    }
+    return best;
+}
+
+static TableEntry *probe(uint32_t key)
+{
+    uint32_t slot = (key * 2654435761u) & (TABLE_SIZE - 1);
+    while (table[slot].key != 0 && table[slot].key != key + 1)
+        slot = (slot + 1) & (TABLE_SIZE - 1);
+    return &table[slot];
+}
+
+/*******************************************************************************
+ * Search
+ ******************************************************************************/
+
+/* Negamax value of the position for the side owning 'own', who is to move */
+static int negamax(unsigned own, unsigned opponent, int alpha, int beta)
+{
+    nodes++;
+    unsigned occupied = own | opponent;
+    if (has_line(opponent))
+        return __builtin_popcount(occupied) - 10;
+    if (occupied == FULL_BOARD)
+        return 0;
+
+    uint32_t key = canonical_key(own, opponent);
+    TableEntry *entry = probe(key);
+    if (entry->key == key + 1)
+    {
+        if (entry->bound == BOUND_EXACT)
+            return entry->score;
+        if (entry->bound == BOUND_LOWER && entry->score > alpha)
+            alpha = entry->score;
+        else if (entry->bound == BOUND_UPPER && entry->score < beta)
+            beta = entry->score;
+        if (alpha >= beta)
+            return entry->score;
+    }
+
+    int original_alpha = alpha;
+    int best_score = -100;
+    for (int i = 0; i < CELLS && alpha < beta; i++)
+    {
+        unsigned bit = 1u << move_order[i];
+        if (occupied & bit)
+            continue;
+        int score = -negamax(opponent, own | bit, -beta, -alpha);
+        if (score > best_score)
+            best_score = score;
+        if (score > alpha)
+            alpha = score;
+    }
+
+    entry = probe(key); // The slot may have been claimed during the search
+    entry->key = key + 1;
+    entry->score = (int8_t)best_score;
+    entry->bound = best_score <= original_alpha ? BOUND_UPPER
+                   : best_score >= beta         ? BOUND_LOWER
+                                                : BOUND_EXACT;
+    return best_score;
+}
+
+/* Finds the best move for the side owning 'own', who is to move.
+ * Returns the cell (3 * row + col), or -1 if the game is already over.
+ * Ties go to the first cell in row-major order, as in minimax().
+ */
+int bitboard_best_move(unsigned own, unsigned opponent, int *score)
+{
+    if (!symmetry_ready)
+        init_symmetry();
+    nodes = 0;
+
+    unsigned occupied = own | opponent;
+    int best_move = -1, best_score = -100;
+    if (has_line(own) || has_line(opponent))
+        return -1;
+
+    for (int cell = 0; cell < CELLS; cell++)
+    {
+        unsigned bit = 1u << cell;
+        if (occupied & bit)
+            continue;
+        // A window of (best, +inf) only proves moves that beat the best so far
+        int value = -negamax(opponent, own | bit, -100, -best_score);
+        if (value > best_score)
+        {
+            best_score = value;
+            best_move = cell;
+        }
+    }
+    if (score)
+        *score = best_score;
+    return best_move;
+}
+
+/* Number of nodes visited by the last bitboard_best_move() call */
+unsigned long bitboard_nodes()
+{
+    return nodes;
+}
+
+/* Forgets every stored position */
+void bitboard_clear_table()
+{
+    memset(table, 0, sizeof(table));
+}
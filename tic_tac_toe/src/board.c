@@ -0,0 +1,94 @@
+/*******************************************************************************
+ * Board Operations
+ *
+ * Any board from 3x3 up to MAX_SIZE x MAX_SIZE, won by k stones in a row.
+ * Win detection only looks at the four lines through the last move, so it
+ * costs at most 4 * (2k - 1) cells however large the board is.
+ ******************************************************************************/
+
+#include <string.h>
+#include "tic_tac_toe.h"
+
+/* Line directions: across, down, down-right, down-left */
+static const int directions[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+
+/* Clears the board. Returns 0 if the size or line length is out of range */
+int board_init(Board *b, int size, int k)
+{
+    if (size < 3 || size > MAX_SIZE || k < 3 || k > size)
+        return 0;
+    b->size = size;
+    b->k = k;
+    b->moves = 0;
+    b->last_row = b->last_col = -1;
+    memset(b->cells, ' ', sizeof(b->cells));
+    return 1;
+}
+
+/* Places a symbol on an empty cell */
+void board_play(Board *b, int row, int col, char symbol)
+{
+    b->cells[row][col] = symbol;
+    b->moves++;
+    b->last_row = row;
+    b->last_col = col;
+}
+
+/* Takes a stone back off the board (the last move is not restored) */
+void board_undo(Board *b, int row, int col)
+{
+    b->cells[row][col] = ' ';
+    b->moves--;
+}
+
+/* Checks if the stone at (row, col) is part of k in a row */
+int board_wins(const Board *b, int row, int col)
+{
+    char symbol = b->cells[row][col];
+    if (symbol == ' ')
+        return 0;
+
+    for (int d = 0; d < 4; d++)
+    {
+        int dr = directions[d][0], dc = directions[d][1];
+        int count = 1;
+        for (int r = row + dr, c = col + dc; r >= 0 && r < b->size && c >= 0 && c < b->size && b->cells[r][c] == symbol; r += dr, c += dc)
+            count++;
+        for (int r = row - dr, c = col - dc; r >= 0 && r < b->size && c >= 0 && c < b->size && b->cells[r][c] == symbol; r -= dr, c -= dc)
+            count++;
+        if (count >= b->k)
+            return 1;
+    }
+    return 0;
+}
+
+/* Checks if every cell is taken */
+int board_full(const Board *b)
+{
+    return b->moves == b->size * b->size;
+}
+
+/* Returns the bitboard of a 3x3 board's cells holding the given symbol */
+unsigned board_mask(const Board *b, char symbol)
+{
+    unsigned mask = 0;
+    for (int i = 0; i < SIZE; i++)
+        for (int j = 0; j < SIZE; j++)
+            if (b->cells[i][j] == symbol)
+                mask |= 1u << (i * SIZE + j);
+    return mask;
+}
+
+/* Looks up the perfect move for the side owning 'own', who is to move.
+ * Returns the cell (3 * row + col), or -1 if the game is over; the outcome
+ * of perfect play for the mover is 1 (win), 0 (draw) or -1 (loss).
+ */
+int tablebase_move(unsigned own, unsigned opponent, int *outcome)
+{
+    unsigned char entry = tablebase[tablebase_digits[own] + 2 * tablebase_digits[opponent]];
+    if (entry == TABLEBASE_NONE)
+        return -1;
+    if (outcome)
+        *outcome = (entry >> 4) - 1;
+    return entry & 0x0F;
+}
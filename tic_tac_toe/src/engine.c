@@ -0,0 +1,214 @@
+/*******************************************************************************
+ * Headless Engines
+ *
+ * The computer players, callable without the console: each engine picks a
+ * move for either symbol on any board, and engine_play_game() plays a whole
+ * game between two of them. Nothing here prints or reads input, and all
+ * state lives in the arguments, so games can run on many threads at once.
+ *
+ * Randomness comes from a caller-seeded xorshift64* generator rather than
+ * rand(), so every game is reproducible from its seed.
+ ******************************************************************************/
+
+#include <string.h>
+#include "tic_tac_toe.h"
+
+static const char *engine_names[ENGINE_COUNT] = {"random", "human", "god", "mcts"};
+
+/*******************************************************************************
+ * Random Numbers
+ ******************************************************************************/
+
+/* Seeds a generator; any seed, zero included, gives a usable state */
+void rng_seed(uint64_t *state, uint64_t seed)
+{
+    // One splitmix64 step spreads nearby seeds far apart
+    uint64_t z = seed + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    *state = z ? z : 1;
+}
+
+/* Next 64 random bits (xorshift64*) */
+uint64_t rng_next(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1Dull;
+}
+
+/* Uniform number in [0, n) */
+int rng_below(uint64_t *state, int n)
+{
+    return (int)(((rng_next(state) >> 32) * (uint64_t)n) >> 32);
+}
+
+/*******************************************************************************
+ * Engines
+ ******************************************************************************/
+
+/* Picks one of the set bits of a 3x3 mask uniformly */
+static int random_cell(unsigned mask, uint64_t *rng)
+{
+    for (int choice = rng_below(rng, __builtin_popcount(mask)); choice > 0; choice--)
+        mask &= mask - 1;
+    return __builtin_ctz(mask);
+}
+
+/* Picks one of the empty cells uniformly */
+static void random_move(const Board *b, uint64_t *rng, int *row, int *col)
+{
+    int choice = rng_below(rng, b->size * b->size - b->moves);
+    for (int i = 0; i < b->size; i++)
+    {
+        for (int j = 0; j < b->size; j++)
+        {
+            if (b->cells[i][j] == ' ' && choice-- == 0)
+            {
+                *row = i;
+                *col = j;
+                return;
+            }
+        }
+    }
+}
+
+/* Returns 1 and the cell if 'symbol' can complete a line in one move */
+static int find_winning_cell(const Board *b, char symbol, int *row, int *col)
+{
+    Board probe = *b;
+    for (int i = 0; i < b->size; i++)
+    {
+        for (int j = 0; j < b->size; j++)
+        {
+            if (probe.cells[i][j] != ' ')
+                continue;
+            probe.cells[i][j] = symbol;
+            int wins = board_wins(&probe, i, j);
+            probe.cells[i][j] = ' ';
+            if (wins)
+            {
+                *row = i;
+                *col = j;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* Win if possible, else block the opponent's win, else play at random */
+static void human_move(const Board *b, char symbol, uint64_t *rng, int *row, int *col)
+{
+    if (b->size == SIZE)
+    {
+        // On 3x3 the threat table answers both questions with a lookup
+        unsigned own = board_mask(b, symbol), opponent = board_mask(b, symbol == 'X' ? 'O' : 'X');
+        unsigned free = ~(own | opponent) & ((1u << CELLS) - 1);
+        unsigned wins = threat_cells[own] & free, blocks = threat_cells[opponent] & free;
+        int cell = wins ? __builtin_ctz(wins) : blocks ? __builtin_ctz(blocks) : random_cell(free, rng);
+        *row = cell / SIZE;
+        *col = cell % SIZE;
+        return;
+    }
+
+    if (find_winning_cell(b, symbol, row, col) ||
+        find_winning_cell(b, symbol == 'X' ? 'O' : 'X', row, col))
+        return;
+    random_move(b, rng, row, col);
+}
+
+/* Perfect-play table on 3x3, timed search on anything larger */
+static void god_move(const Board *b, char symbol, int *row, int *col)
+{
+    if (b->size == SIZE && b->k == SIZE)
+    {
+        int cell = tablebase_move(board_mask(b, symbol), board_mask(b, symbol == 'X' ? 'O' : 'X'), NULL);
+        *row = cell / SIZE;
+        *col = cell % SIZE;
+        return;
+    }
+
+    SearchResult result;
+    search_best_move(b, symbol, search_time_ms, &result);
+    *row = result.row;
+    *col = result.col;
+}
+
+/* Monte Carlo tree search with the configured budget */
+static int mcts_move(const Board *b, char symbol, uint64_t *rng, int *row, int *col)
+{
+    MctsResult result;
+    if (!mcts_best_move(b, symbol, mcts_iterations, search_time_ms, rng, &result))
+        return 0;
+    *row = result.row;
+    *col = result.col;
+    return 1;
+}
+
+/* Picks a move for 'symbol'. Returns 0 if the board is full, the engine
+ * is unknown or it could not search (MCTS out of memory).
+ */
+int engine_move(int engine, const Board *b, char symbol, uint64_t *rng, int *row, int *col)
+{
+    if (board_full(b))
+        return 0;
+
+    switch (engine)
+    {
+    case ENGINE_RANDOM:
+        random_move(b, rng, row, col);
+        return 1;
+    case ENGINE_HUMAN:
+        human_move(b, symbol, rng, row, col);
+        return 1;
+    case ENGINE_GOD:
+        god_move(b, symbol, row, col);
+        return 1;
+    case ENGINE_MCTS:
+        return mcts_move(b, symbol, rng, row, col);
+    default:
+        return 0;
+    }
+}
+
+/* Plays a game from an empty board. Returns the winner's symbol, or 'D' for a draw */
+char engine_play_game(int x_engine, int o_engine, int size, int k, char first, uint64_t *rng)
+{
+    Board b;
+    if (!board_init(&b, size, k))
+        return 'D';
+
+    char side = first;
+    while (1)
+    {
+        int row, col;
+        if (!engine_move(side == 'X' ? x_engine : o_engine, &b, side, rng, &row, &col))
+            return 'D';
+        board_play(&b, row, col, side);
+        if (board_wins(&b, row, col))
+            return side;
+        if (board_full(&b))
+            return 'D';
+        side = side == 'X' ? 'O' : 'X';
+    }
+}
+
+/* Name of an engine, as used on the command line */
+const char *engine_name(int engine)
+{
+    return engine >= 0 && engine < ENGINE_COUNT ? engine_names[engine] : "unknown";
+}
+
+/* Engine with the given name, or -1 */
+int engine_lookup(const char *name)
+{
+    for (int engine = 0; engine < ENGINE_COUNT; engine++)
+        if (strcmp(name, engine_names[engine]) == 0)
+            return engine;
+    return -1;
+}
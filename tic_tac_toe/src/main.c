@@ -0,0 +1,63 @@
+/*******************************************************************************
+ * Tic Tac Toe Entry Point
+ *
+ * Usage: tic_tac_toe [--size N] [--win K] [--time milliseconds] [--threads N]
+ *                    [--playouts N]
+ *   --size  Board size, 3 to 15 (default 3)
+ *   --win   Stones in a row needed to win (default: the board size)
+ *   --time  Computer's thinking time per move on boards beyond 3x3
+ *           (default 1000)
+ *   --threads  Threads searching each move (beyond 3x3 for God)
+ *           (default: one per CPU)
+ *   --playouts  Playouts per move of the Monte Carlo player; 0 makes it
+ *           think for the --time budget instead (default 20000)
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "tic_tac_toe.h"
+
+/*******************************************************************************
+ * Main Function
+ *
+ * Entry point of the program. Handles game initialization and replay logic.
+ * Returns: 0 on successful execution, 1 on invalid arguments
+ ******************************************************************************/
+int main(int argc, char *argv[])
+{
+    int win_given = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+            board_size = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--win") == 0 && i + 1 < argc)
+        {
+            win_length = atoi(argv[++i]);
+            win_given = 1;
+        }
+        else if (strcmp(argv[i], "--time") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+            search_time_ms = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+        {
+            search_set_threads(atoi(argv[i + 1]));
+            mcts_set_threads(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--playouts") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 0)
+            mcts_iterations = atoi(argv[++i]);
+        else
+            board_size = 0; // Reported as a usage error below
+    }
+    if (!win_given)
+        win_length = board_size;
+    if (!board_init(&board, board_size, win_length))
+    {
+        fprintf(stderr, "Usage: %s [--size 3-%d] [--win 3-size] [--time milliseconds] [--threads N] [--playouts N]\n", argv[0], MAX_SIZE);
+        return 1;
+    }
+
+    rng_seed(&game_rng, (uint64_t)time(0)); // Seed random number generator
+    play_games();
+    return 0;
+}
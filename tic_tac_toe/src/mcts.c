@@ -0,0 +1,359 @@
+/*******************************************************************************
+ * Monte Carlo Tree Search
+ *
+ * Plays any board without an evaluator: each iteration walks down the tree
+ * of moves tried so far, adds one new move, finishes the game with random
+ * moves and credits the result to every move on the way.
+ *
+ * - Moves are chosen by UCT: the child maximising its average score plus
+ *   UCT_EXPLORATION * sqrt(ln(parent visits) / child visits), so promising
+ *   moves get most of the playouts while none is ignored for long.
+ * - Nodes live in one array that doubles when full and are linked by
+ *   index, so growing the tree never allocates per node. Wins count two
+ *   half-points and draws one, kept as integers.
+ * - Playouts copy the board and keep its empty cells in a list, so each
+ *   random move is one pick and one win check through the placed stone.
+ * - The budget is a number of iterations or a time limit.
+ * - With several threads all of them grow the same tree. The tree is
+ *   locked while walking down and while crediting a result, but not
+ *   during playouts. Visits are counted on the way down, as losses until
+ *   the result comes in, which steers the other threads elsewhere.
+ ******************************************************************************/
+
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "tic_tac_toe.h"
+
+#define MAX_CELLS (MAX_SIZE * MAX_SIZE)
+#define UCT_EXPLORATION 1.0
+#define INITIAL_NODES 4096
+#define MAX_NODES (1 << 22) // Beyond this the tree stops growing
+#define CHECK_INTERVAL 63   // Iterations between clock reads, minus one
+#define MAX_WORKERS 64
+
+typedef struct
+{
+    int parent;             // -1 for the root
+    int child;              // First child, -1 if none
+    int sibling;            // Next child of the parent, -1 if last
+    unsigned char row, col; // Move leading here
+    char mover;             // Who played it
+    char result;            // Winner if the move ended the game, 'D' for a draw, else 0
+    unsigned short untried; // Moves not yet added as children
+    unsigned visits;
+    unsigned score; // Half-points for 'mover'
+} Node;
+
+typedef struct
+{
+    pthread_mutex_t lock; // Guards everything below
+    Node *nodes;
+    int count, capacity;
+    Board root;
+    long iterations; // Started so far
+    long budget;     // 0: until the deadline
+    struct timespec deadline;
+    int stopped;
+} Tree;
+
+typedef struct
+{
+    Tree *tree;
+    uint64_t rng;
+} Worker;
+
+int mcts_iterations = 20000; // 0: think for search_time_ms instead
+static int mcts_threads = 0; // 0: one per online CPU
+static ThreadPool *pool = NULL;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*******************************************************************************
+ * Tree
+ ******************************************************************************/
+
+static char symbol_after(char symbol)
+{
+    return symbol == 'X' ? 'O' : 'X';
+}
+
+/* Adds a node for the move just played on 'b'. Returns -1 if the tree is full */
+static int add_node(Tree *tree, int parent, const Board *b)
+{
+    if (tree->count == tree->capacity)
+    {
+        if (tree->capacity >= MAX_NODES)
+            return -1;
+        Node *nodes = (Node *)realloc(tree->nodes, 2 * tree->capacity * sizeof(Node));
+        if (!nodes)
+            return -1;
+        tree->nodes = nodes;
+        tree->capacity *= 2;
+    }
+
+    int index = tree->count++;
+    Node *node = &tree->nodes[index];
+    node->parent = parent;
+    node->child = -1;
+    node->sibling = -1;
+    node->row = (unsigned char)b->last_row;
+    node->col = (unsigned char)b->last_col;
+    node->visits = 0;
+    node->score = 0;
+    if (parent < 0)
+    {
+        node->mover = 0;
+        node->result = 0;
+    }
+    else
+    {
+        node->mover = b->cells[b->last_row][b->last_col];
+        node->result = board_wins(b, b->last_row, b->last_col) ? node->mover : board_full(b) ? 'D' : 0;
+        node->sibling = tree->nodes[parent].child;
+        tree->nodes[parent].child = index;
+    }
+    node->untried = node->result ? 0 : (unsigned short)(b->size * b->size - b->moves);
+    return index;
+}
+
+/* Child of 'parent' with the highest UCT value */
+static int select_child(const Tree *tree, int parent)
+{
+    double log_visits = log((double)tree->nodes[parent].visits);
+    double best_value = -1;
+    int best = -1;
+    for (int child = tree->nodes[parent].child; child >= 0; child = tree->nodes[child].sibling)
+    {
+        const Node *node = &tree->nodes[child];
+        double value = node->score / (2.0 * node->visits) + UCT_EXPLORATION * sqrt(log_visits / node->visits);
+        if (value > best_value)
+        {
+            best_value = value;
+            best = child;
+        }
+    }
+    return best;
+}
+
+/* Plays a random move not yet among the children of 'parent' */
+static void play_untried(const Tree *tree, int parent, Board *b, char side, uint64_t *rng)
+{
+    unsigned char tried[MAX_SIZE][MAX_SIZE] = {{0}};
+    for (int child = tree->nodes[parent].child; child >= 0; child = tree->nodes[child].sibling)
+        tried[tree->nodes[child].row][tree->nodes[child].col] = 1;
+
+    int choice = rng_below(rng, tree->nodes[parent].untried);
+    for (int i = 0; i < b->size; i++)
+    {
+        for (int j = 0; j < b->size; j++)
+        {
+            if (b->cells[i][j] == ' ' && !tried[i][j] && choice-- == 0)
+            {
+                board_play(b, i, j, side);
+                return;
+            }
+        }
+    }
+}
+
+/* Finishes the game with random moves. Returns the winner or 'D' */
+static char playout(Board *b, char side, uint64_t *rng)
+{
+    unsigned char empty[MAX_CELLS][2];
+    int count = 0;
+    for (int i = 0; i < b->size; i++)
+    {
+        for (int j = 0; j < b->size; j++)
+        {
+            if (b->cells[i][j] == ' ')
+            {
+                empty[count][0] = (unsigned char)i;
+                empty[count][1] = (unsigned char)j;
+                count++;
+            }
+        }
+    }
+
+    while (count > 0)
+    {
+        int pick = rng_below(rng, count);
+        int row = empty[pick][0], col = empty[pick][1];
+        empty[pick][0] = empty[count - 1][0];
+        empty[pick][1] = empty[count - 1][1];
+        count--;
+        board_play(b, row, col, side);
+        if (board_wins(b, row, col))
+            return side;
+        side = symbol_after(side);
+    }
+    return 'D';
+}
+
+static int past_deadline(const struct timespec *deadline)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec > deadline->tv_sec || (now.tv_sec == deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec);
+}
+
+/* Runs iterations until the tree's budget is spent */
+static void grow_tree(void *arg)
+{
+    Worker *worker = (Worker *)arg;
+    Tree *tree = worker->tree;
+
+    for (long done = 0;; done++)
+    {
+        int timed_out = tree->budget == 0 && done > 0 && (done & CHECK_INTERVAL) == 0 && past_deadline(&tree->deadline);
+        Board b = tree->root;
+
+        // Select and expand, counting the visits as losses for now
+        pthread_mutex_lock(&tree->lock);
+        if (timed_out)
+            tree->stopped = 1;
+        if (tree->stopped || (tree->budget > 0 && tree->iterations >= tree->budget))
+        {
+            pthread_mutex_unlock(&tree->lock);
+            return;
+        }
+        tree->iterations++;
+        int node = 0;
+        char side = symbol_after(tree->nodes[0].mover);
+        tree->nodes[0].visits++;
+        while (!tree->nodes[node].result)
+        {
+            if (tree->nodes[node].untried > 0)
+            {
+                play_untried(tree, node, &b, side, &worker->rng);
+                side = symbol_after(side);
+                int child = add_node(tree, node, &b);
+                if (child < 0)
+                    break; // Tree full: play out from here without a node
+                tree->nodes[node].untried--;
+                node = child;
+                tree->nodes[node].visits++;
+                break;
+            }
+            node = select_child(tree, node);
+            board_play(&b, tree->nodes[node].row, tree->nodes[node].col, side);
+            side = symbol_after(side);
+            tree->nodes[node].visits++;
+        }
+        char result = tree->nodes[node].result;
+        pthread_mutex_unlock(&tree->lock);
+
+        if (!result)
+            result = playout(&b, side, &worker->rng);
+
+        pthread_mutex_lock(&tree->lock);
+        for (; node >= 0; node = tree->nodes[node].parent)
+            tree->nodes[node].score += result == 'D' ? 1 : result == tree->nodes[node].mover ? 2 : 0;
+        pthread_mutex_unlock(&tree->lock);
+    }
+}
+
+/* Returns the pool for extra tree workers, started on first use, or NULL
+ * to search on the calling thread alone.
+ */
+static ThreadPool *get_pool()
+{
+    pthread_mutex_lock(&pool_lock);
+    int threads = mcts_threads > 0 ? mcts_threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (!pool && threads > 1)
+        pool = pool_create(threads - 1);
+    ThreadPool *current = pool;
+    pthread_mutex_unlock(&pool_lock);
+    return current;
+}
+
+/*******************************************************************************
+ * Interface
+ ******************************************************************************/
+
+/* Finds a move for 'symbol' with 'iterations' playouts, or within
+ * time_limit_ms milliseconds if iterations is 0. Returns 1 if a move was
+ * found.
+ */
+int mcts_best_move(const Board *b, char symbol, long iterations, int time_limit_ms, uint64_t *rng, MctsResult *result)
+{
+    result->row = result->col = -1;
+    result->iterations = 0;
+    result->win_rate = 0;
+    if (board_full(b))
+        return 0;
+
+    Tree tree;
+    tree.capacity = iterations > 0 && iterations < INITIAL_NODES ? (int)iterations + 1 : INITIAL_NODES;
+    tree.nodes = (Node *)malloc(tree.capacity * sizeof(Node));
+    if (!tree.nodes)
+        return 0;
+    pthread_mutex_init(&tree.lock, NULL);
+    tree.count = 0;
+    tree.root = *b;
+    tree.iterations = 0;
+    tree.budget = iterations > 0 ? iterations : 0;
+    tree.stopped = 0;
+    add_node(&tree, -1, b);
+    tree.nodes[0].mover = symbol_after(symbol);
+
+    clock_gettime(CLOCK_MONOTONIC, &tree.deadline);
+    tree.deadline.tv_sec += time_limit_ms / 1000;
+    tree.deadline.tv_nsec += (long)(time_limit_ms % 1000) * 1000000;
+    if (tree.deadline.tv_nsec >= 1000000000)
+    {
+        tree.deadline.tv_sec++;
+        tree.deadline.tv_nsec -= 1000000000;
+    }
+
+    // The calling thread grows the tree too
+    ThreadPool *workers = get_pool();
+    int threads = mcts_threads > 0 ? mcts_threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    Worker helpers[MAX_WORKERS];
+    Worker self = {&tree, 0};
+    rng_seed(&self.rng, rng_next(rng));
+    if (workers && threads > 1)
+    {
+        PoolBatch batch = {0};
+        for (int i = 0; i < threads - 1 && i < MAX_WORKERS; i++)
+        {
+            helpers[i].tree = &tree;
+            rng_seed(&helpers[i].rng, rng_next(rng));
+            pool_submit(workers, &batch, grow_tree, &helpers[i]);
+        }
+        grow_tree(&self);
+        pool_wait(workers, &batch);
+    }
+    else
+    {
+        grow_tree(&self);
+    }
+
+    // The most visited move is the most trusted one
+    int best = -1;
+    for (int child = tree.nodes[0].child; child >= 0; child = tree.nodes[child].sibling)
+        if (best < 0 || tree.nodes[child].visits > tree.nodes[best].visits)
+            best = child;
+    if (best >= 0)
+    {
+        result->row = tree.nodes[best].row;
+        result->col = tree.nodes[best].col;
+        result->win_rate = tree.nodes[best].score / (2.0 * tree.nodes[best].visits);
+    }
+    result->iterations = tree.iterations;
+
+    pthread_mutex_destroy(&tree.lock);
+    free(tree.nodes);
+    return best >= 0;
+}
+
+/* Sets the threads growing each tree (0: one per CPU, 1: no pool) */
+void mcts_set_threads(int threads)
+{
+    pthread_mutex_lock(&pool_lock);
+    pool_destroy(pool);
+    pool = NULL;
+    mcts_threads = threads;
+    pthread_mutex_unlock(&pool_lock);
+}
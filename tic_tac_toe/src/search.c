@@ -0,0 +1,444 @@
+/*******************************************************************************
+ * Alpha-Beta Search for Larger Boards
+ *
+ * Exhaustive search stops being possible past 3x3, so on larger boards the
+ * computer searches a few moves ahead and judges the positions it reaches
+ * with a heuristic evaluator:
+ *
+ * - Every window of k cells in a row, column or diagonal that holds stones
+ *   of only one player is worth weights[n] to that player, n being its
+ *   stones. Weights grow geometrically, so one window close to a win
+ *   outweighs many scattered stones. The sum is updated move by move from
+ *   the windows through the changed cell instead of rescanning the board.
+ * - Only empty cells near existing stones are tried, best looking first:
+ *   cells that extend the mover's windows or block the opponent's.
+ *   On large boards only the first MAX_BRANCH of them are searched.
+ * - Iterative deepening searches to depth 1, 2, 3, ... until the time budget
+ *   runs out, and starts each iteration with the best moves of the last.
+ *   The answer of the deepest completed iteration is played, so the
+ *   computer always moves on time.
+ * - The root moves of each iteration are shared out over a work-stealing
+ *   thread pool, each searched on the worker's own copy of the position.
+ *   The most promising move is searched first, alone, so that the others
+ *   start with its score as their bound; each root move raises the shared
+ *   bound as soon as it finishes.
+ ******************************************************************************/
+
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "tic_tac_toe.h"
+
+#define MAX_CELLS (MAX_SIZE * MAX_SIZE)
+#define MAX_BRANCH 12      // Moves tried per node below the root on boards over 5x5
+#define CHECK_INTERVAL 1023 // Nodes between clock reads, minus one
+#define INFINITE_SCORE (SEARCH_WIN + 1)
+
+typedef struct
+{
+    Board board;
+    long eval;                              // Heuristic value of the board for 'O'
+    long weights[MAX_SIZE + 1];             // Value of a window holding n stones of one player
+    int radius;                             // Moves are tried this close to a stone
+    unsigned char near[MAX_SIZE][MAX_SIZE]; // Stones within radius of each cell
+    unsigned long nodes;
+    struct timespec deadline;
+    int timed;
+    int stopped;
+} SearchState;
+
+typedef struct
+{
+    int row, col;
+    long score;
+} Move;
+
+/* State shared by the root moves of one iteration */
+typedef struct
+{
+    pthread_mutex_t lock;
+    long alpha; // Best score found so far
+    int best;   // Root move that scored it
+    unsigned long nodes;
+    int stopped; // Some root move ran out of time
+} RootShared;
+
+typedef struct
+{
+    const SearchState *root; // Copied by the thread that runs the task
+    Move *move;
+    int index;
+    char symbol;
+    int depth;
+    RootShared *shared;
+} RootTask;
+
+static int search_threads = 0;   // 0: one per online CPU
+static int search_max_depth = 0; // 0: until the game ends
+static ThreadPool *pool = NULL;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Line directions: across, down, down-right, down-left */
+static const int directions[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+
+/*******************************************************************************
+ * Evaluation
+ ******************************************************************************/
+
+/* Counts the stones of each player in the window of k cells from (row, col).
+ * Returns 0 if the window runs off the board.
+ */
+static int count_window(const Board *b, int row, int col, int d, int *o, int *x)
+{
+    int end_row = row + (b->k - 1) * directions[d][0], end_col = col + (b->k - 1) * directions[d][1];
+    if (row < 0 || row >= b->size || col < 0 || col >= b->size ||
+        end_row < 0 || end_row >= b->size || end_col < 0 || end_col >= b->size)
+        return 0;
+
+    *o = *x = 0;
+    for (int i = 0; i < b->k; i++)
+    {
+        char cell = b->cells[row + i * directions[d][0]][col + i * directions[d][1]];
+        *o += cell == 'O';
+        *x += cell == 'X';
+    }
+    return 1;
+}
+
+/* Value for 'O' of every window through the cell */
+static long windows_through(const SearchState *s, int row, int col)
+{
+    const Board *b = &s->board;
+    long total = 0;
+    for (int d = 0; d < 4; d++)
+    {
+        for (int t = 0; t < b->k; t++)
+        {
+            int o, x;
+            if (!count_window(b, row - t * directions[d][0], col - t * directions[d][1], d, &o, &x))
+                continue;
+            if (x == 0)
+                total += s->weights[o];
+            else if (o == 0)
+                total -= s->weights[x];
+        }
+    }
+    return total;
+}
+
+/* How promising an empty cell is for the side to move: what it builds
+ * for that side, and (at half weight) what it takes from the opponent
+ */
+static long move_potential(const SearchState *s, int row, int col, char side)
+{
+    const Board *b = &s->board;
+    long total = 0;
+    for (int d = 0; d < 4; d++)
+    {
+        for (int t = 0; t < b->k; t++)
+        {
+            int o, x;
+            if (!count_window(b, row - t * directions[d][0], col - t * directions[d][1], d, &o, &x))
+                continue;
+            int own = side == 'O' ? o : x, other = side == 'O' ? x : o;
+            if (other == 0)
+                total += 2 * s->weights[own + 1];
+            if (own == 0)
+                total += s->weights[other + 1];
+        }
+    }
+    return total;
+}
+
+/* Recomputes the evaluation and neighbourhood counts from scratch */
+static void init_state(SearchState *s, const Board *b)
+{
+    s->board = *b;
+    s->nodes = 0;
+    s->timed = s->stopped = 0;
+    s->radius = b->size <= 5 ? b->size : 2;
+
+    // weights[k - 1] is 2^16 whatever k is; weights[k] marks a win
+    s->weights[0] = 0;
+    for (int n = 1; n < b->k; n++)
+        s->weights[n] = 1L << (16 * n / (b->k - 1));
+    s->weights[b->k] = 1L << 20;
+
+    s->eval = 0;
+    for (int row = 0; row < b->size; row++)
+    {
+        for (int col = 0; col < b->size; col++)
+        {
+            s->near[row][col] = 0;
+            for (int d = 0; d < 4; d++)
+            {
+                int o, x;
+                if (count_window(b, row, col, d, &o, &x))
+                    s->eval += x == 0 ? s->weights[o] : o == 0 ? -s->weights[x] : 0;
+            }
+        }
+    }
+    for (int row = 0; row < b->size; row++)
+        for (int col = 0; col < b->size; col++)
+            if (b->cells[row][col] != ' ')
+                for (int r = row - s->radius; r <= row + s->radius; r++)
+                    for (int c = col - s->radius; c <= col + s->radius; c++)
+                        if (r >= 0 && r < b->size && c >= 0 && c < b->size)
+                            s->near[r][c]++;
+}
+
+static void make_move(SearchState *s, int row, int col, char side, int step)
+{
+    s->eval -= windows_through(s, row, col);
+    if (step > 0)
+        board_play(&s->board, row, col, side);
+    else
+        board_undo(&s->board, row, col);
+    s->eval += windows_through(s, row, col);
+
+    for (int r = row - s->radius; r <= row + s->radius; r++)
+        for (int c = col - s->radius; c <= col + s->radius; c++)
+            if (r >= 0 && r < s->board.size && c >= 0 && c < s->board.size)
+                s->near[r][c] += step;
+}
+
+/*******************************************************************************
+ * Search
+ ******************************************************************************/
+
+/* Lists the moves worth trying, most promising first. Returns their number */
+static int generate_moves(const SearchState *s, char side, Move *moves)
+{
+    const Board *b = &s->board;
+    int count = 0;
+    // If every cell near a stone is taken, the second pass takes any cell
+    for (int pass = 0; pass < 2 && count == 0; pass++)
+    {
+        for (int row = 0; row < b->size; row++)
+        {
+            for (int col = 0; col < b->size; col++)
+            {
+                // Before the first stone nothing is near anything: start in the center
+                int wanted = pass == 1 || (b->moves == 0 ? row == b->size / 2 && col == b->size / 2 : s->near[row][col] > 0);
+                if (b->cells[row][col] != ' ' || !wanted)
+                    continue;
+
+                Move move = {row, col, move_potential(s, row, col, side)};
+                int i = count++;
+                for (; i > 0 && moves[i - 1].score < move.score; i--)
+                    moves[i] = moves[i - 1];
+                moves[i] = move;
+            }
+        }
+    }
+    return count;
+}
+
+static int out_of_time(SearchState *s)
+{
+    if (s->timed && (s->nodes & CHECK_INTERVAL) == 0)
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > s->deadline.tv_sec || (now.tv_sec == s->deadline.tv_sec && now.tv_nsec >= s->deadline.tv_nsec))
+            s->stopped = 1;
+    }
+    return s->stopped;
+}
+
+/* Plays a move and scores it for the player making it */
+static long score_move(SearchState *s, const Move *move, char side, int depth, long alpha, long beta, int ply);
+
+/* Negamax value, for the side to move, of the position 'ply' moves from the root */
+static long negamax(SearchState *s, char side, int depth, long alpha, long beta, int ply)
+{
+    s->nodes++;
+    if (out_of_time(s))
+        return 0;
+    if (depth == 0)
+    {
+        long value = side == 'O' ? s->eval : -s->eval;
+        return value >= SEARCH_WIN / 2 ? SEARCH_WIN / 2 : value <= -SEARCH_WIN / 2 ? -SEARCH_WIN / 2 : value;
+    }
+
+    Move moves[MAX_CELLS];
+    int count = generate_moves(s, side, moves);
+    if (s->board.size > 5 && count > MAX_BRANCH)
+        count = MAX_BRANCH;
+
+    long best_score = -INFINITE_SCORE;
+    for (int i = 0; i < count && alpha < beta; i++)
+    {
+        long score = score_move(s, &moves[i], side, depth, alpha, beta, ply);
+        if (score > best_score)
+            best_score = score;
+        if (score > alpha)
+            alpha = score;
+    }
+    return count > 0 ? best_score : 0;
+}
+
+static long score_move(SearchState *s, const Move *move, char side, int depth, long alpha, long beta, int ply)
+{
+    long score;
+    make_move(s, move->row, move->col, side, 1);
+    if (board_wins(&s->board, move->row, move->col))
+        score = SEARCH_WIN - ply - 1;
+    else if (board_full(&s->board))
+        score = 0;
+    else
+        score = -negamax(s, side == 'O' ? 'X' : 'O', depth - 1, -beta, -alpha, ply + 1);
+    make_move(s, move->row, move->col, side, -1);
+    return score;
+}
+
+/* Searches one root move on a private copy of the position */
+static void search_root_move(void *arg)
+{
+    RootTask *task = (RootTask *)arg;
+    SearchState state = *task->root;
+    state.nodes = 0;
+
+    pthread_mutex_lock(&task->shared->lock);
+    long alpha = task->shared->alpha;
+    pthread_mutex_unlock(&task->shared->lock);
+
+    long score = score_move(&state, task->move, task->symbol, task->depth, alpha, INFINITE_SCORE, 0);
+
+    pthread_mutex_lock(&task->shared->lock);
+    task->shared->nodes += state.nodes;
+    if (state.stopped)
+        task->shared->stopped = 1;
+    task->move->score = score;
+    if (score > task->shared->alpha)
+    { // Only exact scores can beat the bound the search started with
+        task->shared->alpha = score;
+        task->shared->best = task->index;
+    }
+    pthread_mutex_unlock(&task->shared->lock);
+}
+
+/* Returns the pool for root moves, started on first use, or NULL to search
+ * on the calling thread alone. The caller works too, so the pool has one
+ * worker fewer than the threads wanted.
+ */
+static ThreadPool *get_pool()
+{
+    pthread_mutex_lock(&pool_lock);
+    int threads = search_threads > 0 ? search_threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (!pool && threads > 1)
+        pool = pool_create(threads - 1);
+    ThreadPool *current = pool;
+    pthread_mutex_unlock(&pool_lock);
+    return current;
+}
+
+/* Finds a move for 'symbol' within time_limit_ms milliseconds (0: no limit,
+ * search to the end of the game). Returns 1 if a move was found.
+ */
+int search_best_move(const Board *b, char symbol, int time_limit_ms, SearchResult *result)
+{
+    SearchState state;
+    SearchState *s = &state;
+    init_state(s, b);
+    result->row = result->col = -1;
+    result->score = result->depth = 0;
+
+    Move moves[MAX_CELLS];
+    int count = generate_moves(s, symbol, moves);
+    if (count == 0)
+    {
+        result->nodes = 0;
+        return 0;
+    }
+    result->row = moves[0].row;
+    result->col = moves[0].col;
+
+    clock_gettime(CLOCK_MONOTONIC, &s->deadline);
+    s->deadline.tv_sec += time_limit_ms / 1000;
+    s->deadline.tv_nsec += (long)(time_limit_ms % 1000) * 1000000;
+    if (s->deadline.tv_nsec >= 1000000000)
+    {
+        s->deadline.tv_sec++;
+        s->deadline.tv_nsec -= 1000000000;
+    }
+
+    ThreadPool *workers = count > 1 ? get_pool() : NULL;
+    RootTask tasks[MAX_CELLS];
+    RootShared shared;
+    pthread_mutex_init(&shared.lock, NULL);
+    shared.nodes = 0;
+
+    int empty = b->size * b->size - b->moves;
+    int last_depth = search_max_depth > 0 && search_max_depth < empty ? search_max_depth : empty;
+    for (int depth = 1; depth <= last_depth; depth++)
+    {
+        shared.alpha = -INFINITE_SCORE;
+        shared.best = 0;
+        shared.stopped = 0;
+        for (int i = 0; i < count; i++)
+        {
+            RootTask task = {s, &moves[i], i, symbol, depth, &shared};
+            tasks[i] = task;
+        }
+
+        search_root_move(&tasks[0]);
+        if (workers && !shared.stopped)
+        {
+            PoolBatch batch = {0};
+            for (int i = 1; i < count; i++)
+                pool_submit(workers, &batch, search_root_move, &tasks[i]);
+            pool_wait(workers, &batch);
+        }
+        else
+        {
+            for (int i = 1; i < count && !shared.stopped; i++)
+                search_root_move(&tasks[i]);
+        }
+        long alpha = shared.alpha;
+        if (shared.stopped)
+            break; // Keep the answer of the last complete iteration
+
+        // Best first for the next iteration, then the others by their scores,
+        // most of which are only upper bounds
+        Move best = moves[shared.best];
+        moves[shared.best] = moves[0];
+        moves[0] = best;
+        for (int i = 2; i < count; i++)
+        {
+            Move move = moves[i];
+            int j = i;
+            for (; j > 1 && moves[j - 1].score < move.score; j--)
+                moves[j] = moves[j - 1];
+            moves[j] = move;
+        }
+        result->row = moves[0].row;
+        result->col = moves[0].col;
+        result->score = (int)moves[0].score;
+        result->depth = depth;
+
+        // The first iteration always completes; later ones race the clock
+        s->timed = time_limit_ms > 0;
+        if (count == 1 || alpha >= SEARCH_WIN - MAX_CELLS || alpha <= -(SEARCH_WIN - MAX_CELLS))
+            break;
+    }
+    pthread_mutex_destroy(&shared.lock);
+    result->nodes = shared.nodes;
+    return 1;
+}
+
+/* Sets the threads searching each move (0: one per CPU, 1: no pool) */
+void search_set_threads(int threads)
+{
+    pthread_mutex_lock(&pool_lock);
+    pool_destroy(pool);
+    pool = NULL;
+    search_threads = threads;
+    pthread_mutex_unlock(&pool_lock);
+}
+
+/* Caps the depth of every search (0: no cap) */
+void search_set_max_depth(int depth)
+{
+    search_max_depth = depth;
+}
@@ -0,0 +1,94 @@
+/*******************************************************************************
+ * Tablebase Generator
+ *
+ * Build step that solves every 3x3 position once and prints the results as
+ * C source (src/tablebase.c), so the game itself never searches on 3x3.
+ *
+ * Positions are indexed from the point of view of the side to move: cell i
+ * contributes 3^i if it holds one of the mover's stones and 2 * 3^i if it
+ * holds one of the opponent's. Each entry is one byte, the best cell in the
+ * low nibble and the outcome for the mover (0 loss, 1 draw, 2 win) above it,
+ * or TABLEBASE_NONE for a position that cannot occur with the mover to move
+ * or where the game is already over.
+ *
+ * Alongside it goes the threat table: for every mask of one player's stones,
+ * the cells that would complete a line of theirs, whether free or not.
+ *
+ * Usage: tablebase_gen > src/tablebase.c
+ ******************************************************************************/
+
+#include <stdio.h>
+#include "tic_tac_toe.h"
+
+static const unsigned win_masks[8] = {0x007, 0x038, 0x1C0, 0x049, 0x092, 0x124, 0x111, 0x054};
+
+static int has_line(unsigned mask)
+{
+    for (int i = 0; i < 8; i++)
+        if ((mask & win_masks[i]) == win_masks[i])
+            return 1;
+    return 0;
+}
+
+int main()
+{
+    static unsigned char entries[TABLEBASE_SIZE];
+    int positions = 0;
+
+    for (int index = 0; index < TABLEBASE_SIZE; index++)
+    {
+        // Decode the base-3 digits into the two players' masks
+        unsigned own = 0, opponent = 0;
+        for (int cell = 0, rest = index; cell < CELLS; cell++, rest /= 3)
+        {
+            if (rest % 3 == 1)
+                own |= 1u << cell;
+            else if (rest % 3 == 2)
+                opponent |= 1u << cell;
+        }
+
+        // The mover has as many stones as the opponent, or one fewer
+        int own_count = __builtin_popcount(own), opponent_count = __builtin_popcount(opponent);
+        entries[index] = TABLEBASE_NONE;
+        if ((own_count != opponent_count && own_count + 1 != opponent_count) ||
+            has_line(own) || has_line(opponent) || own_count + opponent_count == CELLS)
+            continue;
+
+        int score;
+        int cell = bitboard_best_move(own, opponent, &score);
+        int outcome = score > 0 ? 2 : score == 0 ? 1 : 0;
+        entries[index] = (unsigned char)(cell | outcome << 4);
+        positions++;
+    }
+
+    printf("/* Perfect-play table for 3x3 tic tac toe: %d positions.\n", positions);
+    printf(" * Generated by tablebase_gen, see tablebase_gen.c for the layout. Do not edit.\n */\n\n");
+    printf("#include \"tic_tac_toe.h\"\n\n");
+
+    printf("const unsigned short tablebase_digits[1 << CELLS] = {");
+    for (unsigned mask = 0; mask < (1u << CELLS); mask++)
+    {
+        unsigned digits = 0;
+        for (int cell = CELLS - 1; cell >= 0; cell--)
+            digits = digits * 3 + ((mask >> cell) & 1);
+        printf("%s%u,", mask % 16 ? " " : "\n    ", digits);
+    }
+    printf("\n};\n\n");
+
+    printf("const unsigned short threat_cells[1 << CELLS] = {");
+    for (unsigned mask = 0; mask < (1u << CELLS); mask++)
+    {
+        unsigned threats = 0;
+        for (int i = 0; i < 8; i++)
+            if (__builtin_popcount(mask & win_masks[i]) == 2)
+                threats |= win_masks[i] & ~mask;
+        printf("%s%u,", mask % 16 ? " " : "\n    ", threats);
+    }
+    printf("\n};\n\n");
+
+    printf("const unsigned char tablebase[TABLEBASE_SIZE] = {");
+    for (int index = 0; index < TABLEBASE_SIZE; index++)
+        printf("%s%u,", index % 24 ? " " : "\n    ", entries[index]);
+    printf("\n};\n");
+    return 0;
+}
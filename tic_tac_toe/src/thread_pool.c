@@ -0,0 +1,273 @@
+/*******************************************************************************
+ * Work-Stealing Thread Pool
+ *
+ * Each worker owns a queue of tasks. Submitted tasks are spread over the
+ * queues round-robin; a worker runs tasks from the back of its own queue
+ * and, once that is empty, steals from the front of the others', so no
+ * core idles while another still has work queued. A thread waiting for a
+ * batch of tasks runs queued tasks too instead of blocking.
+ *
+ * Tasks are grouped in caller-owned batches, so several threads can share
+ * one pool and each wait for its own work only.
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "tic_tac_toe.h"
+
+#define QUEUE_CAPACITY 256 // Tasks per worker queue; beyond that they run inline
+
+typedef struct
+{
+    PoolTask function;
+    void *arg;
+    PoolBatch *batch;
+} Task;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    Task tasks[QUEUE_CAPACITY];
+    unsigned head, tail; // Stolen from head, owner takes from tail
+} WorkQueue;
+
+struct ThreadPool
+{
+    int threads; // Queues, one per worker
+    int started; // Workers actually running; the others' queues get stolen from
+    pthread_t *workers;
+    WorkQueue *queues;
+    pthread_mutex_t lock; // Guards everything below and batch counters
+    pthread_cond_t work_ready;
+    pthread_cond_t batch_done;
+    int queued; // Tasks waiting in any queue
+    int shutting_down;
+    unsigned next_queue;
+};
+
+typedef struct
+{
+    ThreadPool *pool;
+    int id;
+} WorkerStart;
+
+/*******************************************************************************
+ * Queues
+ ******************************************************************************/
+
+static int take_own(WorkQueue *queue, Task *task)
+{
+    int found = 0;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->head != queue->tail)
+    {
+        *task = queue->tasks[--queue->tail % QUEUE_CAPACITY];
+        found = 1;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return found;
+}
+
+static int steal(WorkQueue *queue, Task *task)
+{
+    int found = 0;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->head != queue->tail)
+    {
+        *task = queue->tasks[queue->head++ % QUEUE_CAPACITY];
+        found = 1;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return found;
+}
+
+/* Finds a task, own queue first (id < 0 for a thread without one) */
+static int find_task(ThreadPool *pool, int id, Task *task)
+{
+    if (id >= 0 && take_own(&pool->queues[id], task))
+        return 1;
+    for (int i = 1; i <= pool->threads; i++)
+    {
+        int victim = ((id < 0 ? 0 : id) + i) % pool->threads;
+        if (steal(&pool->queues[victim], task))
+            return 1;
+    }
+    return 0;
+}
+
+static void run_task(ThreadPool *pool, const Task *task)
+{
+    task->function(task->arg);
+    pthread_mutex_lock(&pool->lock);
+    if (--task->batch->pending == 0)
+        pthread_cond_broadcast(&pool->batch_done);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void *worker_main(void *arg)
+{
+    WorkerStart *start = (WorkerStart *)arg;
+    ThreadPool *pool = start->pool;
+    int id = start->id;
+    free(start);
+
+    while (1)
+    {
+        Task task;
+        if (find_task(pool, id, &task))
+        {
+            pthread_mutex_lock(&pool->lock);
+            pool->queued--;
+            pthread_mutex_unlock(&pool->lock);
+            run_task(pool, &task);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        while (pool->queued == 0 && !pool->shutting_down)
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        int done = pool->queued == 0 && pool->shutting_down;
+        pthread_mutex_unlock(&pool->lock);
+        if (done)
+            return NULL;
+    }
+}
+
+/*******************************************************************************
+ * Pool Interface
+ ******************************************************************************/
+
+/* Starts a pool of worker threads. Returns NULL on failure */
+ThreadPool *pool_create(int threads)
+{
+    ThreadPool *pool = (ThreadPool *)calloc(1, sizeof(ThreadPool));
+    if (!pool || threads < 1)
+    {
+        free(pool);
+        return NULL;
+    }
+    pool->workers = (pthread_t *)calloc(threads, sizeof(pthread_t));
+    pool->queues = (WorkQueue *)calloc(threads, sizeof(WorkQueue));
+    if (!pool->workers || !pool->queues)
+    {
+        free(pool->workers);
+        free(pool->queues);
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->batch_done, NULL);
+    pool->threads = threads;
+    for (int i = 0; i < threads; i++)
+        pthread_mutex_init(&pool->queues[i].lock, NULL);
+
+    for (int i = 0; i < threads; i++)
+    {
+        WorkerStart *start = (WorkerStart *)malloc(sizeof(WorkerStart));
+        if (!start)
+            break;
+        start->pool = pool;
+        start->id = i;
+        if (pthread_create(&pool->workers[i], NULL, worker_main, start) != 0)
+        {
+            free(start);
+            break;
+        }
+        pool->started++;
+    }
+    if (pool->started == 0)
+    {
+        pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+/* Queues a task as part of a batch. A task that finds every queue full
+ * runs at once on the calling thread.
+ */
+void pool_submit(ThreadPool *pool, PoolBatch *batch, PoolTask function, void *arg)
+{
+    Task task = {function, arg, batch};
+
+    // Counted as queued before it is, so no thread sleeps while it is
+    pthread_mutex_lock(&pool->lock);
+    batch->pending++;
+    pool->queued++;
+    unsigned first = pool->next_queue++;
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->threads; i++)
+    {
+        WorkQueue *queue = &pool->queues[(first + i) % pool->threads];
+        pthread_mutex_lock(&queue->lock);
+        int room = queue->tail - queue->head < QUEUE_CAPACITY;
+        if (room)
+            queue->tasks[queue->tail++ % QUEUE_CAPACITY] = task;
+        pthread_mutex_unlock(&queue->lock);
+        if (room)
+        {
+            pthread_mutex_lock(&pool->lock);
+            pthread_cond_signal(&pool->work_ready);
+            pthread_mutex_unlock(&pool->lock);
+            return;
+        }
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->queued--;
+    pthread_mutex_unlock(&pool->lock);
+    run_task(pool, &task);
+}
+
+/* Waits until every task of the batch has run, running queued tasks meanwhile */
+void pool_wait(ThreadPool *pool, PoolBatch *batch)
+{
+    while (1)
+    {
+        pthread_mutex_lock(&pool->lock);
+        int pending = batch->pending;
+        pthread_mutex_unlock(&pool->lock);
+        if (pending == 0)
+            return;
+
+        Task task;
+        if (find_task(pool, -1, &task))
+        {
+            pthread_mutex_lock(&pool->lock);
+            pool->queued--;
+            pthread_mutex_unlock(&pool->lock);
+            run_task(pool, &task);
+            continue;
+        }
+
+        // Everything is taken: sleep until some batch finishes a task
+        pthread_mutex_lock(&pool->lock);
+        if (batch->pending > 0 && pool->queued == 0)
+            pthread_cond_wait(&pool->batch_done, &pool->lock);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+/* Runs the tasks still queued, then stops the workers and frees the pool */
+void pool_destroy(ThreadPool *pool)
+{
+    if (!pool)
+        return;
+    pthread_mutex_lock(&pool->lock);
+    pool->shutting_down = 1;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->started; i++)
+        pthread_join(pool->workers[i], NULL);
+    for (int i = 0; i < pool->threads; i++)
+        pthread_mutex_destroy(&pool->queues[i].lock);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->batch_done);
+    free(pool->workers);
+    free(pool->queues);
+    free(pool);
+}
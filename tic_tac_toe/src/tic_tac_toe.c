@@ -2,31 +2,32 @@
  * Tic Tac Toe Game Implementation
  *
  * A console-based Tic Tac Toe game featuring a player versus computer gameplay
- * with two difficulty levels: Human (Standard) and God (Impossible).
+ * with three difficulty levels: Human (Standard), God (Impossible) and Monte
+ * Carlo (Strong). Besides the classic 3x3 game it plays any N x N board up to
+ * 15x15 with K in a row to win, such as 4x4, 5x5 with 4 in a row or 15x15
+ * gomoku.
  *
  * Dependencies:
  * - stdio.h  : Standard input/output operations
- * - stdlib.h : Standard library functions (rand, srand)
- * - time.h   : Time functions for random seed
  *
  * Features:
  * - Colorful console interface using ANSI color codes
- * - Two difficulty levels
+ * - Three difficulty levels
  * - Score tracking
- * - Minimax algorithm for unbeatable AI
+ * - Unbeatable AI on 3x3 from a perfect-play table generated at build time
+ * - Timed iterative-deepening search on larger boards
+ * - Monte Carlo tree search on any board
  *
  * Usage:
- * 1. Compile: gcc tic_tac_toe.c -o tic_tac_toe
- * 2. Run: /tic_tac_toe
- * 3. Choose difficulty level (1 for Human, 2 for God)
- * 4. Enter moves using row and column numbers (1-3)
+ * 1. Compile: make
+ * 2. Run: ./tic_tac_toe [--size N] [--win K] [--time milliseconds]
+ *    (see main.c)
+ * 3. Choose difficulty level (1 for Human, 2 for God, 3 for Monte Carlo)
+ * 4. Enter moves using row and column numbers (1-N)
  ******************************************************************************/
 
 #include <stdio.h>
-#include <stdlib.h>
-#include <time.h>
-
-#define SIZE 3
+#include "tic_tac_toe.h"
 
 /* ANSI Color codes for enhanced visual experience */
 #define RED "\x1b[38;5;196m"     // Bright red
@@ -39,7 +40,10 @@
 
 /* Global variables for game state */
 int playerX_score = 0, computer_score = 0, draws = 0;
-char board[SIZE][SIZE];
+Board board;
+int board_size = SIZE, win_length = SIZE;
+int search_time_ms = 1000;
+uint64_t game_rng = 1;
 
 /*******************************************************************************
  * Function Prototypes
@@ -56,21 +60,19 @@ int is_winner(char symbol);                                       // Checks if g
 int is_draw();                                                    // Checks if game is a draw
 void player_move();                                               // Handles player's move input
 void computer_move(int difficulty);                               // Manages computer's move based on difficulty
-int minimax(char board[SIZE][SIZE], int depth, int isMaximizing); // AI algorithm
+int minimax(char board[MAX_SIZE][MAX_SIZE], int depth, int isMaximizing); // AI algorithm
 int check_available_moves();                                      // Checks for available moves
 void play_game(int difficulty);                                   // Main game loop
+void play_games();                                                // Replay loop
 int prompt_difficulty();                                          // Difficulty selection menu
 
 /*******************************************************************************
- * Main Function
+ * Replay Loop
  *
- * Entry point of the program. Handles game initialization and replay logic.
- * Returns: 0 on successful execution
+ * Plays games until the player declines another one.
  ******************************************************************************/
-int main()
+void play_games()
 {
-    srand(time(0)); // Seed random number generator
-
     while (1)
     {
         int difficulty = prompt_difficulty();
@@ -86,7 +88,6 @@ int main()
             break;
         }
     }
-    return 0;
 }
 
 /*******************************************************************************
@@ -94,9 +95,11 @@ int main()
  *
  * Prompts user to select game difficulty:
  * 1. Human (Standard) - Makes some strategic moves but can be beaten
- * 2. God (Impossible) - Uses minimax algorithm, cannot be beaten
+ * 2. God (Impossible) - Looks up perfect play in the tablebase on 3x3 and
+ *    runs the timed search of search.c on larger boards
+ * 3. Monte Carlo (Strong) - Learns its move from random playouts
  *
- * Returns: Selected difficulty level (1 or 2)
+ * Returns: Selected difficulty level (1, 2 or 3)
  ******************************************************************************/
 int prompt_difficulty()
 {
@@ -104,10 +107,10 @@ int prompt_difficulty()
     while (1)
     {
         printf(MAGENTA "\nChoose Difficulty:\n" RESET);
-        printf(CYAN "1) Human (Standard)\n2) God (Impossible to Win)\n> " RESET);
-        if (scanf("%d", &difficulty) != 1 || (difficulty != 1 && difficulty != 2))
+        printf(CYAN "1) Human (Standard)\n2) God (Impossible to Win)\n3) Monte Carlo (Strong)\n> " RESET);
+        if (scanf("%d", &difficulty) != 1 || difficulty < ENGINE_HUMAN || difficulty > ENGINE_MCTS)
         {
-            printf(RED "Invalid choice. Please enter 1 or 2.\n" RESET);
+            printf(RED "Invalid choice. Please enter 1, 2 or 3.\n" RESET);
             while (getchar() != '\n')
                 ; // Clear invalid input
         }
@@ -135,7 +138,7 @@ void play_game(int difficulty)
     initialize_board();
     display_score();
 
-    int player_turn = rand() % 2; // 0 for computer, 1 for Player X
+    int player_turn = rng_below(&game_rng, 2); // 0 for computer, 1 for Player X
 
     while (1)
     {
@@ -152,7 +155,7 @@ void play_game(int difficulty)
             computer_move(difficulty);
         }
 
-        if (is_winner(player_turn ? 'X' : 'O'))
+        if (board_wins(&board, board.last_row, board.last_col))
         {
             clear_screen();
             display_board();
@@ -191,32 +194,45 @@ void play_game(int difficulty)
 /* Initializes the game board with empty spaces */
 void initialize_board()
 {
-    for (int i = 0; i < SIZE; i++)
-        for (int j = 0; j < SIZE; j++)
-            board[i][j] = ' ';
+    board_init(&board, board_size, win_length);
 }
 
 /* Displays the current game board with colored symbols */
 void display_board()
 {
+    int numbered = board.size > SIZE; // Larger boards get row and column numbers
     printf(CYAN "Current Board:\n" RESET);
-    for (int i = 0; i < SIZE; i++)
+    if (numbered)
     {
-        for (int j = 0; j < SIZE; j++)
+        printf("   ");
+        for (int j = 0; j < board.size; j++)
+            printf(CYAN "%3d " RESET, j + 1);
+        printf("\n");
+    }
+    for (int i = 0; i < board.size; i++)
+    {
+        if (numbered)
+            printf(CYAN "%2d " RESET, i + 1);
+        for (int j = 0; j < board.size; j++)
         {
-            if (board[i][j] == 'X')
-                printf(GREEN " %c " RESET, board[i][j]);
-            else if (board[i][j] == 'O')
-                printf(RED " %c " RESET, board[i][j]);
+            if (board.cells[i][j] == 'X')
+                printf(GREEN " %c " RESET, board.cells[i][j]);
+            else if (board.cells[i][j] == 'O')
+                printf(RED " %c " RESET, board.cells[i][j]);
             else
-                printf(" %c ", board[i][j]);
+                printf(" %c ", board.cells[i][j]);
 
-            if (j < SIZE - 1)
+            if (j < board.size - 1)
                 printf(BLUE "|" RESET);
         }
         printf("\n");
-        if (i < SIZE - 1)
-            printf(BLUE "---+---+---\n" RESET);
+        if (i < board.size - 1)
+        {
+            if (numbered)
+                printf("   ");
+            for (int j = 0; j < board.size; j++)
+                printf(BLUE "%s" RESET, j < board.size - 1 ? "---+" : "---\n");
+        }
     }
 }
 
@@ -236,25 +252,24 @@ void clear_screen()
  * Game Logic Functions
  ******************************************************************************/
 
-/* Checks if the specified symbol has won */
+/* Checks if the specified symbol has won anywhere on the board.
+ * The game loop only checks the last move, see board_wins().
+ */
 int is_winner(char symbol)
 {
-    for (int i = 0; i < SIZE; i++)
-        if ((board[i][0] == symbol && board[i][1] == symbol && board[i][2] == symbol) ||
-            (board[0][i] == symbol && board[1][i] == symbol && board[2][i] == symbol))
-            return 1;
-    if ((board[0][0] == symbol && board[1][1] == symbol && board[2][2] == symbol) ||
-        (board[0][2] == symbol && board[1][1] == symbol && board[2][0] == symbol))
-        return 1;
+    for (int i = 0; i < board.size; i++)
+        for (int j = 0; j < board.size; j++)
+            if (board.cells[i][j] == symbol && board_wins(&board, i, j))
+                return 1;
     return 0;
 }
 
 /* Checks if the game is a draw */
 int is_draw()
 {
-    for (int i = 0; i < SIZE; i++)
-        for (int j = 0; j < SIZE; j++)
-            if (board[i][j] == ' ')
+    for (int i = 0; i < board.size; i++)
+        for (int j = 0; j < board.size; j++)
+            if (board.cells[i][j] == ' ')
                 return 0;
     return 1;
 }
@@ -267,9 +282,9 @@ void player_move()
     {
         printf(GREEN "Enter your move (row and column): " RESET);
         scanf("%d %d", &row, &col);
-        if (row >= 1 && row <= SIZE && col >= 1 && col <= SIZE && board[row - 1][col - 1] == ' ')
+        if (row >= 1 && row <= board.size && col >= 1 && col <= board.size && board.cells[row - 1][col - 1] == ' ')
         {
-            board[row - 1][col - 1] = 'X';
+            board_play(&board, row - 1, col - 1, 'X');
             break;
         }
         else
@@ -283,83 +298,19 @@ void player_move()
  * AI Logic Functions
  ******************************************************************************/
 
-/* Manages computer moves based on difficulty level */
+/* Manages computer moves based on difficulty level, see engine.c */
 void computer_move(int difficulty)
 {
-    if (difficulty == 1)
-    { // Human difficulty with smarter strategy
-        // Check if the computer can win in the next move
-        for (int i = 0; i < SIZE; i++)
-        {
-            for (int j = 0; j < SIZE; j++)
-            {
-                if (board[i][j] == ' ')
-                {
-                    board[i][j] = 'O';
-                    if (is_winner('O'))
-                        return;
-                    board[i][j] = ' ';
-                }
-            }
-        }
-
-        // Block Player X if they can win in the next move
-        for (int i = 0; i < SIZE; i++)
-        {
-            for (int j = 0; j < SIZE; j++)
-            {
-                if (board[i][j] == ' ')
-                {
-                    board[i][j] = 'X';
-                    if (is_winner('X'))
-                    {
-                        board[i][j] = 'O';
-                        return;
-                    }
-                    board[i][j] = ' ';
-                }
-            }
-        }
-
-        // If no imminent win or block, choose random available position
-        int row, col;
-        do
-        {
-            row = rand() % SIZE;
-            col = rand() % SIZE;
-        } while (board[row][col] != ' ');
-        board[row][col] = 'O';
-    }
-    else
-    { // God difficulty using Minimax for optimal moves
-        int best_score = -1000;
-        int move_row = -1, move_col = -1;
-        for (int i = 0; i < SIZE; i++)
-        {
-            for (int j = 0; j < SIZE; j++)
-            {
-                if (board[i][j] == ' ')
-                {
-                    board[i][j] = 'O';
-                    int score = minimax(board, 0, 0);
-                    board[i][j] = ' ';
-                    if (score > best_score)
-                    {
-                        best_score = score;
-                        move_row = i;
-                        move_col = j;
-                    }
-                }
-            }
-        }
-        board[move_row][move_col] = 'O';
-    }
+    int row, col;
+    if (engine_move(difficulty, &board, 'O', &game_rng, &row, &col))
+        board_play(&board, row, col, 'O');
 }
 
-/* Minimax algorithm for unbeatable AI
+/* Plain minimax over the whole game tree, kept as the reference the
+ * perfect-play table is checked against.
  * Returns the best possible score for the current board state
  */
-int minimax(char board[SIZE][SIZE], int depth, int isMaximizing)
+int minimax(char board[MAX_SIZE][MAX_SIZE], int depth, int isMaximizing)
 {
     if (is_winner('O'))
         return 10 - depth;
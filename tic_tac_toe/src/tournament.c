@@ -0,0 +1,208 @@
+/*******************************************************************************
+ * Engine Tournament
+ *
+ * Plays the headless engines (see engine.c) against each other and against
+ * themselves, without the console, and reports how each pairing ends and
+ * how many games per second were played.
+ *
+ * Every pairing plays the same number of games. The first engine always
+ * has 'X' and the side that opens alternates from game to game. Games are
+ * dealt out in chunks of CHUNK_GAMES to a work-stealing pool, one worker
+ * per core by default. Each chunk seeds its own generator from the seed,
+ * the pairing and the chunk number, so the results only depend on the seed
+ * and not on the thread count or scheduling.
+ *
+ * Usage: tournament [games] [--engines name,name,...] [--threads N]
+ *                   [--seed N] [--size N] [--win K] [--depth N] [--time ms]
+ *                   [--playouts N]
+ *   games      Games per pairing, default 1000000, or 1000 when mcts takes
+ *              part since each of its moves runs a full search
+ *   --engines  Engines taking part, default random,human,god (the fast ones)
+ *   --threads  Worker threads, default one per CPU
+ *   --size/--win  Board size and stones in a row, default 3 and the size
+ *   --depth    Search depth of "god" beyond 3x3, default 2
+ *   --time     Time per move of "god" beyond 3x3 instead of a fixed depth,
+ *              and of "mcts" with --playouts 0
+ *   --playouts Playouts per move of "mcts", default 1000
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "tic_tac_toe.h"
+
+#define CHUNK_GAMES 4096
+#define DEFAULT_GAMES 1000000
+#define DEFAULT_MCTS_GAMES 1000
+
+typedef struct
+{
+    int x_engine, o_engine;
+    int size, k;
+    long first_game, games;
+    uint64_t seed;
+    long x_wins, o_wins, draws;
+} Chunk;
+
+/* Plays one chunk of a pairing */
+static void play_chunk(void *arg)
+{
+    Chunk *chunk = (Chunk *)arg;
+    uint64_t rng;
+    rng_seed(&rng, chunk->seed);
+
+    for (long game = chunk->first_game; game < chunk->first_game + chunk->games; game++)
+    {
+        char winner = engine_play_game(chunk->x_engine, chunk->o_engine, chunk->size, chunk->k,
+                                       game % 2 ? 'O' : 'X', &rng);
+        if (winner == 'X')
+            chunk->x_wins++;
+        else if (winner == 'O')
+            chunk->o_wins++;
+        else
+            chunk->draws++;
+    }
+}
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int usage(const char *program)
+{
+    fprintf(stderr,
+            "Usage: %s [games] [--engines name,name,...] [--threads N] [--seed N]\n"
+            "          [--size N] [--win K] [--depth N] [--time ms] [--playouts N]\n"
+            "Engines: random, human, god, mcts\n",
+            program);
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    long games = 0; // 0 until given: the default depends on the engines
+    int engines[ENGINE_COUNT] = {ENGINE_RANDOM, ENGINE_HUMAN, ENGINE_GOD};
+    int engine_count = 3;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    uint64_t seed = 1;
+    int size = SIZE, k = 0, depth = 2, time_ms = 0, playouts = 1000;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--engines") == 0 && i + 1 < argc)
+        {
+            engine_count = 0;
+            char list[256];
+            snprintf(list, sizeof(list), "%s", argv[++i]);
+            for (char *name = strtok(list, ","); name; name = strtok(NULL, ","))
+            {
+                int engine = engine_lookup(name);
+                if (engine < 0 || engine_count == ENGINE_COUNT)
+                    return usage(argv[0]);
+                engines[engine_count++] = engine;
+            }
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+            threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+            size = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--win") == 0 && i + 1 < argc)
+            k = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+            depth = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--time") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+            time_ms = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--playouts") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 0)
+            playouts = atoi(argv[++i]);
+        else if (argv[i][0] != '-' && atol(argv[i]) > 0)
+            games = atol(argv[i]);
+        else
+            return usage(argv[0]);
+    }
+    if (k == 0)
+        k = size;
+    if (games == 0)
+    {
+        games = DEFAULT_GAMES;
+        for (int e = 0; e < engine_count; e++)
+            if (engines[e] == ENGINE_MCTS)
+                games = DEFAULT_MCTS_GAMES;
+    }
+    Board check;
+    if (engine_count == 0 || !board_init(&check, size, k))
+        return usage(argv[0]);
+
+    // Parallelism comes from the games; each search stays on its thread
+    search_set_threads(1);
+    mcts_set_threads(1);
+    mcts_iterations = playouts;
+    search_set_max_depth(time_ms ? 0 : depth);
+    search_time_ms = time_ms;
+
+    ThreadPool *pool = threads > 1 ? pool_create(threads - 1) : NULL;
+    long chunk_count = (games + CHUNK_GAMES - 1) / CHUNK_GAMES;
+    Chunk *chunks = (Chunk *)calloc(chunk_count, sizeof(Chunk));
+    if (!chunks)
+        return 1;
+
+    printf("Board %dx%d, %d in a row; %ld games per pairing on %d thread%s, seed %llu\n",
+           size, size, k, games, threads, threads == 1 ? "" : "s", (unsigned long long)seed);
+    printf("%-8s %-8s %9s %9s %9s %12s\n", "X", "O", "X wins", "draws", "O wins", "games/s");
+
+    long total_games = 0;
+    double total_seconds = 0;
+    for (int a = 0; a < engine_count; a++)
+    {
+        for (int b = a; b < engine_count; b++)
+        {
+            for (long c = 0; c < chunk_count; c++)
+            {
+                Chunk chunk = {engines[a], engines[b], size, k, c * CHUNK_GAMES,
+                               games - c * CHUNK_GAMES < CHUNK_GAMES ? games - c * CHUNK_GAMES : CHUNK_GAMES,
+                               seed ^ ((uint64_t)(a * ENGINE_COUNT + b) << 48) ^ (uint64_t)c, 0, 0, 0};
+                chunks[c] = chunk;
+            }
+
+            double start = now();
+            if (pool)
+            {
+                PoolBatch batch = {0};
+                for (long c = 0; c < chunk_count; c++)
+                    pool_submit(pool, &batch, play_chunk, &chunks[c]);
+                pool_wait(pool, &batch);
+            }
+            else
+            {
+                for (long c = 0; c < chunk_count; c++)
+                    play_chunk(&chunks[c]);
+            }
+            double seconds = now() - start;
+
+            long x_wins = 0, o_wins = 0, draws = 0;
+            for (long c = 0; c < chunk_count; c++)
+            {
+                x_wins += chunks[c].x_wins;
+                o_wins += chunks[c].o_wins;
+                draws += chunks[c].draws;
+            }
+            printf("%-8s %-8s %8.2f%% %8.2f%% %8.2f%% %12.0f\n", engine_name(engines[a]), engine_name(engines[b]),
+                   100.0 * x_wins / games, 100.0 * draws / games, 100.0 * o_wins / games,
+                   seconds > 0 ? games / seconds : 0);
+            total_games += games;
+            total_seconds += seconds;
+        }
+    }
+    printf("%ld games in %.2f s, %.0f games/s\n", total_games, total_seconds,
+           total_seconds > 0 ? total_games / total_seconds : 0);
+
+    free(chunks);
+    pool_destroy(pool);
+    return 0;
+}